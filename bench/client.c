@@ -0,0 +1,486 @@
+#include "client.h"
+#include "scenario.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <assert.h>
+#include <sys/mman.h>
+
+#include <wayland-client.h>
+#include "wayland-xdg-shell-client-protocol.h"
+
+#define MAX_BUFFERS 3
+
+struct buffer {
+   struct wl_buffer *buffer;
+   void *data;
+   size_t size;
+   struct wlc_size dimensions;
+   bool busy;
+};
+
+struct client {
+   struct wl_display *display;
+   struct wl_registry *registry;
+   struct wl_compositor *compositor;
+   struct wl_shm *shm;
+   struct xdg_shell *shell;
+   struct wl_surface *surface;
+   struct xdg_surface *xdg_surface;
+   struct buffer buffers[MAX_BUFFERS];
+   const struct bench_group *group;
+   struct wlc_size size;
+
+   struct {
+      struct wlc_size size;
+      uint32_t serial;
+      bool pending;
+   } configure;
+
+   uint64_t next_commit; // ns, rate driven clients
+   uint32_t frame;
+   bool ready; // frame callback driven clients
+};
+
+struct frame {
+   struct client *client;
+   uint64_t commit_time;
+};
+
+static struct {
+   struct bench_client_results results;
+   struct bench_latencies latencies;
+   uint64_t measure_start;
+} bench;
+
+static bool
+measuring(uint64_t time)
+{
+   return (time >= bench.measure_start);
+}
+
+static int
+compare_uint32(const void *a, const void *b)
+{
+   const uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+   return (x > y) - (x < y);
+}
+
+static uint32_t
+percentile(const struct bench_latencies *latencies, uint32_t p)
+{
+   if (!latencies->count)
+      return 0;
+
+   return latencies->values[(latencies->count - 1) * p / 100];
+}
+
+uint64_t
+bench_now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void
+bench_latencies_add(struct bench_latencies *latencies, uint32_t us)
+{
+   assert(latencies);
+
+   if (latencies->count >= latencies->max) {
+      size_t max = (latencies->max ? latencies->max * 2 : 4096);
+      uint32_t *values;
+      if (!(values = realloc(latencies->values, max * sizeof(uint32_t))))
+         return;
+
+      latencies->values = values;
+      latencies->max = max;
+   }
+
+   latencies->values[latencies->count++] = us;
+}
+
+void
+bench_latencies_finish(struct bench_latencies *latencies, struct bench_client_results *results)
+{
+   assert(latencies && results);
+   qsort(latencies->values, latencies->count, sizeof(uint32_t), compare_uint32);
+   results->latency_p50 = percentile(latencies, 50);
+   results->latency_p90 = percentile(latencies, 90);
+   results->latency_p99 = percentile(latencies, 99);
+   results->latency_max = percentile(latencies, 100);
+}
+
+void
+bench_latencies_release(struct bench_latencies *latencies)
+{
+   assert(latencies);
+   free(latencies->values);
+   memset(latencies, 0, sizeof(struct bench_latencies));
+}
+
+int
+bench_create_anonymous_file(size_t size)
+{
+   const char *dir;
+   if (!(dir = getenv("XDG_RUNTIME_DIR")))
+      dir = "/tmp";
+
+   char path[256];
+   snprintf(path, sizeof(path), "%s/wlc-bench-XXXXXX", dir);
+
+   int fd;
+   if ((fd = mkostemp(path, O_CLOEXEC)) < 0)
+      return -1;
+
+   unlink(path);
+
+   if (ftruncate(fd, size) < 0) {
+      close(fd);
+      return -1;
+   }
+
+   return fd;
+}
+
+static void
+buffer_release(void *data, struct wl_buffer *wl_buffer)
+{
+   (void)wl_buffer;
+   struct buffer *buffer = data;
+   buffer->busy = false;
+}
+
+static const struct wl_buffer_listener buffer_listener = {
+   .release = buffer_release,
+};
+
+static void
+buffer_release_resources(struct buffer *buffer)
+{
+   if (buffer->buffer)
+      wl_buffer_destroy(buffer->buffer);
+
+   if (buffer->data)
+      munmap(buffer->data, buffer->size);
+
+   memset(buffer, 0, sizeof(struct buffer));
+}
+
+static bool
+buffer_create(struct client *client, struct buffer *buffer, const struct wlc_size *size)
+{
+   const uint32_t stride = size->w * 4;
+   buffer->size = stride * size->h;
+
+   int fd;
+   if ((fd = bench_create_anonymous_file(buffer->size)) < 0)
+      return false;
+
+   if ((buffer->data = mmap(NULL, buffer->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+      buffer->data = NULL;
+      close(fd);
+      return false;
+   }
+
+   struct wl_shm_pool *pool = wl_shm_create_pool(client->shm, fd, buffer->size);
+   buffer->buffer = wl_shm_pool_create_buffer(pool, 0, size->w, size->h, stride, WL_SHM_FORMAT_XRGB8888);
+   wl_shm_pool_destroy(pool);
+   close(fd);
+
+   wl_buffer_add_listener(buffer->buffer, &buffer_listener, buffer);
+   buffer->dimensions = *size;
+   buffer->busy = false;
+   return true;
+}
+
+static bool
+client_resize_buffers(struct client *client, const struct wlc_size *size)
+{
+   for (uint32_t i = 0; i < client->group->buffers; ++i) {
+      buffer_release_resources(&client->buffers[i]);
+      if (!buffer_create(client, &client->buffers[i], size))
+         return false;
+   }
+
+   client->size = *size;
+   return true;
+}
+
+static struct buffer*
+client_next_buffer(struct client *client)
+{
+   for (uint32_t i = 0; i < client->group->buffers; ++i) {
+      if (!client->buffers[i].busy)
+         return &client->buffers[i];
+   }
+   return NULL;
+}
+
+static void frame_done(void *data, struct wl_callback *callback, uint32_t time);
+
+static const struct wl_callback_listener frame_listener = {
+   .done = frame_done,
+};
+
+static void
+client_commit(struct client *client, uint64_t time)
+{
+   if (client->configure.pending) {
+      xdg_surface_ack_configure(client->xdg_surface, client->configure.serial);
+      client->configure.pending = false;
+
+      if (client->configure.size.w != client->size.w || client->configure.size.h != client->size.h)
+         client_resize_buffers(client, &client->configure.size);
+   }
+
+   struct buffer *buffer;
+   if (!(buffer = client_next_buffer(client))) {
+      bench.results.starved += measuring(time);
+      return;
+   }
+
+   struct frame *frame;
+   if (!(frame = malloc(sizeof(struct frame))))
+      return;
+
+   // Damage a horizontal band that moves down each frame, the whole surface at 100%
+   const uint32_t w = buffer->dimensions.w, h = buffer->dimensions.h;
+   const uint32_t band = (h * client->group->damage + 99) / 100;
+   const uint32_t y = (band < h ? (client->frame * band) % (h - band + 1) : 0);
+   memset((uint8_t*)buffer->data + y * w * 4, client->frame & 0xff, band * w * 4);
+
+   frame->client = client;
+   frame->commit_time = time;
+
+   wl_surface_attach(client->surface, buffer->buffer, 0, 0);
+   wl_surface_damage(client->surface, 0, y, w, band);
+   wl_callback_add_listener(wl_surface_frame(client->surface), &frame_listener, frame);
+   wl_surface_commit(client->surface);
+
+   buffer->busy = true;
+   client->frame++;
+   client->ready = false;
+   bench.results.commits += measuring(time);
+}
+
+static void
+frame_done(void *data, struct wl_callback *callback, uint32_t time)
+{
+   (void)time;
+   struct frame *frame = data;
+   wl_callback_destroy(callback);
+
+   const uint64_t now = bench_now_ns();
+   if (measuring(frame->commit_time)) {
+      bench.results.presented++;
+      bench_latencies_add(&bench.latencies, (now - frame->commit_time) / 1000);
+   }
+
+   frame->client->ready = true;
+   free(frame);
+}
+
+static void
+xdg_shell_ping(void *data, struct xdg_shell *shell, uint32_t serial)
+{
+   (void)data;
+   xdg_shell_pong(shell, serial);
+}
+
+static const struct xdg_shell_listener xdg_shell_listener = {
+   .ping = xdg_shell_ping,
+};
+
+static void
+xdg_surface_configure(void *data, struct xdg_surface *xdg_surface, int32_t width, int32_t height, struct wl_array *states, uint32_t serial)
+{
+   (void)xdg_surface, (void)states;
+   struct client *client = data;
+
+   client->configure.size = (width > 0 && height > 0 ? (struct wlc_size){ width, height } : client->size);
+   client->configure.serial = serial;
+   client->configure.pending = true;
+}
+
+static void
+xdg_surface_close(void *data, struct xdg_surface *xdg_surface)
+{
+   (void)data, (void)xdg_surface;
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+   .configure = xdg_surface_configure,
+   .close = xdg_surface_close,
+};
+
+static void
+registry_global(void *data, struct wl_registry *registry, uint32_t name, const char *interface, uint32_t version)
+{
+   (void)version;
+   struct client *client = data;
+
+   if (!strcmp(interface, "wl_compositor")) {
+      client->compositor = wl_registry_bind(registry, name, &wl_compositor_interface, 1);
+   } else if (!strcmp(interface, "wl_shm")) {
+      client->shm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
+   } else if (!strcmp(interface, "xdg_shell")) {
+      client->shell = wl_registry_bind(registry, name, &xdg_shell_interface, 1);
+      xdg_shell_use_unstable_version(client->shell, XDG_SHELL_VERSION_CURRENT);
+      xdg_shell_add_listener(client->shell, &xdg_shell_listener, client);
+   }
+}
+
+static void
+registry_global_remove(void *data, struct wl_registry *registry, uint32_t name)
+{
+   (void)data, (void)registry, (void)name;
+}
+
+static const struct wl_registry_listener registry_listener = {
+   .global = registry_global,
+   .global_remove = registry_global_remove,
+};
+
+static void
+client_release(struct client *client)
+{
+   for (uint32_t i = 0; i < MAX_BUFFERS; ++i)
+      buffer_release_resources(&client->buffers[i]);
+
+   if (client->xdg_surface)
+      xdg_surface_destroy(client->xdg_surface);
+
+   if (client->surface)
+      wl_surface_destroy(client->surface);
+
+   if (client->display)
+      wl_display_disconnect(client->display);
+
+   memset(client, 0, sizeof(struct client));
+}
+
+static bool
+client_connect(struct client *client, const struct bench_group *group, uint32_t index)
+{
+   client->group = group;
+   client->ready = true;
+
+   if (!(client->display = wl_display_connect(NULL)))
+      return false;
+
+   client->registry = wl_display_get_registry(client->display);
+   wl_registry_add_listener(client->registry, &registry_listener, client);
+   wl_display_roundtrip(client->display);
+
+   if (!client->compositor || !client->shm || !client->shell)
+      return false;
+
+   client->surface = wl_compositor_create_surface(client->compositor);
+   client->xdg_surface = xdg_shell_get_xdg_surface(client->shell, client->surface);
+   xdg_surface_add_listener(client->xdg_surface, &xdg_surface_listener, client);
+
+   char title[32];
+   snprintf(title, sizeof(title), "wlc-bench-%u", index);
+   xdg_surface_set_title(client->xdg_surface, title);
+
+   return client_resize_buffers(client, &group->size);
+}
+
+bool
+bench_clients_run(const struct bench_scenario *scenario, struct bench_client_results *out_results)
+{
+   assert(scenario && out_results);
+
+   uint32_t num_clients = 0;
+   for (uint32_t i = 0; i < scenario->num_groups; ++i)
+      num_clients += scenario->groups[i].count;
+
+   struct client *clients;
+   struct pollfd *fds;
+   if (!(clients = calloc(num_clients, sizeof(struct client))) || !(fds = calloc(num_clients, sizeof(struct pollfd)))) {
+      free(clients);
+      return false;
+   }
+
+   bool ret = false;
+   for (uint32_t i = 0, c = 0; i < scenario->num_groups; ++i) {
+      for (uint32_t n = 0; n < scenario->groups[i].count; ++n, ++c) {
+         if (!client_connect(&clients[c], &scenario->groups[i], c)) {
+            fprintf(stderr, "wlc-bench: client %u failed to connect\n", c);
+            goto out;
+         }
+
+         fds[c].fd = wl_display_get_fd(clients[c].display);
+         fds[c].events = POLLIN;
+      }
+   }
+
+   const uint64_t start = bench_now_ns();
+   const uint64_t end = start + (uint64_t)scenario->duration * 1000000000;
+   bench.measure_start = start + (uint64_t)scenario->warmup * 1000000000;
+
+   for (uint64_t now = start; now < end; now = bench_now_ns()) {
+      uint64_t next = end;
+
+      for (uint32_t c = 0; c < num_clients; ++c) {
+         struct client *client = &clients[c];
+
+         if (client->group->rate > 0) {
+            if (now >= client->next_commit) {
+               client_commit(client, now);
+               client->next_commit = (client->next_commit ? client->next_commit : now) + 1000000000 / client->group->rate;
+               client->next_commit = (client->next_commit < now ? now : client->next_commit);
+            }
+
+            next = (client->next_commit < next ? client->next_commit : next);
+         } else if (client->ready) {
+            client_commit(client, now);
+         }
+
+         while (wl_display_prepare_read(client->display) != 0)
+            wl_display_dispatch_pending(client->display);
+
+         wl_display_flush(client->display);
+      }
+
+      const int timeout = (next > now ? (next - now + 999999) / 1000000 : 0);
+      if (poll(fds, num_clients, timeout) < 0) {
+         for (uint32_t c = 0; c < num_clients; ++c)
+            wl_display_cancel_read(clients[c].display);
+         continue;
+      }
+
+      for (uint32_t c = 0; c < num_clients; ++c) {
+         if (fds[c].revents & POLLIN) {
+            wl_display_read_events(clients[c].display);
+         } else {
+            wl_display_cancel_read(clients[c].display);
+         }
+
+         if (wl_display_dispatch_pending(clients[c].display) < 0) {
+            fprintf(stderr, "wlc-bench: client %u lost connection\n", c);
+            goto out;
+         }
+      }
+   }
+
+   bench_latencies_finish(&bench.latencies, &bench.results);
+   memcpy(out_results, &bench.results, sizeof(struct bench_client_results));
+   ret = true;
+
+out:
+   for (uint32_t c = 0; c < num_clients; ++c)
+      client_release(&clients[c]);
+
+   bench_latencies_release(&bench.latencies);
+   free(clients);
+   free(fds);
+   return ret;
+}
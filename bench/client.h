@@ -0,0 +1,31 @@
+#ifndef _WLC_BENCH_CLIENT_H_
+#define _WLC_BENCH_CLIENT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+struct bench_scenario;
+
+// Measured after warmup, latencies are commit to frame callback done in microseconds.
+struct bench_client_results {
+   uint64_t commits, presented, starved;
+   uint32_t latency_p50, latency_p90, latency_p99, latency_max;
+};
+
+// Frame latencies in microseconds, shared by the synthetic and the replay driver.
+struct bench_latencies {
+   uint32_t *values;
+   size_t count, max;
+};
+
+uint64_t bench_now_ns(void);
+int bench_create_anonymous_file(size_t size);
+void bench_latencies_add(struct bench_latencies *latencies, uint32_t us);
+void bench_latencies_finish(struct bench_latencies *latencies, struct bench_client_results *results);
+void bench_latencies_release(struct bench_latencies *latencies);
+
+// Runs all synthetic clients of scenario against $WAYLAND_DISPLAY until duration elapsed.
+bool bench_clients_run(const struct bench_scenario *scenario, struct bench_client_results *out_results);
+
+#endif /* _WLC_BENCH_CLIENT_H_ */
@@ -0,0 +1,92 @@
+// commit_state() region math, includes surface.c for the static function.
+#include "compositor/surface.c"
+#include "micro.h"
+
+struct data {
+   struct wlc_surface surface;
+   pixman_box32_t *damage;
+   uint32_t num_damage;
+};
+
+static void
+init_state(struct wlc_surface_state *state)
+{
+   memset(state, 0, sizeof(struct wlc_surface_state));
+   wl_list_init(&state->frame_cb_list);
+   pixman_region32_init(&state->opaque);
+   pixman_region32_init(&state->input);
+   pixman_region32_init(&state->damage);
+}
+
+static void
+fini_state(struct wlc_surface_state *state)
+{
+   pixman_region32_fini(&state->opaque);
+   pixman_region32_fini(&state->input);
+   pixman_region32_fini(&state->damage);
+}
+
+static void
+bench_commit(void *ptr)
+{
+   struct data *data = ptr;
+   struct wlc_surface *surface = &data->surface;
+
+   for (uint32_t i = 0; i < data->num_damage; ++i) {
+      const pixman_box32_t *b = &data->damage[i];
+      pixman_region32_union_rect(&surface->pending.damage, &surface->pending.damage, b->x1, b->y1, b->x2 - b->x1, b->y2 - b->y1);
+   }
+
+   commit_state(surface, &surface->pending, &surface->commit);
+   micro_sink = pixman_region32_n_rects(&surface->commit.damage);
+
+   // Renderer clears damage after painting
+   pixman_region32_clear(&surface->commit.damage);
+}
+
+static void
+run(const char *name, uint32_t num_damage, bool opaque)
+{
+   struct data data;
+   memset(&data, 0, sizeof(data));
+   data.surface.size = (struct wlc_size){ 1920, 1080 };
+   init_state(&data.surface.pending);
+   init_state(&data.surface.commit);
+
+   // Input covers everything, opaque region is either full or a window with csd shadow cut out
+   pixman_region32_union_rect(&data.surface.pending.input, &data.surface.pending.input, INT32_MIN / 2, INT32_MIN / 2, UINT32_MAX / 2, UINT32_MAX / 2);
+   if (opaque) {
+      pixman_region32_union_rect(&data.surface.pending.opaque, &data.surface.pending.opaque, 0, 0, 1920, 1080);
+   } else {
+      pixman_region32_union_rect(&data.surface.pending.opaque, &data.surface.pending.opaque, 16, 16, 1888, 1048);
+   }
+
+   // Scattered damage like a text editor redrawing glyphs
+   if (!(data.damage = calloc(num_damage, sizeof(pixman_box32_t))))
+      return;
+
+   data.num_damage = num_damage;
+   srand(1);
+   for (uint32_t i = 0; i < num_damage; ++i) {
+      const int32_t x = rand() % 1900, y = rand() % 1060;
+      data.damage[i] = (pixman_box32_t){ x, y, x + 8 + rand() % 64, y + 16 };
+   }
+
+   micro_run(name, bench_commit, &data);
+
+   fini_state(&data.surface.pending);
+   fini_state(&data.surface.commit);
+   free(data.damage);
+}
+
+int
+main(int argc, char *argv[])
+{
+   micro_init(argc, argv);
+   run("commit_state/damage-1/opaque", 1, true);
+   run("commit_state/damage-16/opaque", 16, true);
+   run("commit_state/damage-256/opaque", 256, true);
+   run("commit_state/damage-16/shadow", 16, false);
+   run("commit_state/damage-256/shadow", 256, false);
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+// view_under_pointer() hit-testing, includes pointer.c for the static function.
+#include "compositor/seat/pointer.c"
+#include "micro.h"
+
+#include "compositor/compositor.h"
+#include "compositor/output.h"
+#include "compositor/view.h"
+
+#define NUM_POINTS 256
+
+struct data {
+   struct wlc_compositor compositor;
+   struct wlc_output output;
+   struct wlc_space space;
+   struct wlc_pointer pointer;
+   struct wlc_view *views;
+   struct wlc_pointer_origin points[NUM_POINTS];
+   uint32_t point;
+};
+
+static void
+bench_hit_test(void *ptr)
+{
+   struct data *data = ptr;
+   data->pointer.pos = data->points[data->point++ % NUM_POINTS];
+   micro_sink = (uintptr_t)view_under_pointer(&data->pointer);
+}
+
+static void
+run(uint32_t count)
+{
+   struct data data;
+   memset(&data, 0, sizeof(data));
+
+   if (!(data.views = calloc(count, sizeof(struct wlc_view))))
+      return;
+
+   data.output.resolution = (struct wlc_size){ 1920, 1080 };
+   data.output.space = &data.space;
+   data.compositor.output = &data.output;
+   data.pointer.compositor = &data.compositor;
+   wl_list_init(&data.space.views);
+   wlc_space_index_init(&data.space.index);
+
+   // Overlapping cascaded windows, topmost last in list
+   srand(1);
+   for (uint32_t i = 0; i < count; ++i) {
+      struct wlc_view *view = &data.views[i];
+      view->space = &data.space;
+      wl_list_init(&view->childs);
+      view->commit.geometry = (struct wlc_geometry){ { rand() % 1600, rand() % 800 }, { 160 + rand() % 480, 120 + rand() % 360 } };
+      wl_list_insert(data.space.views.prev, &view->link);
+      wlc_space_index_dirty(view);
+   }
+
+   wlc_space_index_restack(&data.space);
+
+   for (uint32_t i = 0; i < NUM_POINTS; ++i)
+      data.points[i] = (struct wlc_pointer_origin){ rand() % 1920, rand() % 1080 };
+
+   char name[64];
+   snprintf(name, sizeof(name), "view_under_pointer/views-%u", count);
+   micro_run(name, bench_hit_test, &data);
+   wlc_space_index_release(&data.space.index);
+   free(data.views);
+}
+
+int
+main(int argc, char *argv[])
+{
+   micro_init(argc, argv);
+   run(10);
+   run(100);
+   run(1000);
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,59 @@
+// is_visible() coverage computation, includes output.c for the static function.
+#include "compositor/output.c"
+#include "micro.h"
+
+struct data {
+   struct wlc_output output;
+   struct wlc_space space;
+   struct wlc_view *views;
+   struct wlc_surface *surfaces;
+};
+
+static void
+bench_is_visible(void *ptr)
+{
+   struct data *data = ptr;
+   micro_sink = is_visible(&data->output);
+}
+
+static void
+run(const char *name, uint32_t count, uint32_t transparent_every)
+{
+   struct data data;
+   memset(&data, 0, sizeof(data));
+
+   if (!(data.views = calloc(count, sizeof(struct wlc_view))) || !(data.surfaces = calloc(count, sizeof(struct wlc_surface)))) {
+      free(data.views);
+      return;
+   }
+
+   data.output.resolution = (struct wlc_size){ 1920, 1080 };
+   data.output.space = &data.space;
+   wl_list_init(&data.space.views);
+
+   // Windows don't cover the whole output, so the whole list is walked
+   srand(1);
+   for (uint32_t i = 0; i < count; ++i) {
+      struct wlc_view *view = &data.views[i];
+      view->surface = &data.surfaces[i];
+      view->surface->opaque = !(transparent_every && (i % transparent_every) == 0);
+      view->commit.geometry = (struct wlc_geometry){ { 16 + rand() % 1400, 16 + rand() % 700 }, { 160 + rand() % 320, 120 + rand() % 240 } };
+      wl_list_insert(data.space.views.prev, &view->link);
+   }
+
+   micro_run(name, bench_is_visible, &data);
+   free(data.surfaces);
+   free(data.views);
+}
+
+int
+main(int argc, char *argv[])
+{
+   micro_init(argc, argv);
+   run("is_visible/views-10/opaque", 10, 0);
+   run("is_visible/views-100/opaque", 100, 0);
+   run("is_visible/views-1000/opaque", 1000, 0);
+   run("is_visible/views-100/translucent-10%", 100, 10);
+   run("is_visible/views-1000/translucent-10%", 1000, 10);
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+#define _GNU_SOURCE
+#include "micro.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <sched.h>
+#include <time.h>
+
+#define WARMUP_NS 100000000
+#define SAMPLE_NS 5000000
+#define DEFAULT_SAMPLES 21
+
+volatile uintptr_t micro_sink;
+
+static struct {
+   const char *filter;
+   uint32_t samples;
+} micro;
+
+static uint64_t
+now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t
+run_batch(void (*fn)(void*), void *data, uint64_t iterations)
+{
+   const uint64_t start = now_ns();
+   for (uint64_t i = 0; i < iterations; ++i)
+      fn(data);
+   return now_ns() - start;
+}
+
+static int
+compare_double(const void *a, const void *b)
+{
+   const double x = *(const double*)a, y = *(const double*)b;
+   return (x > y) - (x < y);
+}
+
+void
+micro_init(int argc, char *argv[])
+{
+   // Optional substring filter for benchmark names
+   micro.filter = (argc > 1 ? argv[1] : NULL);
+
+   const char *env;
+   micro.samples = ((env = getenv("MICRO_SAMPLES")) ? strtoul(env, NULL, 10) : DEFAULT_SAMPLES);
+   micro.samples = (micro.samples > 0 ? micro.samples : DEFAULT_SAMPLES);
+
+   int cpu = ((env = getenv("MICRO_CPU")) ? atoi(env) : sched_getcpu());
+   if (cpu >= 0) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpu, &set);
+      if (sched_setaffinity(0, sizeof(set), &set) != 0)
+         fprintf(stderr, "micro: could not pin to cpu %d\n", cpu);
+   }
+}
+
+void
+micro_run(const char *name, void (*fn)(void *data), void *data)
+{
+   if (micro.filter && !strstr(name, micro.filter))
+      return;
+
+   // Warm up caches, branch predictors and cpu frequency
+   for (const uint64_t end = now_ns() + WARMUP_NS; now_ns() < end;)
+      fn(data);
+
+   uint64_t iterations = 1;
+   while (run_batch(fn, data, iterations) < SAMPLE_NS && iterations < (1ULL << 40))
+      iterations *= 2;
+
+   double *samples;
+   if (!(samples = calloc(micro.samples, sizeof(double))))
+      return;
+
+   for (uint32_t i = 0; i < micro.samples; ++i)
+      samples[i] = (double)run_batch(fn, data, iterations) / iterations;
+
+   qsort(samples, micro.samples, sizeof(double), compare_double);
+   printf("{ \"bench\": \"%s\", \"iterations\": %llu, \"samples\": %u, \"ns_min\": %.2f, \"ns_median\": %.2f, \"ns_max\": %.2f }\n",
+          name, (unsigned long long)iterations, micro.samples, samples[0], samples[micro.samples / 2], samples[micro.samples - 1]);
+   fflush(stdout);
+   free(samples);
+}
@@ -0,0 +1,20 @@
+#ifndef _WLC_MICRO_H_
+#define _WLC_MICRO_H_
+
+#include <stdint.h>
+
+/**
+ * Micro benchmark harness.
+ *
+ * micro_run() warms fn up, calibrates iterations so one sample takes a few ms
+ * and prints ns per call of the samples as a JSON line.
+ * MICRO_CPU pins to a cpu (default: current), MICRO_SAMPLES sets sample count.
+ */
+
+// Keeps results alive so the compiler can't drop the measured call.
+extern volatile uintptr_t micro_sink;
+
+void micro_init(int argc, char *argv[]);
+void micro_run(const char *name, void (*fn)(void *data), void *data);
+
+#endif /* _WLC_MICRO_H_ */
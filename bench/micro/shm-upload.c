@@ -0,0 +1,159 @@
+// wl_shm texture upload paths, mirrors shm_attach() in gles2.c on an offscreen EGL context.
+#include "micro.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#  define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+struct data {
+   GLuint texture;
+   uint8_t *pixels;
+   uint32_t w, h, pitch;
+   uint32_t band; // rows uploaded by partial variants
+   uint32_t frame;
+};
+
+static bool
+create_context(void)
+{
+   EGLDisplay display = EGL_NO_DISPLAY;
+
+   PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display;
+   if ((get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT")))
+      display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+
+   if (display == EGL_NO_DISPLAY && (display = eglGetDisplay(EGL_DEFAULT_DISPLAY)) == EGL_NO_DISPLAY)
+      return false;
+
+   if (!eglInitialize(display, NULL, NULL) || !eglBindAPI(EGL_OPENGL_ES_API))
+      return false;
+
+   static const EGLint config_attribs[] = {
+      EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+      EGL_RED_SIZE, 1,
+      EGL_GREEN_SIZE, 1,
+      EGL_BLUE_SIZE, 1,
+      EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+      EGL_NONE
+   };
+
+   EGLint n;
+   EGLConfig config;
+   if (!eglChooseConfig(display, config_attribs, &config, 1, &n) || n < 1)
+      return false;
+
+   static const EGLint context_attribs[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
+   static const EGLint pbuffer_attribs[] = { EGL_WIDTH, 16, EGL_HEIGHT, 16, EGL_NONE };
+
+   EGLContext context;
+   EGLSurface surface;
+   if ((context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs)) == EGL_NO_CONTEXT)
+      return false;
+
+   if ((surface = eglCreatePbufferSurface(display, config, pbuffer_attribs)) == EGL_NO_SURFACE)
+      return false;
+
+   return eglMakeCurrent(display, surface, surface, context);
+}
+
+static void
+bench_tex_image(void *ptr)
+{
+   // Current shm_attach() path, texture respecified on every commit
+   struct data *data = ptr;
+   glBindTexture(GL_TEXTURE_2D, data->texture);
+   glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, data->pitch);
+   glPixelStorei(GL_UNPACK_SKIP_PIXELS_EXT, 0);
+   glPixelStorei(GL_UNPACK_SKIP_ROWS_EXT, 0);
+   glTexImage2D(GL_TEXTURE_2D, 0, GL_BGRA_EXT, data->pitch, data->h, 0, GL_BGRA_EXT, GL_UNSIGNED_BYTE, data->pixels);
+   glFinish();
+}
+
+static void
+bench_tex_sub_image(void *ptr)
+{
+   struct data *data = ptr;
+   glBindTexture(GL_TEXTURE_2D, data->texture);
+   glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, data->pitch);
+   glPixelStorei(GL_UNPACK_SKIP_PIXELS_EXT, 0);
+   glPixelStorei(GL_UNPACK_SKIP_ROWS_EXT, 0);
+   glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, data->w, data->h, GL_BGRA_EXT, GL_UNSIGNED_BYTE, data->pixels);
+   glFinish();
+}
+
+static void
+bench_tex_sub_image_damage(void *ptr)
+{
+   // Only the damaged band, moving down each frame
+   struct data *data = ptr;
+   const uint32_t y = (data->frame++ * data->band) % (data->h - data->band + 1);
+   glBindTexture(GL_TEXTURE_2D, data->texture);
+   glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, data->pitch);
+   glPixelStorei(GL_UNPACK_SKIP_PIXELS_EXT, 0);
+   glPixelStorei(GL_UNPACK_SKIP_ROWS_EXT, y);
+   glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, data->w, data->band, GL_BGRA_EXT, GL_UNSIGNED_BYTE, data->pixels);
+   glFinish();
+}
+
+static void
+run(uint32_t w, uint32_t h)
+{
+   struct data data;
+   memset(&data, 0, sizeof(data));
+   data.w = w;
+   data.h = h;
+   data.pitch = w;
+   data.band = (h / 10 > 0 ? h / 10 : 1);
+
+   if (!(data.pixels = malloc(w * h * 4)))
+      return;
+
+   memset(data.pixels, 0x80, w * h * 4);
+
+   glGenTextures(1, &data.texture);
+   glBindTexture(GL_TEXTURE_2D, data.texture);
+   glTexImage2D(GL_TEXTURE_2D, 0, GL_BGRA_EXT, w, h, 0, GL_BGRA_EXT, GL_UNSIGNED_BYTE, data.pixels);
+
+   char name[64];
+   snprintf(name, sizeof(name), "shm_upload/%ux%u/tex-image", w, h);
+   micro_run(name, bench_tex_image, &data);
+   snprintf(name, sizeof(name), "shm_upload/%ux%u/tex-sub-image", w, h);
+   micro_run(name, bench_tex_sub_image, &data);
+   snprintf(name, sizeof(name), "shm_upload/%ux%u/tex-sub-image-10%%", w, h);
+   micro_run(name, bench_tex_sub_image_damage, &data);
+
+   glDeleteTextures(1, &data.texture);
+   free(data.pixels);
+}
+
+int
+main(int argc, char *argv[])
+{
+   micro_init(argc, argv);
+
+   if (!create_context()) {
+      fprintf(stderr, "micro-shm-upload: could not create offscreen EGL context\n");
+      return EXIT_FAILURE;
+   }
+
+   const char *ext = (const char*)glGetString(GL_EXTENSIONS);
+   if (!ext || !strstr(ext, "GL_EXT_texture_format_BGRA8888") || !strstr(ext, "GL_EXT_unpack_subimage")) {
+      fprintf(stderr, "micro-shm-upload: BGRA textures or unpack subimage not supported\n");
+      return EXIT_FAILURE;
+   }
+
+   run(256, 256);
+   run(1920, 1080);
+   run(3840, 2160);
+   return EXIT_SUCCESS;
+}
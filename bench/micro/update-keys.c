@@ -0,0 +1,55 @@
+// update_keys() pressed key tracking, includes keyboard.c for the static function.
+#include "compositor/seat/keyboard.c"
+#include "micro.h"
+
+struct data {
+   struct wl_array keys;
+   uint32_t key;
+};
+
+static void
+bench_press_release(void *ptr)
+{
+   struct data *data = ptr;
+   micro_sink = update_keys(&data->keys, data->key, WL_KEYBOARD_KEY_STATE_PRESSED);
+   micro_sink += update_keys(&data->keys, data->key, WL_KEYBOARD_KEY_STATE_RELEASED);
+}
+
+static void
+bench_repeat(void *ptr)
+{
+   // Autorepeat from evdev, key already held
+   struct data *data = ptr;
+   micro_sink = update_keys(&data->keys, data->key, WL_KEYBOARD_KEY_STATE_PRESSED);
+}
+
+static void
+run(uint32_t held)
+{
+   struct data data;
+   wl_array_init(&data.keys);
+
+   for (uint32_t i = 0; i < held; ++i)
+      update_keys(&data.keys, 100 + i, WL_KEYBOARD_KEY_STATE_PRESSED);
+
+   char name[64];
+   data.key = 30;
+   snprintf(name, sizeof(name), "update_keys/held-%u/press-release", held);
+   micro_run(name, bench_press_release, &data);
+
+   data.key = (held > 0 ? 100 + held - 1 : 30);
+   snprintf(name, sizeof(name), "update_keys/held-%u/repeat", held);
+   micro_run(name, bench_repeat, &data);
+
+   wl_array_release(&data.keys);
+}
+
+int
+main(int argc, char *argv[])
+{
+   micro_init(argc, argv);
+   run(0);
+   run(5);
+   run(32);
+   return EXIT_SUCCESS;
+}
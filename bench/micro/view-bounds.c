@@ -0,0 +1,86 @@
+// wlc_view_get_bounds() on parent chains of increasing depth, cached and after invalidation.
+#include "internal.h"
+#include "micro.h"
+
+#include "compositor/view.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct data {
+   struct wlc_view *views;
+   uint32_t depth;
+};
+
+static void
+bench_bounds(void *ptr)
+{
+   struct data *data = ptr;
+   struct wlc_geometry bounds, visible;
+   wlc_view_get_bounds(&data->views[data->depth - 1], &bounds, &visible);
+   micro_sink = bounds.origin.x + visible.size.w;
+}
+
+static void
+bench_bounds_all(void *ptr)
+{
+   // What a repaint does, bounds of every view in the chain
+   struct data *data = ptr;
+   struct wlc_geometry bounds, visible;
+   for (uint32_t i = 0; i < data->depth; ++i) {
+      wlc_view_get_bounds(&data->views[i], &bounds, &visible);
+      micro_sink += bounds.origin.x;
+   }
+}
+
+static void
+bench_bounds_invalidated(void *ptr)
+{
+   // Root moved, every view in the chain recomputes
+   struct data *data = ptr;
+   struct wlc_geometry bounds, visible;
+   wlc_view_invalidate_bounds(&data->views[0]);
+   for (uint32_t i = 0; i < data->depth; ++i) {
+      wlc_view_get_bounds(&data->views[i], &bounds, &visible);
+      micro_sink += bounds.origin.x;
+   }
+}
+
+static void
+run(uint32_t depth)
+{
+   struct data data;
+   data.depth = depth;
+   if (!(data.views = calloc(depth, sizeof(struct wlc_view))))
+      return;
+
+   for (uint32_t i = 0; i < depth; ++i) {
+      wl_list_init(&data.views[i].childs);
+      data.views[i].commit.geometry = (struct wlc_geometry){ { 2, 2 }, { 640, 480 } };
+
+      if (i > 0) {
+         data.views[i].parent = &data.views[i - 1];
+         wl_list_insert(&data.views[i - 1].childs, &data.views[i].parent_link);
+      }
+   }
+
+   char name[64];
+   snprintf(name, sizeof(name), "view_get_bounds/depth-%u", depth);
+   micro_run(name, bench_bounds, &data);
+   snprintf(name, sizeof(name), "view_get_bounds/chain-%u", depth);
+   micro_run(name, bench_bounds_all, &data);
+   snprintf(name, sizeof(name), "view_get_bounds/invalidated-%u", depth);
+   micro_run(name, bench_bounds_invalidated, &data);
+   free(data.views);
+}
+
+int
+main(int argc, char *argv[])
+{
+   micro_init(argc, argv);
+   run(1);
+   run(8);
+   run(64);
+   run(512);
+   return EXIT_SUCCESS;
+}
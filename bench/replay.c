@@ -0,0 +1,864 @@
+#include "replay.h"
+#include "client.h"
+#include "scenario.h"
+
+#define WLC_CAPTURE_FORMAT_ONLY
+#include "capture.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <assert.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <wayland-client.h>
+#include "wayland-xdg-shell-client-protocol.h"
+
+#define MAX_ARGS 16
+#define FLUSH_THRESHOLD 32 // requests, keeps the client side connection buffer from overflowing
+#define IDLE_TIMEOUT 100000000 // ns to wait on the compositor before moving on
+
+enum object_type {
+   OBJECT_NONE,
+   OBJECT_SURFACE,
+   OBJECT_REGION,
+   OBJECT_XDG_SURFACE,
+   OBJECT_BUFFER,
+   OBJECT_POINTER,
+   OBJECT_KEYBOARD,
+};
+
+struct buffer {
+   struct wl_buffer *buffer;
+   void *data;
+   size_t size;
+   int32_t width, height, stride;
+   uint32_t format;
+   uint64_t hash;
+};
+
+struct frame {
+   struct frame *next;
+   uint64_t commit_time; // 0 until the surface is committed
+};
+
+// Indexed by the id the captured client chose
+struct object {
+   enum object_type type;
+   void *proxy;
+   struct buffer *buffer;
+   struct frame *frames; // surface, requested since last commit
+   uint32_t serial; // xdg surface, latest configure
+   bool configured; // xdg surface, configure not acked yet
+};
+
+struct client {
+   struct wl_display *display;
+   struct wl_registry *registry;
+   struct wl_compositor *compositor;
+   struct wl_shm *shm;
+   struct xdg_shell *shell;
+   struct wl_seat *seat;
+   struct object **objects;
+   uint32_t num_objects;
+   uint32_t enter_serial;
+   uint32_t unflushed;
+};
+
+static const uint16_t num_args[WLC_CAPTURE_REQUEST_LAST] = {
+   [WLC_CAPTURE_CREATE_SURFACE] = 1,
+   [WLC_CAPTURE_CREATE_REGION] = 1,
+   [WLC_CAPTURE_REGION_DESTROY] = 1,
+   [WLC_CAPTURE_REGION_ADD] = 5,
+   [WLC_CAPTURE_REGION_SUBTRACT] = 5,
+   [WLC_CAPTURE_SURFACE_DESTROY] = 1,
+   [WLC_CAPTURE_SURFACE_ATTACH] = 11,
+   [WLC_CAPTURE_SURFACE_DAMAGE] = 5,
+   [WLC_CAPTURE_SURFACE_FRAME] = 2,
+   [WLC_CAPTURE_SURFACE_OPAQUE_REGION] = 2,
+   [WLC_CAPTURE_SURFACE_INPUT_REGION] = 2,
+   [WLC_CAPTURE_SURFACE_COMMIT] = 1,
+   [WLC_CAPTURE_SURFACE_BUFFER_SCALE] = 2,
+   [WLC_CAPTURE_XDG_GET_SURFACE] = 2,
+   [WLC_CAPTURE_XDG_SURFACE_DESTROY] = 1,
+   [WLC_CAPTURE_XDG_SURFACE_ACK_CONFIGURE] = 2,
+   [WLC_CAPTURE_XDG_SURFACE_WINDOW_GEOMETRY] = 5,
+   [WLC_CAPTURE_SEAT_GET_POINTER] = 1,
+   [WLC_CAPTURE_SEAT_GET_KEYBOARD] = 1,
+   [WLC_CAPTURE_POINTER_SET_CURSOR] = 5,
+};
+
+static struct {
+   struct bench_client_results results;
+   struct bench_latencies latencies;
+   struct client **clients; // indexed by captured client id
+   struct client **polled;
+   struct pollfd *fds;
+   uint32_t num_clients;
+   uint64_t measure_start;
+   uint64_t last_presented; // ns
+   uint32_t pending_frames;
+   bool realtime;
+} replay;
+
+static bool
+measuring(uint64_t time)
+{
+   return (time >= replay.measure_start);
+}
+
+static struct object*
+object_get(struct client *client, uint32_t id, bool create)
+{
+   // Server allocated ids are never captured
+   if (!id || id >= 0xff000000)
+      return NULL;
+
+   if (id >= client->num_objects) {
+      if (!create)
+         return NULL;
+
+      const uint32_t num = (id + 1 > client->num_objects * 2 ? id + 1 : client->num_objects * 2);
+      struct object **objects;
+      if (!(objects = realloc(client->objects, num * sizeof(struct object*))))
+         return NULL;
+
+      memset(objects + client->num_objects, 0, (num - client->num_objects) * sizeof(struct object*));
+      client->objects = objects;
+      client->num_objects = num;
+   }
+
+   if (!client->objects[id] && create)
+      client->objects[id] = calloc(1, sizeof(struct object));
+
+   return client->objects[id];
+}
+
+static void*
+object_proxy(struct client *client, uint32_t id, enum object_type type)
+{
+   struct object *object = object_get(client, id, false);
+   return (object && object->type == type ? object->proxy : NULL);
+}
+
+static void
+buffer_free(struct buffer *buffer)
+{
+   if (buffer->buffer)
+      wl_buffer_destroy(buffer->buffer);
+
+   if (buffer->data)
+      munmap(buffer->data, buffer->size);
+
+   free(buffer);
+}
+
+static void
+object_release(struct client *client, uint32_t id)
+{
+   struct object *object;
+   if (!(object = object_get(client, id, false)))
+      return;
+
+   switch (object->type) {
+      case OBJECT_SURFACE:
+         wl_surface_destroy(object->proxy);
+         break;
+      case OBJECT_REGION:
+         wl_region_destroy(object->proxy);
+         break;
+      case OBJECT_XDG_SURFACE:
+         xdg_surface_destroy(object->proxy);
+         break;
+      case OBJECT_BUFFER:
+         buffer_free(object->buffer);
+         break;
+      case OBJECT_POINTER:
+         wl_pointer_destroy(object->proxy);
+         break;
+      case OBJECT_KEYBOARD:
+         wl_keyboard_destroy(object->proxy);
+         break;
+      case OBJECT_NONE:
+         break;
+   }
+
+   // Frames of uncommitted surfaces are owned by their callbacks
+   free(object);
+   client->objects[id] = NULL;
+}
+
+static struct object*
+object_new(struct client *client, uint32_t id, enum object_type type, void *proxy)
+{
+   object_release(client, id);
+
+   struct object *object;
+   if (!proxy || !(object = object_get(client, id, true)))
+      return NULL;
+
+   object->type = type;
+   object->proxy = proxy;
+   return object;
+}
+
+static struct buffer*
+buffer_new(struct client *client, int32_t width, int32_t height, int32_t stride, uint32_t format)
+{
+   struct buffer *buffer;
+   if (!(buffer = calloc(1, sizeof(struct buffer))))
+      return NULL;
+
+   buffer->size = (size_t)stride * height;
+
+   int fd;
+   if ((fd = bench_create_anonymous_file(buffer->size)) < 0)
+      goto fail;
+
+   if ((buffer->data = mmap(NULL, buffer->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+      buffer->data = NULL;
+      close(fd);
+      goto fail;
+   }
+
+   struct wl_shm_pool *pool = wl_shm_create_pool(client->shm, fd, buffer->size);
+   buffer->buffer = wl_shm_pool_create_buffer(pool, 0, width, height, stride, format);
+   wl_shm_pool_destroy(pool);
+   close(fd);
+
+   buffer->width = width;
+   buffer->height = height;
+   buffer->stride = stride;
+   buffer->format = format;
+
+   // Pool and buffer creation carry a fd each, flush them early
+   client->unflushed += FLUSH_THRESHOLD / 4;
+   return buffer;
+
+fail:
+   buffer_free(buffer);
+   return NULL;
+}
+
+static void
+buffer_fill(struct buffer *buffer, uint64_t hash, const uint8_t *contents, size_t size)
+{
+   if (contents && size == buffer->size) {
+      memcpy(buffer->data, contents, size);
+      return;
+   }
+
+   // Without captured contents every distinct frame gets its own pattern
+   uint64_t x = (hash ? hash : 1), *words = buffer->data;
+   for (size_t i = 0; i < buffer->size / sizeof(uint64_t); ++i) {
+      x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+      words[i] = x;
+   }
+}
+
+static void
+surface_attach(struct client *client, const int32_t *args, const uint8_t *contents)
+{
+   struct wl_surface *surface;
+   if (!(surface = object_proxy(client, args[0], OBJECT_SURFACE)))
+      return;
+
+   if (!args[1]) {
+      wl_surface_attach(surface, NULL, args[2], args[3]);
+      return;
+   }
+
+   // Only shm buffers are described in the capture
+   if (args[4] <= 0 || args[5] <= 0 || args[6] < args[4])
+      return;
+
+   struct object *object = object_get(client, args[1], false);
+   struct buffer *buffer = (object && object->type == OBJECT_BUFFER ? object->buffer : NULL);
+
+   // Captured buffer ids are reused once the client destroys the wl_buffer
+   if (!buffer || buffer->width != args[4] || buffer->height != args[5] || buffer->stride != args[6] || buffer->format != (uint32_t)args[7]) {
+      if (!(buffer = buffer_new(client, args[4], args[5], args[6], args[7])))
+         return;
+
+      if (!(object = object_new(client, args[1], OBJECT_BUFFER, buffer->buffer))) {
+         buffer_free(buffer);
+         return;
+      }
+
+      object->buffer = buffer;
+   }
+
+   const uint64_t hash = (uint64_t)(uint32_t)args[8] | (uint64_t)(uint32_t)args[9] << 32;
+   if (hash != buffer->hash) {
+      buffer_fill(buffer, hash, contents, args[10]);
+      buffer->hash = hash;
+   }
+
+   wl_surface_attach(surface, buffer->buffer, args[2], args[3]);
+}
+
+static void
+frame_done(void *data, struct wl_callback *callback, uint32_t time)
+{
+   (void)time;
+   struct frame *frame = data;
+   wl_callback_destroy(callback);
+
+   const uint64_t now = bench_now_ns();
+   if (frame->commit_time && measuring(frame->commit_time)) {
+      replay.results.presented++;
+      bench_latencies_add(&replay.latencies, (now - frame->commit_time) / 1000);
+   }
+
+   replay.pending_frames--;
+   replay.last_presented = now;
+   free(frame);
+}
+
+static const struct wl_callback_listener frame_listener = {
+   .done = frame_done,
+};
+
+static void
+surface_frame(struct client *client, const int32_t *args)
+{
+   struct object *object = object_get(client, args[0], false);
+   if (!object || object->type != OBJECT_SURFACE)
+      return;
+
+   struct frame *frame;
+   if (!(frame = calloc(1, sizeof(struct frame))))
+      return;
+
+   wl_callback_add_listener(wl_surface_frame(object->proxy), &frame_listener, frame);
+   frame->next = object->frames;
+   object->frames = frame;
+   replay.pending_frames++;
+}
+
+static void
+surface_commit(struct client *client, const int32_t *args)
+{
+   struct object *object = object_get(client, args[0], false);
+   if (!object || object->type != OBJECT_SURFACE)
+      return;
+
+   const uint64_t now = bench_now_ns();
+   for (struct frame *f = object->frames; f; f = f->next)
+      f->commit_time = now;
+
+   object->frames = NULL;
+   wl_surface_commit(object->proxy);
+   replay.results.commits += measuring(now);
+}
+
+static void
+xdg_surface_configure(void *data, struct xdg_surface *xdg_surface, int32_t width, int32_t height, struct wl_array *states, uint32_t serial)
+{
+   (void)xdg_surface, (void)width, (void)height, (void)states;
+   struct object *object = data;
+   object->serial = serial;
+   object->configured = true;
+}
+
+static void
+xdg_surface_close(void *data, struct xdg_surface *xdg_surface)
+{
+   (void)data, (void)xdg_surface;
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+   .configure = xdg_surface_configure,
+   .close = xdg_surface_close,
+};
+
+static void
+pointer_enter(void *data, struct wl_pointer *pointer, uint32_t serial, struct wl_surface *surface, wl_fixed_t x, wl_fixed_t y)
+{
+   (void)pointer, (void)surface, (void)x, (void)y;
+   struct client *client = data;
+   client->enter_serial = serial;
+}
+
+static void
+pointer_leave(void *data, struct wl_pointer *pointer, uint32_t serial, struct wl_surface *surface)
+{
+   (void)data, (void)pointer, (void)serial, (void)surface;
+}
+
+static void
+pointer_motion(void *data, struct wl_pointer *pointer, uint32_t time, wl_fixed_t x, wl_fixed_t y)
+{
+   (void)data, (void)pointer, (void)time, (void)x, (void)y;
+}
+
+static void
+pointer_button(void *data, struct wl_pointer *pointer, uint32_t serial, uint32_t time, uint32_t button, uint32_t state)
+{
+   (void)data, (void)pointer, (void)serial, (void)time, (void)button, (void)state;
+}
+
+static void
+pointer_axis(void *data, struct wl_pointer *pointer, uint32_t time, uint32_t axis, wl_fixed_t value)
+{
+   (void)data, (void)pointer, (void)time, (void)axis, (void)value;
+}
+
+static const struct wl_pointer_listener pointer_listener = {
+   .enter = pointer_enter,
+   .leave = pointer_leave,
+   .motion = pointer_motion,
+   .button = pointer_button,
+   .axis = pointer_axis,
+};
+
+static void
+keyboard_keymap(void *data, struct wl_keyboard *keyboard, uint32_t format, int32_t fd, uint32_t size)
+{
+   (void)data, (void)keyboard, (void)format, (void)size;
+   close(fd);
+}
+
+static void
+keyboard_enter(void *data, struct wl_keyboard *keyboard, uint32_t serial, struct wl_surface *surface, struct wl_array *keys)
+{
+   (void)data, (void)keyboard, (void)serial, (void)surface, (void)keys;
+}
+
+static void
+keyboard_leave(void *data, struct wl_keyboard *keyboard, uint32_t serial, struct wl_surface *surface)
+{
+   (void)data, (void)keyboard, (void)serial, (void)surface;
+}
+
+static void
+keyboard_key(void *data, struct wl_keyboard *keyboard, uint32_t serial, uint32_t time, uint32_t key, uint32_t state)
+{
+   (void)data, (void)keyboard, (void)serial, (void)time, (void)key, (void)state;
+}
+
+static void
+keyboard_modifiers(void *data, struct wl_keyboard *keyboard, uint32_t serial, uint32_t depressed, uint32_t latched, uint32_t locked, uint32_t group)
+{
+   (void)data, (void)keyboard, (void)serial, (void)depressed, (void)latched, (void)locked, (void)group;
+}
+
+static const struct wl_keyboard_listener keyboard_listener = {
+   .keymap = keyboard_keymap,
+   .enter = keyboard_enter,
+   .leave = keyboard_leave,
+   .key = keyboard_key,
+   .modifiers = keyboard_modifiers,
+};
+
+static void
+xdg_shell_ping(void *data, struct xdg_shell *shell, uint32_t serial)
+{
+   (void)data;
+   xdg_shell_pong(shell, serial);
+}
+
+static const struct xdg_shell_listener xdg_shell_listener = {
+   .ping = xdg_shell_ping,
+};
+
+static void
+registry_global(void *data, struct wl_registry *registry, uint32_t name, const char *interface, uint32_t version)
+{
+   struct client *client = data;
+
+   if (!strcmp(interface, "wl_compositor")) {
+      client->compositor = wl_registry_bind(registry, name, &wl_compositor_interface, (version < 3 ? version : 3));
+   } else if (!strcmp(interface, "wl_shm")) {
+      client->shm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
+   } else if (!strcmp(interface, "wl_seat")) {
+      client->seat = wl_registry_bind(registry, name, &wl_seat_interface, 1);
+   } else if (!strcmp(interface, "xdg_shell")) {
+      client->shell = wl_registry_bind(registry, name, &xdg_shell_interface, 1);
+      xdg_shell_use_unstable_version(client->shell, XDG_SHELL_VERSION_CURRENT);
+      xdg_shell_add_listener(client->shell, &xdg_shell_listener, client);
+   }
+}
+
+static void
+registry_global_remove(void *data, struct wl_registry *registry, uint32_t name)
+{
+   (void)data, (void)registry, (void)name;
+}
+
+static const struct wl_registry_listener registry_listener = {
+   .global = registry_global,
+   .global_remove = registry_global_remove,
+};
+
+static bool
+pump(int timeout)
+{
+   uint32_t n = 0;
+   for (uint32_t i = 0; i < replay.num_clients; ++i) {
+      struct client *client;
+      if (!(client = replay.clients[i]))
+         continue;
+
+      while (wl_display_prepare_read(client->display) != 0)
+         wl_display_dispatch_pending(client->display);
+
+      replay.fds[n] = (struct pollfd){ .fd = wl_display_get_fd(client->display), .events = POLLIN };
+
+      if (wl_display_flush(client->display) < 0 && errno == EAGAIN)
+         replay.fds[n].events |= POLLOUT;
+
+      replay.polled[n++] = client;
+   }
+
+   if (!n) {
+      if (timeout > 0)
+         usleep(timeout * 1000);
+      return true;
+   }
+
+   if (poll(replay.fds, n, timeout) < 0) {
+      for (uint32_t i = 0; i < n; ++i)
+         wl_display_cancel_read(replay.polled[i]->display);
+      return (errno == EINTR);
+   }
+
+   for (uint32_t i = 0; i < n; ++i) {
+      if (replay.fds[i].revents & POLLIN) {
+         wl_display_read_events(replay.polled[i]->display);
+      } else {
+         wl_display_cancel_read(replay.polled[i]->display);
+      }
+
+      if (wl_display_dispatch_pending(replay.polled[i]->display) < 0) {
+         fprintf(stderr, "wlc-bench: replayed client lost connection\n");
+         return false;
+      }
+   }
+
+   return true;
+}
+
+static bool
+client_flush(struct client *client)
+{
+   // The connection buffer is small, wait for the compositor instead of overflowing it
+   while (wl_display_flush(client->display) < 0) {
+      if (errno != EAGAIN || !pump(-1))
+         return false;
+   }
+
+   client->unflushed = 0;
+   return true;
+}
+
+static void
+client_free(uint32_t id)
+{
+   struct client *client;
+   if (id >= replay.num_clients || !(client = replay.clients[id]))
+      return;
+
+   for (uint32_t i = 0; i < client->num_objects; ++i)
+      object_release(client, i);
+
+   free(client->objects);
+
+   if (client->display)
+      wl_display_disconnect(client->display);
+
+   free(client);
+   replay.clients[id] = NULL;
+}
+
+static struct client*
+client_new(uint32_t id)
+{
+   if (id >= replay.num_clients) {
+      const uint32_t num = id + 8;
+      struct client **clients;
+      struct client **polled;
+      struct pollfd *fds;
+      if (!(clients = realloc(replay.clients, num * sizeof(struct client*))))
+         return NULL;
+
+      memset(clients + replay.num_clients, 0, (num - replay.num_clients) * sizeof(struct client*));
+      replay.clients = clients;
+
+      if (!(polled = realloc(replay.polled, num * sizeof(struct client*))))
+         return NULL;
+
+      replay.polled = polled;
+
+      if (!(fds = realloc(replay.fds, num * sizeof(struct pollfd))))
+         return NULL;
+
+      replay.fds = fds;
+      replay.num_clients = num;
+   }
+
+   client_free(id);
+
+   struct client *client;
+   if (!(client = calloc(1, sizeof(struct client))))
+      return NULL;
+
+   replay.clients[id] = client;
+
+   if (!(client->display = wl_display_connect(NULL)))
+      goto fail;
+
+   client->registry = wl_display_get_registry(client->display);
+   wl_registry_add_listener(client->registry, &registry_listener, client);
+   wl_display_roundtrip(client->display);
+
+   if (!client->compositor || !client->shm)
+      goto fail;
+
+   return client;
+
+fail:
+   fprintf(stderr, "wlc-bench: replayed client %u failed to connect\n", id);
+   client_free(id);
+   return NULL;
+}
+
+static bool
+wait_configure(struct object *object)
+{
+   // The captured client acked a configure, ack the one we got instead of its serial
+   const uint64_t deadline = bench_now_ns() + IDLE_TIMEOUT;
+   for (uint64_t now = bench_now_ns(); !object->configured && now < deadline; now = bench_now_ns()) {
+      if (!pump((deadline - now + 999999) / 1000000))
+         return false;
+   }
+
+   return true;
+}
+
+static bool
+replay_request(struct client *client, enum wlc_capture_request request, const int32_t *args, const uint8_t *contents)
+{
+   struct object *object;
+   void *proxy, *surface;
+
+   switch (request) {
+      case WLC_CAPTURE_CREATE_SURFACE:
+         object_new(client, args[0], OBJECT_SURFACE, wl_compositor_create_surface(client->compositor));
+         break;
+      case WLC_CAPTURE_CREATE_REGION:
+         object_new(client, args[0], OBJECT_REGION, wl_compositor_create_region(client->compositor));
+         break;
+      case WLC_CAPTURE_REGION_DESTROY:
+      case WLC_CAPTURE_SURFACE_DESTROY:
+      case WLC_CAPTURE_XDG_SURFACE_DESTROY:
+         object_release(client, args[0]);
+         break;
+      case WLC_CAPTURE_REGION_ADD:
+         if ((proxy = object_proxy(client, args[0], OBJECT_REGION)))
+            wl_region_add(proxy, args[1], args[2], args[3], args[4]);
+         break;
+      case WLC_CAPTURE_REGION_SUBTRACT:
+         if ((proxy = object_proxy(client, args[0], OBJECT_REGION)))
+            wl_region_subtract(proxy, args[1], args[2], args[3], args[4]);
+         break;
+      case WLC_CAPTURE_SURFACE_ATTACH:
+         surface_attach(client, args, contents);
+         break;
+      case WLC_CAPTURE_SURFACE_DAMAGE:
+         if ((proxy = object_proxy(client, args[0], OBJECT_SURFACE)))
+            wl_surface_damage(proxy, args[1], args[2], args[3], args[4]);
+         break;
+      case WLC_CAPTURE_SURFACE_FRAME:
+         surface_frame(client, args);
+         break;
+      case WLC_CAPTURE_SURFACE_OPAQUE_REGION:
+         if ((proxy = object_proxy(client, args[0], OBJECT_SURFACE)))
+            wl_surface_set_opaque_region(proxy, object_proxy(client, args[1], OBJECT_REGION));
+         break;
+      case WLC_CAPTURE_SURFACE_INPUT_REGION:
+         if ((proxy = object_proxy(client, args[0], OBJECT_SURFACE)))
+            wl_surface_set_input_region(proxy, object_proxy(client, args[1], OBJECT_REGION));
+         break;
+      case WLC_CAPTURE_SURFACE_COMMIT:
+         surface_commit(client, args);
+         break;
+      case WLC_CAPTURE_SURFACE_BUFFER_SCALE:
+         if ((proxy = object_proxy(client, args[0], OBJECT_SURFACE)) && wl_proxy_get_version(proxy) >= 3)
+            wl_surface_set_buffer_scale(proxy, args[1]);
+         break;
+      case WLC_CAPTURE_XDG_GET_SURFACE:
+         if (!client->shell || !(surface = object_proxy(client, args[1], OBJECT_SURFACE)))
+            break;
+         if ((object = object_new(client, args[0], OBJECT_XDG_SURFACE, xdg_shell_get_xdg_surface(client->shell, surface))))
+            xdg_surface_add_listener(object->proxy, &xdg_surface_listener, object);
+         break;
+      case WLC_CAPTURE_XDG_SURFACE_ACK_CONFIGURE:
+         if (!(object = object_get(client, args[0], false)) || object->type != OBJECT_XDG_SURFACE)
+            break;
+         if (!wait_configure(object))
+            return false;
+         if (object->configured) {
+            xdg_surface_ack_configure(object->proxy, object->serial);
+            object->configured = false;
+         }
+         break;
+      case WLC_CAPTURE_XDG_SURFACE_WINDOW_GEOMETRY:
+         if ((proxy = object_proxy(client, args[0], OBJECT_XDG_SURFACE)))
+            xdg_surface_set_window_geometry(proxy, args[1], args[2], args[3], args[4]);
+         break;
+      case WLC_CAPTURE_SEAT_GET_POINTER:
+         if (client->seat && (object = object_new(client, args[0], OBJECT_POINTER, wl_seat_get_pointer(client->seat))))
+            wl_pointer_add_listener(object->proxy, &pointer_listener, client);
+         break;
+      case WLC_CAPTURE_SEAT_GET_KEYBOARD:
+         if (client->seat && (object = object_new(client, args[0], OBJECT_KEYBOARD, wl_seat_get_keyboard(client->seat))))
+            wl_keyboard_add_listener(object->proxy, &keyboard_listener, client);
+         break;
+      case WLC_CAPTURE_POINTER_SET_CURSOR:
+         if ((proxy = object_proxy(client, args[0], OBJECT_POINTER))) {
+            surface = object_proxy(client, args[2], OBJECT_SURFACE);
+            wl_pointer_set_cursor(proxy, client->enter_serial, surface, args[3], args[4]);
+         }
+         break;
+      default:
+         break;
+   }
+
+   if (++client->unflushed < FLUSH_THRESHOLD && request != WLC_CAPTURE_SURFACE_COMMIT)
+      return true;
+
+   if (!client_flush(client))
+      return false;
+
+   // Keep up with frame callbacks and configures between commits
+   return (replay.realtime || request != WLC_CAPTURE_SURFACE_COMMIT || pump(0));
+}
+
+static bool
+replay_records(const uint8_t *pos, const uint8_t *end, uint64_t start, uint64_t stop)
+{
+   while (pos < end) {
+      struct wlc_capture_record record;
+      if ((size_t)(end - pos) < sizeof(record))
+         goto truncated;
+
+      memcpy(&record, pos, sizeof(record));
+      pos += sizeof(record);
+
+      int32_t args[MAX_ARGS];
+      const size_t args_size = record.nargs * sizeof(int32_t);
+      if (record.nargs > MAX_ARGS || (size_t)(end - pos) < args_size)
+         goto truncated;
+
+      memcpy(args, pos, args_size);
+      pos += args_size;
+
+      const uint8_t *contents = NULL;
+      if (record.request == WLC_CAPTURE_SURFACE_ATTACH && record.nargs >= num_args[WLC_CAPTURE_SURFACE_ATTACH] && args[10] > 0) {
+         if ((size_t)(end - pos) < (size_t)args[10])
+            goto truncated;
+
+         contents = pos;
+         pos += args[10];
+      }
+
+      uint64_t now = bench_now_ns();
+      if (replay.realtime) {
+         const uint64_t target = start + record.time;
+         for (; now < target && now < stop; now = bench_now_ns()) {
+            if (!pump((target - now + 999999) / 1000000))
+               return false;
+         }
+      }
+
+      if (now >= stop)
+         return true;
+
+      if (record.request == WLC_CAPTURE_CLIENT_CONNECT) {
+         client_new(record.client);
+         continue;
+      } else if (record.request == WLC_CAPTURE_CLIENT_DISCONNECT) {
+         client_free(record.client);
+         continue;
+      }
+
+      // Unknown requests are from a newer capture format
+      struct client *client;
+      if (record.client >= replay.num_clients || !(client = replay.clients[record.client]) ||
+          record.request >= WLC_CAPTURE_REQUEST_LAST || record.nargs < num_args[record.request])
+         continue;
+
+      if (!replay_request(client, record.request, args, contents))
+         return false;
+   }
+
+   return true;
+
+truncated:
+   fprintf(stderr, "wlc-bench: capture is truncated, replayed what was complete\n");
+   return true;
+}
+
+bool
+bench_replay_run(const struct bench_scenario *scenario, struct bench_client_results *out_results)
+{
+   assert(scenario && out_results);
+
+   int fd;
+   if ((fd = open(scenario->replay, O_RDONLY | O_CLOEXEC)) < 0) {
+      fprintf(stderr, "wlc-bench: could not open capture %s\n", scenario->replay);
+      return false;
+   }
+
+   struct stat st;
+   const size_t magic = sizeof(WLC_CAPTURE_MAGIC) - 1;
+   uint8_t *data = MAP_FAILED;
+   if (fstat(fd, &st) == 0 && (size_t)st.st_size >= magic)
+      data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+   close(fd);
+
+   if (data == MAP_FAILED || memcmp(data, WLC_CAPTURE_MAGIC, magic)) {
+      fprintf(stderr, "wlc-bench: %s is not a wlc capture\n", scenario->replay);
+      if (data != MAP_FAILED)
+         munmap(data, st.st_size);
+      return false;
+   }
+
+   // Whole capture is mapped up front, so replay never waits for disk
+   madvise(data, st.st_size, MADV_WILLNEED);
+
+   replay.realtime = scenario->realtime;
+
+   const uint64_t start = bench_now_ns();
+   const uint64_t stop = start + (uint64_t)scenario->duration * 1000000000;
+   replay.measure_start = start + (uint64_t)scenario->warmup * 1000000000;
+
+   bool ret = replay_records(data + magic, data + st.st_size, start, stop);
+
+   // Collect the outstanding frames, frames of destroyed surfaces never complete
+   replay.last_presented = bench_now_ns();
+   for (uint64_t now = replay.last_presented; ret && replay.pending_frames > 0 && now < replay.last_presented + IDLE_TIMEOUT; now = bench_now_ns())
+      ret = pump((replay.last_presented + IDLE_TIMEOUT - now + 999999) / 1000000);
+
+   if (ret) {
+      bench_latencies_finish(&replay.latencies, &replay.results);
+      memcpy(out_results, &replay.results, sizeof(struct bench_client_results));
+   }
+
+   for (uint32_t i = 0; i < replay.num_clients; ++i)
+      client_free(i);
+
+   bench_latencies_release(&replay.latencies);
+   free(replay.clients);
+   free(replay.polled);
+   free(replay.fds);
+   munmap(data, st.st_size);
+   return ret;
+}
@@ -0,0 +1,13 @@
+#ifndef _WLC_BENCH_REPLAY_H_
+#define _WLC_BENCH_REPLAY_H_
+
+#include <stdbool.h>
+
+struct bench_scenario;
+struct bench_client_results;
+
+// Replays the clients captured with WLC_CAPTURE against $WAYLAND_DISPLAY.
+// Results are measured like the synthetic clients, commit to frame callback done.
+bool bench_replay_run(const struct bench_scenario *scenario, struct bench_client_results *out_results);
+
+#endif /* _WLC_BENCH_REPLAY_H_ */
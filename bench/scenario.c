@@ -0,0 +1,168 @@
+#include "scenario.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <assert.h>
+
+static char*
+strip(char *str)
+{
+   char *end;
+   while (isspace(*str))
+      ++str;
+
+   for (end = str + strlen(str); end > str && isspace(end[-1]); --end);
+   *end = 0;
+   return str;
+}
+
+static bool
+parse_uint(const char *value, uint32_t *out)
+{
+   char *end;
+   unsigned long v = strtoul(value, &end, 10);
+   if (end == value || *end)
+      return false;
+
+   *out = v;
+   return true;
+}
+
+static bool
+parse_size(const char *value, struct wlc_size *out)
+{
+   int n = 0;
+   return (sscanf(value, "%ux%u%n", &out->w, &out->h, &n) == 2 && !value[n] && out->w > 0 && out->h > 0);
+}
+
+static bool
+set_global(struct bench_scenario *scenario, const char *key, const char *value)
+{
+   if (!strcmp(key, "name")) {
+      snprintf(scenario->name, sizeof(scenario->name), "%s", value);
+      return true;
+   } else if (!strcmp(key, "mode")) {
+      snprintf(scenario->mode, sizeof(scenario->mode), "%s", value);
+      return true;
+   } else if (!strcmp(key, "duration")) {
+      return parse_uint(value, &scenario->duration) && scenario->duration > 0;
+   } else if (!strcmp(key, "warmup")) {
+      return parse_uint(value, &scenario->warmup);
+   } else if (!strcmp(key, "outputs")) {
+      return parse_uint(value, &scenario->outputs) && scenario->outputs > 0;
+   } else if (!strcmp(key, "resize")) {
+      return parse_uint(value, &scenario->resize);
+   } else if (!strcmp(key, "pointer")) {
+      return parse_uint(value, &scenario->pointer);
+   } else if (!strcmp(key, "replay")) {
+      snprintf(scenario->replay, sizeof(scenario->replay), "%s", value);
+      return (*value != 0);
+   } else if (!strcmp(key, "realtime")) {
+      uint32_t realtime;
+      if (!parse_uint(value, &realtime) || realtime > 1)
+         return false;
+
+      scenario->realtime = realtime;
+      return true;
+   } else if (!strcmp(key, "transaction")) {
+      uint32_t transaction;
+      if (!parse_uint(value, &transaction) || transaction > 1)
+         return false;
+
+      scenario->transaction = transaction;
+      return true;
+   }
+
+   return false;
+}
+
+static bool
+set_group(struct bench_group *group, const char *key, const char *value)
+{
+   if (!strcmp(key, "count")) {
+      return parse_uint(value, &group->count);
+   } else if (!strcmp(key, "size")) {
+      return parse_size(value, &group->size);
+   } else if (!strcmp(key, "rate")) {
+      return parse_uint(value, &group->rate);
+   } else if (!strcmp(key, "damage")) {
+      if (!strcmp(value, "full")) {
+         group->damage = 100;
+         return true;
+      }
+      return parse_uint(value, &group->damage) && group->damage > 0 && group->damage <= 100;
+   } else if (!strcmp(key, "buffers")) {
+      return parse_uint(value, &group->buffers) && group->buffers > 0 && group->buffers <= 3;
+   }
+
+   return false;
+}
+
+bool
+bench_scenario_load(struct bench_scenario *scenario, const char *path)
+{
+   assert(scenario && path);
+
+   memset(scenario, 0, sizeof(struct bench_scenario));
+   snprintf(scenario->name, sizeof(scenario->name), "%s", path);
+   scenario->duration = 10;
+   scenario->warmup = 1;
+   scenario->outputs = 1;
+
+   FILE *f;
+   if (!(f = fopen(path, "r"))) {
+      fprintf(stderr, "wlc-bench: could not open scenario %s\n", path);
+      return false;
+   }
+
+   char buf[256];
+   uint32_t line = 0;
+   struct bench_group *group = NULL;
+   while (fgets(buf, sizeof(buf), f)) {
+      ++line;
+
+      char *comment;
+      if ((comment = strchr(buf, '#')))
+         *comment = 0;
+
+      char *str = strip(buf);
+      if (!*str)
+         continue;
+
+      if (!strcmp(str, "[clients]")) {
+         if (scenario->num_groups >= BENCH_MAX_GROUPS)
+            goto error;
+
+         group = &scenario->groups[scenario->num_groups++];
+         *group = (struct bench_group){ 1, { 320, 240 }, 60, 100, 2 };
+         continue;
+      }
+
+      char *value;
+      if (!(value = strchr(str, '=')))
+         goto error;
+
+      *value = 0;
+      const char *key = strip(str);
+      value = strip(value + 1);
+
+      if (!(group ? set_group(group, key, value) : set_global(scenario, key, value)))
+         goto error;
+   }
+
+   fclose(f);
+
+   if (scenario->warmup >= scenario->duration) {
+      fprintf(stderr, "wlc-bench: %s: warmup must be shorter than duration\n", path);
+      return false;
+   }
+
+   return true;
+
+error:
+   fprintf(stderr, "wlc-bench: %s:%u: invalid line\n", path, line);
+   fclose(f);
+   return false;
+}
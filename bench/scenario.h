@@ -0,0 +1,45 @@
+#ifndef _WLC_BENCH_SCENARIO_H_
+#define _WLC_BENCH_SCENARIO_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <wlc.h>
+
+#define BENCH_MAX_GROUPS 8
+
+/**
+ * Scenario files are "key = value" lines, # starts a comment.
+ * Global keys: name, duration, warmup, outputs, mode, resize, transaction, pointer, replay, realtime.
+ * Each [clients] section adds a group with keys: count, size, rate, damage, buffers.
+ * With replay = session.wlcap the clients of a WLC_CAPTURE session are replayed instead,
+ * as fast as possible or with realtime = 1 at the captured pace. Duration caps the replay.
+ * See bench/scenarios for examples.
+ */
+
+// One [clients] section, count identical synthetic shm clients.
+struct bench_group {
+   uint32_t count;
+   struct wlc_size size;
+   uint32_t rate; // commits per second, 0 commits on each frame callback
+   uint32_t damage; // percentage of surface damaged per commit
+   uint32_t buffers; // number of buffers cycled (1-3)
+};
+
+struct bench_scenario {
+   char name[64];
+   char mode[128]; // WLC_HEADLESS_MODE
+   uint32_t duration, warmup; // seconds
+   uint32_t outputs;
+   uint32_t resize; // compositor resizes every view this many times per second
+   bool transaction; // resizes are done in a layout transaction
+   uint32_t pointer; // pointer motion events per second
+   char replay[256]; // capture file, replaces the groups
+   bool realtime; // replay with captured timing
+   struct bench_group groups[BENCH_MAX_GROUPS];
+   uint32_t num_groups;
+};
+
+bool bench_scenario_load(struct bench_scenario *scenario, const char *path);
+
+#endif /* _WLC_BENCH_SCENARIO_H_ */
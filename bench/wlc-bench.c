@@ -0,0 +1,338 @@
+#include "scenario.h"
+#include "client.h"
+#include "replay.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <signal.h>
+#include <math.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <wlc.h>
+#include <wayland-util.h>
+
+/**
+ * wlc-bench [-o results.json] scenario.scn
+ *
+ * Runs a compositor on the headless backend, loads it with the synthetic
+ * clients described by the scenario and prints the results as JSON.
+ * Clients run in a separate process (wlc-bench --driver fd scenario.scn).
+ * Scenarios with replay = session.wlcap replay a session captured with WLC_CAPTURE instead.
+ */
+
+struct sample {
+   struct timeval cpu;
+   uint64_t frames;
+   uint64_t time; // ms
+};
+
+static struct {
+   struct bench_scenario scenario;
+   struct wlc_compositor *compositor;
+   struct wlc_event_source *tick, *pointer, *resize, *warmup;
+   struct bench_client_results results;
+   struct sample start, end;
+   pid_t driver;
+   int result_fd;
+   uint32_t resizes;
+   bool driver_ok;
+} bench;
+
+static uint64_t
+now_ms(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void
+take_sample(struct sample *out)
+{
+   struct rusage usage;
+   getrusage(RUSAGE_SELF, &usage);
+   timeradd(&usage.ru_utime, &usage.ru_stime, &out->cpu);
+   out->time = now_ms();
+   out->frames = 0;
+
+   struct wlc_output *output;
+   wlc_output_for_each(output, wlc_compositor_get_outputs(bench.compositor))
+      out->frames += wlc_headless_get_frames(output);
+}
+
+static void
+layout_output(struct wlc_output *output, bool alternate)
+{
+   struct wlc_space *space = wlc_output_get_active_space(output);
+   const struct wlc_size *resolution = wlc_output_get_resolution(output);
+
+   uint32_t count = 0;
+   struct wlc_view *view;
+   wlc_view_for_each(view, wlc_space_get_views(space))
+      ++count;
+
+   if (!count)
+      return;
+
+   // Grid, alternate layout shrinks each cell to force a resize on every view
+   const uint32_t cols = ceil(sqrt(count)), rows = (count + cols - 1) / cols;
+   const uint32_t w = resolution->w / cols, h = resolution->h / rows;
+
+   uint32_t i = 0;
+   wlc_view_for_each(view, wlc_space_get_views(space)) {
+      struct wlc_geometry g = { { (i % cols) * w, (i / cols) * h }, { (alternate ? w * 3 / 4 : w), (alternate ? h * 3 / 4 : h) } };
+      wlc_view_set_geometry(view, &g);
+      ++i;
+   }
+}
+
+static bool
+view_created(struct wlc_compositor *compositor, struct wlc_view *view, struct wlc_space *space)
+{
+   wlc_view_set_state(view, WLC_BIT_ACTIVATED, true);
+   wlc_compositor_focus_view(compositor, view);
+   layout_output(wlc_space_get_output(space), false);
+   return true;
+}
+
+static void
+view_geometry_request(struct wlc_compositor *compositor, struct wlc_view *view, const struct wlc_geometry *geometry)
+{
+   (void)compositor, (void)view, (void)geometry;
+   // Layout is fixed, clients get configured by layout_output
+}
+
+static int
+cb_resize(void *data)
+{
+   (void)data;
+   ++bench.resizes;
+
+   struct wlc_output *output;
+   if (bench.scenario.transaction)
+      wlc_compositor_begin_transaction(bench.compositor);
+
+   wlc_output_for_each(output, wlc_compositor_get_outputs(bench.compositor))
+      layout_output(output, bench.resizes & 1);
+
+   if (bench.scenario.transaction)
+      wlc_compositor_commit_transaction(bench.compositor, 0);
+
+   wlc_event_source_timer_update(bench.resize, fmax(1000 / bench.scenario.resize, 1));
+   return 0;
+}
+
+static int
+cb_pointer(void *data)
+{
+   (void)data;
+
+   struct wlc_output *output;
+   if (!(output = wlc_compositor_get_focused_output(bench.compositor)))
+      return 0;
+
+   // Lissajous curve covering the whole output
+   const struct wlc_size *resolution = wlc_output_get_resolution(output);
+   const double t = now_ms() / 1000.0;
+   struct wlc_origin pos = {
+      (resolution->w / 2) * (1 + sin(t * 3.0)),
+      (resolution->h / 2) * (1 + sin(t * 4.0)),
+   };
+
+   wlc_headless_pointer_motion(&pos, now_ms());
+   wlc_event_source_timer_update(bench.pointer, fmax(1000 / bench.scenario.pointer, 1));
+   return 0;
+}
+
+static int
+cb_warmup(void *data)
+{
+   (void)data;
+   take_sample(&bench.start);
+   return 0;
+}
+
+static int
+cb_tick(void *data)
+{
+   (void)data;
+
+   int status;
+   if (waitpid(bench.driver, &status, WNOHANG) != bench.driver) {
+      wlc_event_source_timer_update(bench.tick, 100);
+      return 0;
+   }
+
+   take_sample(&bench.end);
+   bench.driver_ok = (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS &&
+                      read(bench.result_fd, &bench.results, sizeof(bench.results)) == sizeof(bench.results));
+   wlc_terminate();
+   return 0;
+}
+
+static bool
+spawn_driver(const char *scenario)
+{
+   int fds[2];
+   if (pipe(fds) != 0)
+      return false;
+
+   if ((bench.driver = fork()) < 0)
+      return false;
+
+   if (bench.driver == 0) {
+      close(fds[0]);
+      char fd[16];
+      snprintf(fd, sizeof(fd), "%d", fds[1]);
+      execl("/proc/self/exe", "wlc-bench", "--driver", fd, scenario, NULL);
+      _exit(EXIT_FAILURE);
+   }
+
+   close(fds[1]);
+   bench.result_fd = fds[0];
+   return true;
+}
+
+static int
+run_driver(int fd, const char *path)
+{
+   struct bench_scenario scenario;
+   if (!bench_scenario_load(&scenario, path))
+      return EXIT_FAILURE;
+
+   struct bench_client_results results;
+   if (!(*scenario.replay ? bench_replay_run(&scenario, &results) : bench_clients_run(&scenario, &results)))
+      return EXIT_FAILURE;
+
+   if (write(fd, &results, sizeof(results)) != sizeof(results))
+      return EXIT_FAILURE;
+
+   return EXIT_SUCCESS;
+}
+
+static void
+print_results(FILE *out)
+{
+   struct rusage usage;
+   getrusage(RUSAGE_SELF, &usage);
+
+   struct timeval cpu;
+   timersub(&bench.end.cpu, &bench.start.cpu, &cpu);
+
+   const double seconds = (bench.end.time - bench.start.time) / 1000.0;
+   const uint64_t frames = bench.end.frames - bench.start.frames;
+   const double cpu_us = cpu.tv_sec * 1e6 + cpu.tv_usec;
+
+   fprintf(out, "{\n");
+   fprintf(out, "   \"scenario\": \"%s\",\n", bench.scenario.name);
+   fprintf(out, "   \"outputs\": %u,\n", bench.scenario.outputs);
+   fprintf(out, "   \"seconds\": %.3f,\n", seconds);
+   fprintf(out, "   \"frames\": %llu,\n", (unsigned long long)frames);
+   fprintf(out, "   \"fps\": %.2f,\n", (seconds > 0 ? frames / seconds / bench.scenario.outputs : 0));
+   fprintf(out, "   \"cpu_us_per_frame\": %.2f,\n", (frames > 0 ? cpu_us / frames : 0));
+   fprintf(out, "   \"commits\": %llu,\n", (unsigned long long)bench.results.commits);
+   fprintf(out, "   \"presented\": %llu,\n", (unsigned long long)bench.results.presented);
+   fprintf(out, "   \"starved\": %llu,\n", (unsigned long long)bench.results.starved);
+   fprintf(out, "   \"latency_us\": { \"p50\": %u, \"p90\": %u, \"p99\": %u, \"max\": %u },\n",
+           bench.results.latency_p50, bench.results.latency_p90, bench.results.latency_p99, bench.results.latency_max);
+   fprintf(out, "   \"peak_rss_kb\": %ld\n", usage.ru_maxrss);
+   fprintf(out, "}\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+   if (argc == 4 && !strcmp(argv[1], "--driver"))
+      return run_driver(atoi(argv[2]), argv[3]);
+
+   const char *output = NULL, *path = NULL;
+   for (int i = 1; i < argc; ++i) {
+      if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+         output = argv[++i];
+      } else if (!strcmp(argv[i], "--log") && i + 1 < argc) {
+         ++i; // handled by wlc_init
+      } else {
+         path = argv[i];
+      }
+   }
+
+   if (!path) {
+      fprintf(stderr, "usage: %s [-o results.json] [--log file] scenario.scn\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   if (!bench_scenario_load(&bench.scenario, path))
+      return EXIT_FAILURE;
+
+   char outputs[16];
+   snprintf(outputs, sizeof(outputs), "%u", bench.scenario.outputs);
+   setenv("WLC_OUTPUTS", outputs, true);
+   setenv("WLC_HEADLESS", "1", true);
+   setenv("WLC_XWAYLAND", "0", true);
+
+   if (*bench.scenario.mode)
+      setenv("WLC_HEADLESS_MODE", bench.scenario.mode, true);
+
+   static const struct wlc_interface interface = {
+      .view = {
+         .created = view_created,
+         .request = {
+            .geometry = view_geometry_request,
+         },
+      },
+   };
+
+   if (!wlc_init(&interface, argc, argv))
+      return EXIT_FAILURE;
+
+   if (!(bench.compositor = wlc_compositor_new(NULL)))
+      return EXIT_FAILURE;
+
+   if (!spawn_driver(path)) {
+      fprintf(stderr, "wlc-bench: failed to spawn client driver\n");
+      return EXIT_FAILURE;
+   }
+
+   bench.tick = wlc_event_loop_add_timer(cb_tick, NULL);
+   bench.warmup = wlc_event_loop_add_timer(cb_warmup, NULL);
+   wlc_event_source_timer_update(bench.tick, 100);
+   take_sample(&bench.start);
+
+   if (bench.scenario.warmup > 0)
+      wlc_event_source_timer_update(bench.warmup, bench.scenario.warmup * 1000);
+
+   if (bench.scenario.pointer > 0) {
+      bench.pointer = wlc_event_loop_add_timer(cb_pointer, NULL);
+      wlc_event_source_timer_update(bench.pointer, 1);
+   }
+
+   if (bench.scenario.resize > 0) {
+      bench.resize = wlc_event_loop_add_timer(cb_resize, NULL);
+      wlc_event_source_timer_update(bench.resize, fmax(1000 / bench.scenario.resize, 1));
+   }
+
+   wlc_run();
+
+   if (!bench.driver_ok) {
+      fprintf(stderr, "wlc-bench: client driver failed\n");
+      return EXIT_FAILURE;
+   }
+
+   FILE *out = stdout;
+   if (output && !(out = fopen(output, "w"))) {
+      fprintf(stderr, "wlc-bench: could not open %s\n", output);
+      return EXIT_FAILURE;
+   }
+
+   print_results(out);
+
+   if (out != stdout)
+      fclose(out);
+
+   return EXIT_SUCCESS;
+}
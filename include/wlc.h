@@ -21,6 +21,7 @@ struct wlc_compositor;
 struct wlc_view;
 struct wlc_output;
 struct wlc_space;
+struct wlc_event_source;
 struct wl_list;
 
 struct wlc_origin {
@@ -61,6 +62,46 @@ enum wlc_view_type_bit {
    WLC_BIT_POPUP = 1<<4, // xdg-shell, wl-shell popups
 };
 
+/** wlc_view_get_client_usage(), wlc_set_client_limits() */
+struct wlc_client_usage {
+   uint32_t surfaces, regions, callbacks, buffers, images;
+   uint64_t shm_bytes, gpu_bytes;
+};
+
+/** wlc_output_get_input_latency(), counted since the output was created.
+ *  Bucket i holds samples of [2^i, 2^(i+1)) microseconds, the first and last buckets are open ended. */
+#define WLC_INPUT_LATENCY_BUCKETS 20
+struct wlc_input_latency {
+   uint64_t dispatch[WLC_INPUT_LATENCY_BUCKETS]; // input arrival to sent to the focused client
+   uint64_t present[WLC_INPUT_LATENCY_BUCKETS]; // sent to the client to the next frame presented after it
+};
+
+/** wlc_get_startup_profile(), phases run during wlc_init and wlc_compositor_new. */
+enum wlc_startup_phase {
+   WLC_STARTUP_TTY,
+   WLC_STARTUP_FD, // fork of the privileged fd process
+   WLC_STARTUP_DISPLAY,
+   WLC_STARTUP_UDEV,
+   WLC_STARTUP_INPUT, // libinput and opening the seat's devices
+   WLC_STARTUP_XWAYLAND, // X11 sockets, Xwayland itself is spawned on the first X11 client
+   WLC_STARTUP_BACKEND, // drm/gbm, x11 or headless, includes the outputs created by it
+   WLC_STARTUP_CONTEXT, // EGL, summed over outputs
+   WLC_STARTUP_RENDER, // GLES and shaders, summed over outputs
+   WLC_STARTUP_FIRST_FRAME, // end of the last phase to the first frame presented
+   WLC_STARTUP_LAST
+};
+
+struct wlc_startup_profile {
+   uint64_t phase[WLC_STARTUP_LAST]; // microseconds, zero if the phase did not run
+   uint64_t total; // wlc_init to the first frame presented, zero until then
+};
+
+/** wlc_set_client_limits() */
+enum wlc_client_limit_action {
+   WLC_CLIENT_LIMIT_LOG,
+   WLC_CLIENT_LIMIT_REJECT,
+};
+
 /** mods in interface.keyboard.key function */
 enum wlc_modifier_bit {
    WLC_BIT_MOD_SHIFT = 1<<0,
@@ -147,6 +188,21 @@ void wlc_set_log_file(FILE *out);
 WLC_LOG_ATTR(2, 3) void wlc_log(const enum wlc_log_type type, const char *fmt, ...);
 void wlc_vlog(const enum wlc_log_type type, const char *fmt, va_list ap);
 
+/** Time spent in each startup phase, see enum wlc_startup_phase. */
+void wlc_get_startup_profile(struct wlc_startup_profile *out_profile);
+
+/** Timers on the compositor event loop, callback return value is ignored. */
+struct wlc_event_source* wlc_event_loop_add_timer(int (*cb)(void *userdata), void *userdata);
+bool wlc_event_source_timer_update(struct wlc_event_source *source, int32_t ms_delay);
+void wlc_event_source_remove(struct wlc_event_source *source);
+
+/** Soft limits of resources per client, zero fields are unlimited and NULL clears all limits.
+ *  Exceeding a limit is logged once, WLC_CLIENT_LIMIT_REJECT also disconnects the client with no_memory. */
+void wlc_set_client_limits(const struct wlc_client_usage *limits, enum wlc_client_limit_action action);
+
+/** Write recorded trace as Chrome trace JSON, NULL path uses WLC_TRACE env variable. */
+bool wlc_trace_export(const char *path);
+
 void wlc_output_get_pixels(struct wlc_output *output, void (*async)(const struct wlc_size *size, uint8_t *rgba));
 void wlc_output_set_resolution(struct wlc_output *output, const struct wlc_size *resolution);
 const struct wlc_size* wlc_output_get_resolution(struct wlc_output *output);
@@ -157,6 +213,13 @@ struct wlc_output* wlc_output_from_link(struct wl_list *output_link);
 void wlc_output_set_userdata(struct wlc_output *output, void *userdata);
 void* wlc_output_get_userdata(struct wlc_output *output);
 void wlc_output_focus_space(struct wlc_output *output, struct wlc_space *space);
+void wlc_output_get_input_latency(struct wlc_output *output, struct wlc_input_latency *out_latency);
+
+/** Virtual output hotplug, only works with the headless backend (WLC_HEADLESS=1). */
+bool wlc_headless_add_output(const struct wlc_size *resolution, uint32_t refresh, int32_t scale);
+bool wlc_headless_remove_output(struct wlc_output *output);
+uint64_t wlc_headless_get_frames(struct wlc_output *output);
+void wlc_headless_pointer_motion(const struct wlc_origin *pos, uint32_t time);
 
 struct wlc_output* wlc_space_get_output(struct wlc_space *space);
 struct wl_list* wlc_space_get_views(struct wlc_space *space);
@@ -175,6 +238,7 @@ void wlc_view_set_space(struct wlc_view *view, struct wlc_space *space);
 struct wlc_space* wlc_view_get_space(struct wlc_view *view);
 uint32_t wlc_view_get_type(struct wlc_view *view);
 uint32_t wlc_view_get_state(struct wlc_view *view);
+bool wlc_view_get_scanout(struct wlc_view *view);
 void wlc_view_set_state(struct wlc_view *view, enum wlc_view_state_bit state, bool toggle);
 const struct wlc_geometry* wlc_view_get_geometry(struct wlc_view *view);
 void wlc_view_set_geometry(struct wlc_view *view, const struct wlc_geometry *geometry);
@@ -190,6 +254,7 @@ struct wlc_view* wlc_view_from_user_link(struct wl_list *view_link);
 void wlc_view_set_parent(struct wlc_view *view, struct wlc_view *parent);
 struct wlc_view* wlc_view_get_parent(struct wlc_view *view);
 void wlc_view_set_userdata(struct wlc_view *view, void *userdata);
+bool wlc_view_get_client_usage(struct wlc_view *view, struct wlc_client_usage *out_usage);
 void* wlc_view_get_userdata(struct wlc_view *view);
 
 struct wl_list* wlc_compositor_get_outputs(struct wlc_compositor *compositor);
@@ -198,6 +263,13 @@ struct wlc_space* wlc_compositor_get_focused_space(struct wlc_compositor *compos
 
 void wlc_compositor_focus_view(struct wlc_compositor *compositor, struct wlc_view *view);
 void wlc_compositor_focus_output(struct wlc_compositor *compositor, struct wlc_output *output);
+
+/** Layout transactions, view geometry and state set between begin and commit are presented in a single frame.
+ *  Configures are sent together on commit, outputs showing the views skip repaints until every client committed
+ *  its new size or timeout_ms passes (0 uses 200 ms). Begin and commit nest, the outermost commit applies. */
+void wlc_compositor_begin_transaction(struct wlc_compositor *compositor);
+void wlc_compositor_commit_transaction(struct wlc_compositor *compositor, uint32_t timeout_ms);
+
 struct wlc_compositor* wlc_compositor_new(void *userdata);
 
 /**
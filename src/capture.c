@@ -0,0 +1,238 @@
+#include "internal.h"
+#include "capture.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include <wayland-server.h>
+
+// Records the requests wlc implements itself, so the session can be replayed with wlc-bench.
+//
+// Enable with WLC_CAPTURE=path/to/session.wlcap.
+// By default only a hash of the shm buffer contents is stored on attach,
+// WLC_CAPTURE_SHM=contents stores the pixels too.
+
+#define MAX_ARGS 16
+
+// Found from the wl_client through its destroy listener.
+struct capture_client {
+   struct wl_listener destroy;
+   uint32_t id;
+   struct wl_list link;
+};
+
+bool wlc_capture_active;
+
+// FIXME: contains global state
+
+static struct {
+   struct wl_list clients;
+   FILE *file;
+   uint64_t start;
+   uint32_t next_id;
+   bool contents;
+} capture;
+
+static uint64_t
+now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+write_record(uint32_t client, enum wlc_capture_request request, uint32_t nargs, const int32_t *args)
+{
+   const struct wlc_capture_record record = {
+      .time = now() - capture.start,
+      .client = client,
+      .request = request,
+      .nargs = nargs,
+   };
+
+   if (fwrite(&record, sizeof(record), 1, capture.file) != 1 ||
+       (nargs > 0 && fwrite(args, sizeof(int32_t), nargs, capture.file) != nargs)) {
+      wlc_log(WLC_LOG_WARN, "Failed to write capture record, stopping capture");
+      wlc_capture_active = false;
+   }
+}
+
+static void
+cb_client_destroy(struct wl_listener *listener, void *data)
+{
+   (void)data;
+   struct capture_client *client = wl_container_of(listener, client, destroy);
+
+   if (wlc_capture_active)
+      write_record(client->id, WLC_CAPTURE_CLIENT_DISCONNECT, 0, NULL);
+
+   wl_list_remove(&client->link);
+   free(client);
+}
+
+static uint32_t
+client_id(struct wl_client *wl_client)
+{
+   struct capture_client *client;
+   struct wl_listener *listener;
+   if ((listener = wl_client_get_destroy_listener(wl_client, cb_client_destroy))) {
+      client = wl_container_of(listener, client, destroy);
+      return client->id;
+   }
+
+   if (!(client = calloc(1, sizeof(struct capture_client))))
+      return 0;
+
+   client->id = ++capture.next_id;
+   client->destroy.notify = cb_client_destroy;
+   wl_client_add_destroy_listener(wl_client, &client->destroy);
+
+   // Kept only to detach the listeners when capture stops
+   wl_list_insert(&capture.clients, &client->link);
+   write_record(client->id, WLC_CAPTURE_CLIENT_CONNECT, 0, NULL);
+   return client->id;
+}
+
+static uint64_t
+hash(const uint8_t *data, size_t size)
+{
+   // FNV-1a over 64 bit words, good enough to tell frames apart
+   uint64_t h = 0xcbf29ce484222325;
+   size_t i = 0;
+   for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+      uint64_t word;
+      memcpy(&word, data + i, sizeof(word));
+      h = (h ^ word) * 0x100000001b3;
+   }
+
+   for (; i < size; ++i)
+      h = (h ^ data[i]) * 0x100000001b3;
+
+   return h;
+}
+
+void
+wlc_capture_request(struct wl_client *wl_client, enum wlc_capture_request request, uint32_t nargs, ...)
+{
+   uint32_t id;
+   if (!capture.file || !(id = client_id(wl_client)))
+      return;
+
+   int32_t args[MAX_ARGS];
+   nargs = (nargs > MAX_ARGS ? MAX_ARGS : nargs);
+
+   va_list argp;
+   va_start(argp, nargs);
+   for (uint32_t i = 0; i < nargs; ++i)
+      args[i] = va_arg(argp, int32_t);
+   va_end(argp);
+
+   write_record(id, request, nargs, args);
+}
+
+void
+wlc_capture_attach(struct wl_client *wl_client, struct wl_resource *surface, struct wl_resource *buffer, int32_t x, int32_t y)
+{
+   if (!wlc_capture_active)
+      return;
+
+   uint32_t id;
+   if (!capture.file || !(id = client_id(wl_client)))
+      return;
+
+   int32_t args[11] = {
+      wl_resource_get_id(surface),
+      (buffer ? (int32_t)wl_resource_get_id(buffer) : 0),
+      x, y,
+   };
+
+   // wl_shm lives in libwayland, buffers are described where we first see their contents.
+   // Other buffers are recorded without a size and skipped on replay.
+   struct wl_shm_buffer *shm_buffer;
+   const void *data = NULL;
+   if (buffer && (shm_buffer = wl_shm_buffer_get(buffer))) {
+      args[4] = wl_shm_buffer_get_width(shm_buffer);
+      args[5] = wl_shm_buffer_get_height(shm_buffer);
+      args[6] = wl_shm_buffer_get_stride(shm_buffer);
+      args[7] = wl_shm_buffer_get_format(shm_buffer);
+
+      const size_t size = (size_t)args[6] * args[5];
+      wl_shm_buffer_begin_access(shm_buffer);
+      data = wl_shm_buffer_get_data(shm_buffer);
+      const uint64_t h = hash(data, size);
+      args[8] = (int32_t)(uint32_t)h;
+      args[9] = (int32_t)(uint32_t)(h >> 32);
+      args[10] = (capture.contents ? (int32_t)size : 0);
+
+      write_record(id, WLC_CAPTURE_SURFACE_ATTACH, 11, args);
+
+      if (args[10] > 0 && fwrite(data, 1, size, capture.file) != size) {
+         wlc_log(WLC_LOG_WARN, "Failed to write buffer contents, stopping capture");
+         wlc_capture_active = false;
+      }
+
+      wl_shm_buffer_end_access(shm_buffer);
+      return;
+   }
+
+   write_record(id, WLC_CAPTURE_SURFACE_ATTACH, 11, args);
+}
+
+void
+wlc_capture_terminate(void)
+{
+   if (!capture.file)
+      return;
+
+   wlc_capture_active = false;
+
+   // Clients still alive will not be disconnected in the capture
+   struct capture_client *c, *cn;
+   wl_list_for_each_safe(c, cn, &capture.clients, link) {
+      wl_list_remove(&c->destroy.link);
+      wl_list_remove(&c->link);
+      free(c);
+   }
+
+   if (fclose(capture.file) != 0)
+      wlc_log(WLC_LOG_WARN, "Failed to finish capture");
+
+   memset(&capture, 0, sizeof(capture));
+}
+
+bool
+wlc_capture_init(void)
+{
+   const char *path;
+   if (!(path = getenv("WLC_CAPTURE")) || !*path)
+      return true;
+
+   if (!(capture.file = fopen(path, "wbe")))
+      goto fail;
+
+   // Large buffer, captures are mostly small records
+   setvbuf(capture.file, NULL, _IOFBF, 1024 * 1024);
+
+   if (fwrite(WLC_CAPTURE_MAGIC, 1, sizeof(WLC_CAPTURE_MAGIC) - 1, capture.file) != sizeof(WLC_CAPTURE_MAGIC) - 1)
+      goto write_fail;
+
+   const char *shm = getenv("WLC_CAPTURE_SHM");
+   capture.contents = (shm && !strcmp(shm, "contents"));
+   capture.start = now();
+   wl_list_init(&capture.clients);
+
+   wlc_capture_active = true;
+   wlc_log(WLC_LOG_INFO, "Capturing protocol to %s%s", path, (capture.contents ? " with buffer contents" : ""));
+   return true;
+
+write_fail:
+   fclose(capture.file);
+   capture.file = NULL;
+fail:
+   wlc_log(WLC_LOG_WARN, "Failed to open capture file %s", path);
+   return true;
+}
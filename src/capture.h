@@ -0,0 +1,67 @@
+#ifndef _WLC_CAPTURE_H_
+#define _WLC_CAPTURE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Capture file format, shared with the replay driver of wlc-bench.
+ *
+ * File starts with WLC_CAPTURE_MAGIC, followed by records in host byte order.
+ * Each record is struct wlc_capture_record followed by nargs int32_t arguments.
+ * Object arguments are the protocol ids chosen by the client, 0 for NULL.
+ * WLC_CAPTURE_SURFACE_ATTACH may be followed by the shm buffer contents.
+ */
+
+#define WLC_CAPTURE_MAGIC "WLCCAP01"
+
+enum wlc_capture_request {
+   WLC_CAPTURE_CLIENT_CONNECT, // no args
+   WLC_CAPTURE_CLIENT_DISCONNECT, // no args
+   WLC_CAPTURE_CREATE_SURFACE, // id
+   WLC_CAPTURE_CREATE_REGION, // id
+   WLC_CAPTURE_REGION_DESTROY, // region
+   WLC_CAPTURE_REGION_ADD, // region, x, y, w, h
+   WLC_CAPTURE_REGION_SUBTRACT, // region, x, y, w, h
+   WLC_CAPTURE_SURFACE_DESTROY, // surface
+   WLC_CAPTURE_SURFACE_ATTACH, // surface, buffer, x, y, width, height, stride, format, hash lo, hash hi, content bytes
+   WLC_CAPTURE_SURFACE_DAMAGE, // surface, x, y, w, h
+   WLC_CAPTURE_SURFACE_FRAME, // surface, callback
+   WLC_CAPTURE_SURFACE_OPAQUE_REGION, // surface, region
+   WLC_CAPTURE_SURFACE_INPUT_REGION, // surface, region
+   WLC_CAPTURE_SURFACE_COMMIT, // surface
+   WLC_CAPTURE_SURFACE_BUFFER_SCALE, // surface, scale
+   WLC_CAPTURE_XDG_GET_SURFACE, // id, surface
+   WLC_CAPTURE_XDG_SURFACE_DESTROY, // xdg surface
+   WLC_CAPTURE_XDG_SURFACE_ACK_CONFIGURE, // xdg surface, serial
+   WLC_CAPTURE_XDG_SURFACE_WINDOW_GEOMETRY, // xdg surface, x, y, w, h
+   WLC_CAPTURE_SEAT_GET_POINTER, // id
+   WLC_CAPTURE_SEAT_GET_KEYBOARD, // id
+   WLC_CAPTURE_POINTER_SET_CURSOR, // pointer, serial, surface, hotspot x, hotspot y
+   WLC_CAPTURE_REQUEST_LAST,
+};
+
+struct wlc_capture_record {
+   uint64_t time; // ns since capture started
+   uint32_t client; // 1.. in order of connection
+   uint16_t request;
+   uint16_t nargs;
+};
+
+#ifndef WLC_CAPTURE_FORMAT_ONLY
+
+struct wl_client;
+struct wl_resource;
+
+extern bool wlc_capture_active;
+void wlc_capture_request(struct wl_client *wl_client, enum wlc_capture_request request, uint32_t nargs, ...);
+void wlc_capture_attach(struct wl_client *wl_client, struct wl_resource *surface, struct wl_resource *buffer, int32_t x, int32_t y);
+
+#define wlc_capture(wl_client, request, ...) do { if (wlc_capture_active) wlc_capture_request(wl_client, request, __VA_ARGS__); } while (0)
+
+bool wlc_capture_init(void);
+void wlc_capture_terminate(void);
+
+#endif /* WLC_CAPTURE_FORMAT_ONLY */
+
+#endif /* _WLC_CAPTURE_H_ */
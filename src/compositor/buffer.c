@@ -1,4 +1,5 @@
 #include "buffer.h"
+#include "client.h"
 #include <stdlib.h>
 #include <assert.h>
 
@@ -38,6 +39,7 @@ wlc_buffer_free(struct wlc_buffer *buffer)
       wl_resource_queue_event(buffer->resource, WL_BUFFER_RELEASE);
    }
 
+   wlc_client_release(buffer->client, WLC_CLIENT_BUFFERS, 1);
    free(buffer);
 }
 
@@ -7,9 +7,11 @@
 
 struct wl_resource;
 struct wl_shm_buffer;
+struct wlc_client;
 
 struct wlc_buffer {
    struct wl_resource *resource;
+   struct wlc_client *client;
    struct wl_listener destroy_listener;
    struct wlc_size size;
 
@@ -1,4 +1,5 @@
 #include "callback.h"
+#include "client.h"
 #include <stdlib.h>
 #include <assert.h>
 
@@ -33,6 +34,7 @@ wlc_callback_free(struct wlc_callback *callback)
    }
 
    wl_list_remove(&callback->link);
+   wlc_client_release(callback->client, WLC_CLIENT_CALLBACKS, 1);
    free(callback);
 }
 
@@ -4,9 +4,11 @@
 #include <wayland-util.h>
 
 struct wl_resource;
+struct wlc_client;
 
 struct wlc_callback {
    struct wl_resource *resource;
+   struct wlc_client *client;
    struct wl_list link;
 };
 
@@ -1,16 +1,127 @@
+#include "internal.h"
+#include "visibility.h"
 #include "client.h"
+#include "view.h"
+#include "trace.h"
+
+#include "xwayland/xwayland.h"
+
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include <wayland-server.h>
 
+// FIXME: contains global state
+
+static struct {
+   uint64_t limits[WLC_CLIENT_COUNTER_LAST];
+   enum wlc_client_limit_action action;
+} accounting;
+
+static const char *counter_names[WLC_CLIENT_COUNTER_LAST] = {
+   "surfaces",
+   "regions",
+   "callbacks",
+   "buffers",
+   "images",
+   "shm bytes",
+   "gpu bytes",
+};
+
+static void
+trace_usage(struct wlc_client *client, enum wlc_client_counter counter)
+{
+   if (counter >= WLC_CLIENT_IMAGES) {
+      WLC_TRACE(WLC_TRACE_CLIENT_GPU, client, client->usage[WLC_CLIENT_GPU_BYTES] / 1024);
+   } else {
+      WLC_TRACE(WLC_TRACE_CLIENT_RESOURCES, client, client->usage[WLC_CLIENT_SURFACES] + client->usage[WLC_CLIENT_REGIONS] +
+                client->usage[WLC_CLIENT_CALLBACKS] + client->usage[WLC_CLIENT_BUFFERS]);
+   }
+}
+
+static bool
+is_unused(struct wlc_client *client)
+{
+   for (int i = 0; i < WLC_CLIENT_COUNTER_LAST; ++i) {
+      if (client->usage[i] > 0)
+         return false;
+   }
+
+   return true;
+}
+
+void
+wlc_client_acquire(struct wlc_client *client, enum wlc_client_counter counter, uint64_t amount)
+{
+   if (!client || !amount)
+      return;
+
+   client->usage[counter] += amount;
+   trace_usage(client, counter);
+
+   if (!accounting.limits[counter] || client->usage[counter] <= accounting.limits[counter])
+      return;
+
+   if (!(client->over_limit & (1 << counter))) {
+      wlc_log(WLC_LOG_WARN, "Client (%p) exceeds %s limit (%llu > %llu)", client, counter_names[counter],
+              (unsigned long long)client->usage[counter], (unsigned long long)accounting.limits[counter]);
+      client->over_limit |= (1 << counter);
+   }
+
+   // Rejecting Xwayland would take down every X client with it
+   if (accounting.action == WLC_CLIENT_LIMIT_REJECT && client->wl_client && client->wl_client != wlc_xwayland_get_client())
+      wl_client_post_no_memory(client->wl_client);
+}
+
+void
+wlc_client_release(struct wlc_client *client, enum wlc_client_counter counter, uint64_t amount)
+{
+   if (!client || !amount)
+      return;
+
+   assert(client->usage[counter] >= amount);
+   client->usage[counter] -= amount;
+   trace_usage(client, counter);
+
+   if (client->detached && is_unused(client))
+      free(client);
+}
+
+static struct wl_list*
+bucket(struct wlc_client_registry *registry, struct wl_client *wl_client)
+{
+   // Fibonacci hashing, allocations are aligned so the low bits carry little
+   const uint64_t h = (uint64_t)(uintptr_t)wl_client * 0x9e3779b97f4a7c15ull;
+   return &registry->buckets[(h >> 32) & (WLC_CLIENT_BUCKETS - 1)];
+}
+
+void
+wlc_client_registry_init(struct wlc_client_registry *registry)
+{
+   assert(registry);
+
+   wl_list_init(&registry->list);
+
+   for (uint32_t i = 0; i < WLC_CLIENT_BUCKETS; ++i)
+      wl_list_init(&registry->buckets[i]);
+}
+
+void
+wlc_client_registry_add(struct wlc_client_registry *registry, struct wlc_client *client)
+{
+   assert(registry && client && client->wl_client);
+   wl_list_insert(&registry->list, &client->link);
+   wl_list_insert(bucket(registry, client->wl_client), &client->bucket_link);
+}
+
 struct wlc_client*
-wlc_client_for_client_with_wl_client_in_list(struct wl_client *wl_client, struct wl_list *list)
+wlc_client_for_wl_client(struct wlc_client_registry *registry, struct wl_client *wl_client)
 {
-   assert(wl_client && list);
+   assert(registry && wl_client);
 
    struct wlc_client *client;
-   wl_list_for_each(client, list, link) {
+   wl_list_for_each(client, bucket(registry, wl_client), bucket_link) {
       if (client->wl_client == wl_client)
          return client;
    }
@@ -23,11 +134,7 @@ wlc_client_free(struct wlc_client *client)
 {
    assert(client);
 
-   if (client->wl_client) {
-      wl_client_destroy(client->wl_client);
-      return;
-   }
-
+   // Input resource destructors find the client by wl_client, keep it registered until they ran
    for (int i = 0; i < WLC_INPUT_TYPE_LAST; ++i) {
       if (!client->input[i])
          continue;
@@ -36,6 +143,15 @@ wlc_client_free(struct wlc_client *client)
    }
 
    wl_list_remove(&client->link);
+   wl_list_remove(&client->bucket_link);
+   client->wl_client = NULL;
+
+   // Resources of the client may be destroyed after wl_compositor
+   if (!is_unused(client)) {
+      client->detached = true;
+      return;
+   }
+
    free(client);
 }
 
@@ -49,6 +165,8 @@ wlc_client_new(struct wl_client *wl_client)
       goto fail;
 
    client->wl_client = wl_client;
+   wl_list_init(&client->link);
+   wl_list_init(&client->bucket_link);
    return client;
 
 fail:
@@ -56,3 +174,40 @@ fail:
       wlc_client_free(client);
    return NULL;
 }
+
+WLC_API bool
+wlc_view_get_client_usage(struct wlc_view *view, struct wlc_client_usage *out_usage)
+{
+   assert(view && out_usage);
+
+   if (!view->client)
+      return false;
+
+   const uint64_t *usage = view->client->usage;
+   out_usage->surfaces = usage[WLC_CLIENT_SURFACES];
+   out_usage->regions = usage[WLC_CLIENT_REGIONS];
+   out_usage->callbacks = usage[WLC_CLIENT_CALLBACKS];
+   out_usage->buffers = usage[WLC_CLIENT_BUFFERS];
+   out_usage->images = usage[WLC_CLIENT_IMAGES];
+   out_usage->shm_bytes = usage[WLC_CLIENT_SHM_BYTES];
+   out_usage->gpu_bytes = usage[WLC_CLIENT_GPU_BYTES];
+   return true;
+}
+
+WLC_API void
+wlc_set_client_limits(const struct wlc_client_usage *limits, enum wlc_client_limit_action action)
+{
+   if (!limits) {
+      memset(&accounting, 0, sizeof(accounting));
+      return;
+   }
+
+   accounting.limits[WLC_CLIENT_SURFACES] = limits->surfaces;
+   accounting.limits[WLC_CLIENT_REGIONS] = limits->regions;
+   accounting.limits[WLC_CLIENT_CALLBACKS] = limits->callbacks;
+   accounting.limits[WLC_CLIENT_BUFFERS] = limits->buffers;
+   accounting.limits[WLC_CLIENT_IMAGES] = limits->images;
+   accounting.limits[WLC_CLIENT_SHM_BYTES] = limits->shm_bytes;
+   accounting.limits[WLC_CLIENT_GPU_BYTES] = limits->gpu_bytes;
+   accounting.action = action;
+}
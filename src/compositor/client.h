@@ -1,6 +1,8 @@
 #ifndef _WLC_CLIENT_H_
 #define _WLC_CLIENT_H_
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <wayland-util.h>
 
 enum wlc_input_type {
@@ -10,16 +12,47 @@ enum wlc_input_type {
    WLC_INPUT_TYPE_LAST
 };
 
+enum wlc_client_counter {
+   WLC_CLIENT_SURFACES,
+   WLC_CLIENT_REGIONS,
+   WLC_CLIENT_CALLBACKS, // pending frame callbacks
+   WLC_CLIENT_BUFFERS,
+   WLC_CLIENT_IMAGES,
+   WLC_CLIENT_SHM_BYTES, // texture storage of shm buffers
+   WLC_CLIENT_GPU_BYTES, // estimated, includes shm textures
+   WLC_CLIENT_COUNTER_LAST
+};
+
+#define WLC_CLIENT_BUCKETS 256 // hashed wl_client pointers, power of two
+
 struct wl_client;
 struct wl_resource;
 
+// Clients of a compositor, found by wl_client without scanning all of them.
+struct wlc_client_registry {
+   struct wl_list list; // struct wlc_client::link
+   struct wl_list buckets[WLC_CLIENT_BUCKETS]; // struct wlc_client::bucket_link
+};
+
 struct wlc_client {
    struct wl_client *wl_client;
    struct wl_resource *input[WLC_INPUT_TYPE_LAST];
-   struct wl_list link;
+   struct wl_list link, bucket_link;
+
+   uint64_t usage[WLC_CLIENT_COUNTER_LAST];
+   uint32_t over_limit; // bit per counter, each limit is logged once
+
+   // wl_client is gone, but resources still hold usage
+   bool detached;
 };
 
-struct wlc_client* wlc_client_for_client_with_wl_client_in_list(struct wl_client *wl_client, struct wl_list *list);
+// Resources keep a pointer to the client they are accounted to, client is freed after the last release.
+void wlc_client_acquire(struct wlc_client *client, enum wlc_client_counter counter, uint64_t amount);
+void wlc_client_release(struct wlc_client *client, enum wlc_client_counter counter, uint64_t amount);
+
+void wlc_client_registry_init(struct wlc_client_registry *registry);
+void wlc_client_registry_add(struct wlc_client_registry *registry, struct wlc_client *client);
+struct wlc_client* wlc_client_for_wl_client(struct wlc_client_registry *registry, struct wl_client *wl_client);
 void wlc_client_free(struct wlc_client *client);
 struct wlc_client* wlc_client_new(struct wl_client *wl_client);
 
@@ -9,6 +9,7 @@
 #include "data.h"
 #include "client.h"
 #include "macros.h"
+#include "capture.h"
 
 #include "seat/seat.h"
 #include "seat/pointer.h"
@@ -132,6 +133,8 @@ wl_subcompositor_bind(struct wl_client *wl_client, void *data, uint32_t version,
 static void
 wl_cb_surface_create(struct wl_client *wl_client, struct wl_resource *resource, unsigned int id)
 {
+   wlc_capture(wl_client, WLC_CAPTURE_CREATE_SURFACE, 1, id);
+
    struct wlc_surface *surface = NULL;
    struct wl_resource *surface_resource;
    if (!(surface_resource = wl_resource_create(wl_client, &wl_surface_interface, wl_resource_get_version(resource), id)))
@@ -141,6 +144,11 @@ wl_cb_surface_create(struct wl_client *wl_client, struct wl_resource *resource,
       goto fail;
 
    wlc_surface_implement(surface, surface_resource);
+
+   struct wlc_compositor *compositor = wl_resource_get_user_data(resource);
+   surface->client = wlc_client_for_wl_client(&compositor->clients, wl_client);
+   wlc_client_acquire(surface->client, WLC_CLIENT_SURFACES, 1);
+
    wl_signal_emit(&wlc_system_signals()->surface, wl_resource_get_user_data(resource));
    return;
 
@@ -155,6 +163,8 @@ fail:
 static void
 wl_cb_region_create(struct wl_client *wl_client, struct wl_resource *resource, unsigned int id)
 {
+   wlc_capture(wl_client, WLC_CAPTURE_CREATE_REGION, 1, id);
+
    struct wl_resource *region_resource;
    if (!(region_resource = wl_resource_create(wl_client, &wl_region_interface, wl_resource_get_version(resource), id)))
       goto fail;
@@ -164,6 +174,10 @@ wl_cb_region_create(struct wl_client *wl_client, struct wl_resource *resource, u
       goto fail;
 
    wlc_region_implement(region, region_resource);
+
+   struct wlc_compositor *compositor = wl_resource_get_user_data(resource);
+   region->client = wlc_client_for_wl_client(&compositor->clients, wl_client);
+   wlc_client_acquire(region->client, WLC_CLIENT_REGIONS, 1);
    return;
 
 fail:
@@ -185,10 +199,8 @@ wl_cb_compositor_client_destructor(struct wl_resource *resource)
    struct wlc_compositor *compositor = wl_resource_get_user_data(resource);
 
    struct wlc_client *client;
-   if ((client = wlc_client_for_client_with_wl_client_in_list(wl_client, &compositor->clients))) {
-      client->wl_client = NULL;
+   if ((client = wlc_client_for_wl_client(&compositor->clients, wl_client)))
       wlc_client_free(client);
-   }
 }
 
 static void
@@ -204,7 +216,6 @@ wl_compositor_bind(struct wl_client *wl_client, void *data, unsigned int version
 
    struct wl_resource *resource;
    if (!(resource = wl_resource_create(wl_client, &wl_compositor_interface, fmin(version, 3), id))) {
-      client->wl_client = NULL;
       wlc_client_free(client);
       wl_client_post_no_memory(wl_client);
       wlc_log(WLC_LOG_WARN, "Failed create resource or bad version (%u > %u)", version, 3);
@@ -212,7 +223,7 @@ wl_compositor_bind(struct wl_client *wl_client, void *data, unsigned int version
    }
 
    wl_resource_set_implementation(resource, &wl_compositor_implementation, data, wl_cb_compositor_client_destructor);
-   wl_list_insert(&compositor->clients, &client->link);
+   wlc_client_registry_add(&compositor->clients, client);
 }
 
 static void
@@ -224,13 +235,13 @@ activated(struct wl_listener *listener, void *data)
    if (!(compositor = wl_container_of(listener, compositor, listener.activated)))
       return;
 
-   if (!activated) {
-      struct wlc_output *o;
-      wl_list_for_each(o, &compositor->outputs, link)
-         wlc_output_set_backend_surface(o, NULL);
-   } else {
+   struct wlc_output *o;
+   wl_list_for_each(o, &compositor->outputs, link)
+      wlc_output_suspend(o, !activated);
+
+   // Connectors may have changed while we were away.
+   if (activated)
       wlc_backend_update_outputs(compositor->backend, &compositor->outputs);
-   }
 }
 
 static void
@@ -265,6 +276,8 @@ compositor_cleanup(struct wlc_compositor *compositor)
    if (compositor->manager)
       wlc_data_device_manager_free(compositor->manager);
 
+   wlc_transaction_release(&compositor->transaction);
+
    if (compositor->global_sub)
       wl_global_destroy(compositor->global_sub);
 
@@ -474,10 +487,14 @@ wlc_compositor_new(void *userdata)
 
    const char *bg = getenv("WLC_BG");
    const char *idle_time = getenv("WLC_IDLE_TIME");
+   const char *stretch = getenv("WLC_RESIZE_STRETCH");
+   const char *frozen_time = getenv("WLC_FROZEN_TIME");
    compositor->options.enable_bg = (bg && !strcmp(bg, "0") ? false : true);
    compositor->options.idle_time = (idle_time ? strtol(idle_time, NULL, 10) : 60 * 5);
+   compositor->options.stretch_resize = (stretch && !strcmp(stretch, "1"));
+   compositor->options.frozen_time = (frozen_time ? strtoul(frozen_time, NULL, 10) : 0);
 
-   wl_list_init(&compositor->clients);
+   wlc_client_registry_init(&compositor->clients);
    wl_list_init(&compositor->outputs);
 
    compositor->listener.activated.notify = activated;
@@ -489,6 +506,9 @@ wlc_compositor_new(void *userdata)
    wl_signal_add(&wlc_system_signals()->xwayland, &compositor->listener.xwayland);
    wl_signal_add(&wlc_system_signals()->output, &compositor->listener.output);
 
+   if (!wlc_transaction_init(&compositor->transaction))
+      goto fail;
+
    if (!(compositor->global = wl_global_create(wlc_display(), &wl_compositor_interface, 3, compositor, wl_compositor_bind)))
       goto compositor_interface_fail;
 
@@ -507,9 +527,12 @@ wlc_compositor_new(void *userdata)
    if (!(compositor->xdg_shell = wlc_xdg_shell_new(compositor)))
       goto fail;
 
+   const uint64_t begin = wlc_get_time_ns();
    if (!(compositor->backend = wlc_backend_init(compositor)))
       goto fail;
 
+   wlc_startup_phase(WLC_STARTUP_BACKEND, begin);
+
    return compositor;
 
 out_of_memory:
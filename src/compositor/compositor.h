@@ -6,6 +6,9 @@
 #include <wayland-server.h>
 #include <wayland-util.h>
 
+#include "transaction.h"
+#include "client.h"
+
 struct wl_display;
 struct wl_event_loop;
 struct wl_event_source;
@@ -29,7 +32,9 @@ struct wlc_compositor {
    struct wlc_output *output;
    struct wlc_xwm *xwm;
 
-   struct wl_list clients, outputs;
+   struct wlc_client_registry clients;
+   struct wl_list outputs;
+   struct wlc_transaction transaction;
 
    struct {
       struct wl_listener activated;
@@ -41,7 +46,9 @@ struct wlc_compositor {
    struct {
       // XXX: temporary
       uint32_t idle_time;
+      uint32_t frozen_time; // ms a view waits for a resized buffer, 0 waits forever
       bool enable_bg;
+      bool stretch_resize;
    } options;
 
    bool terminating;
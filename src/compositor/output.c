@@ -2,6 +2,7 @@
 #include "macros.h"
 #include "output.h"
 #include "visibility.h"
+#include "trace.h"
 
 #include "compositor.h"
 #include "callback.h"
@@ -35,6 +36,7 @@ wlc_space_new(struct wlc_output *output)
 
    space->output = output;
    wl_list_init(&space->views);
+   wlc_space_index_init(&space->index);
    wl_list_insert(output->spaces.prev, &space->link);
    return space;
 }
@@ -47,6 +49,7 @@ wlc_space_free(struct wlc_space *space)
    if (space->output->space == space)
       space->output->space = (wl_list_empty(&space->output->spaces) ? NULL : wlc_space_from_link(space->link.prev));
 
+   wlc_space_index_release(&space->index);
    free(space);
 }
 
@@ -164,15 +167,135 @@ finish_frame_tasks(struct wlc_output *output)
    }
 }
 
+static bool
+can_scanout(struct wlc_output *output, struct wlc_view *view, const struct wlc_geometry *bounds, const struct wlc_geometry *visible)
+{
+   // Dimmed, letterboxed or stretched views need the renderer.
+   if (!view->surface->commit.buffer || !wlc_geometry_equals(bounds, visible) || wlc_view_get_stretch(view, NULL))
+      return false;
+
+   if (!(view->commit.state & WLC_BIT_ACTIVATED) && !(view->type & WLC_BIT_UNMANAGED))
+      return false;
+
+   return (bounds->origin.x >= 0 && bounds->origin.y >= 0 &&
+           bounds->origin.x + bounds->size.w <= output->resolution.w &&
+           bounds->origin.y + bounds->size.h <= output->resolution.h);
+}
+
+static void
+assign_planes(struct wlc_output *output)
+{
+   struct wlc_backend_surface *bsurface = output->bsurface;
+   const bool planes = (bsurface && bsurface->api.assign_plane);
+
+   if (planes)
+      bsurface->api.assign_plane(bsurface, NULL, NULL);
+
+   // Planes are stacked above the composited frame,
+   // so view may use one only if nothing composited is on top of it.
+   pixman_region32_t above;
+   pixman_region32_init(&above);
+
+   struct wlc_pointer *pointer = output->compositor->seat->pointer;
+   if (planes && output->compositor->output == output && pointer->hw.bsurface != bsurface) {
+      struct wlc_size size = { WLC_POINTER_CURSOR_SIZE, WLC_POINTER_CURSOR_SIZE };
+      struct wlc_origin tip = wlc_origin_zero;
+
+      if (pointer->surface) {
+         size = pointer->surface->size;
+         tip = pointer->tip;
+      }
+
+      pixman_region32_union_rect(&above, &above, pointer->pos.x - tip.x, pointer->pos.y - tip.y, size.w, size.h);
+   }
+
+   uint32_t assigned = 0;
+   bool changed = false;
+
+   struct wlc_view *view;
+   wl_list_for_each_reverse(view, &output->space->views, link) {
+      if (!view->created || !view->surface->commit.attached)
+         continue;
+
+      const bool scanout = view->scanout;
+      view->scanout = false;
+
+      struct wlc_geometry b, v;
+      wlc_view_get_bounds(view, &b, &v);
+      pixman_box32_t box = { b.origin.x, b.origin.y, b.origin.x + b.size.w, b.origin.y + b.size.h };
+
+      if (planes && can_scanout(output, view, &b, &v) && pixman_region32_contains_rectangle(&above, &box) == PIXMAN_REGION_OUT)
+         view->scanout = bsurface->api.assign_plane(bsurface, view->surface->commit.buffer, &b);
+
+      if (view->scanout != scanout) {
+         wlc_dlog(WLC_DBG_RENDER, "-> View (%p) %s overlay plane", view, (view->scanout ? "moved to" : "left"));
+         changed = true;
+      }
+
+      // Views on planes are stacked by the backend, only composited ones cover the views below.
+      if (view->scanout) {
+         ++assigned;
+      } else {
+         pixman_region32_union_rect(&above, &above, b.origin.x, b.origin.y, b.size.w, b.size.h);
+      }
+   }
+
+   if (changed)
+      wlc_dlog(WLC_DBG_RENDER, "-> %u view(s) on overlay planes", assigned);
+
+   pixman_region32_fini(&above);
+}
+
+// Tags older than this are dropped, the output was idle rather than slow.
+#define LATENCY_STALE_NS (1000 * 1000000ULL)
+
+static void
+latency_record(uint64_t histogram[WLC_INPUT_LATENCY_BUCKETS], uint64_t ns)
+{
+   const uint64_t us = ns / 1000;
+   const uint32_t bucket = (us > 0 ? 63 - __builtin_clzll(us) : 0);
+   histogram[(bucket < WLC_INPUT_LATENCY_BUCKETS ? bucket : WLC_INPUT_LATENCY_BUCKETS - 1)]++;
+}
+
+// Clients throttled on frame callbacks can't draw the size a transaction waits for without one,
+// so they are answered while repaint is held back, as if the held frame was shown.
+static void
+release_frame_callbacks(struct wlc_output *output)
+{
+   const uint32_t time = wlc_get_time(NULL);
+
+   struct wlc_view *view;
+   wl_list_for_each(view, &output->space->views, link) {
+      if (!view->created || !view->surface->commit.attached)
+         continue;
+
+      struct wlc_callback *cb, *cbn;
+      wl_list_for_each_safe(cb, cbn, &view->surface->commit.frame_cb_list, link) {
+         wl_callback_send_done(cb->resource, time);
+         wlc_callback_free(cb);
+      }
+   }
+}
+
 static bool
 repaint(struct wlc_output *output)
 {
    assert(output);
 
-   if (!should_render(output) || !wlc_render_bind(output->render, output)) {
-      wlc_dlog(WLC_DBG_RENDER, "-> Skipped repaint");
+   WLC_TRACE(WLC_TRACE_REPAINT_BEGIN, output, 0);
+
+   const bool render = should_render(output);
+   const bool held = (render && wlc_transaction_holds(&output->compositor->transaction, output));
+
+   if (!render || held || !wlc_render_bind(output->render, output)) {
+      wlc_dlog(WLC_DBG_RENDER, "-> Skipped repaint%s", (held ? ", held by transaction" : ""));
       output->activity = output->scheduled = false;
+
+      if (held)
+         release_frame_callbacks(output);
+
       finish_frame_tasks(output);
+      WLC_TRACE(WLC_TRACE_REPAINT_END, output, 0);
       return false;
    }
 
@@ -193,19 +316,26 @@ repaint(struct wlc_output *output)
    wl_list_init(&callbacks);
 
    struct wlc_view *view;
+   wl_list_for_each(view, &output->space->views, link) {
+      if (view->created && view->surface->commit.attached)
+         wlc_view_commit_state(view, &view->pending, &view->commit);
+   }
+
+   assign_planes(output);
+
    wl_list_for_each(view, &output->space->views, link) {
       if (!view->created || !view->surface->commit.attached)
          continue;
 
-      wlc_view_commit_state(view, &view->pending, &view->commit);
-      wlc_render_view_paint(output->render, view);
+      if (!view->scanout)
+         wlc_render_view_paint(output->render, view);
 
       wl_list_insert_list(&callbacks, &view->surface->commit.frame_cb_list);
       wl_list_init(&view->surface->commit.frame_cb_list);
    }
 
    if (output->compositor->output == output) // XXX: Make this option instead, and give each output current cursor coords
-      wlc_pointer_paint(output->compositor->seat->pointer, output->render);
+      wlc_pointer_paint(output->compositor->seat->pointer, output);
 
    {
       void *rgba;
@@ -218,7 +348,14 @@ repaint(struct wlc_output *output)
       }
    }
 
+   // Only input sent before this frame was composed can be in it
+   if (!output->latency.swapped) {
+      output->latency.swapped = output->latency.dispatched;
+      output->latency.dispatched = 0;
+   }
+
    output->pending = true;
+   WLC_TRACE(WLC_TRACE_SWAP, output, 0);
    wlc_render_swap(output->render);
 
    struct wlc_callback *cb, *cbn;
@@ -227,7 +364,7 @@ repaint(struct wlc_output *output)
       wlc_callback_free(cb);
    }
 
-   wlc_dlog(WLC_DBG_RENDER, "-> Repaint");
+   WLC_TRACE(WLC_TRACE_REPAINT_END, output, 1);
    return true;
 }
 
@@ -246,7 +383,45 @@ cb_sleep_timer(void *data)
 }
 
 void
-wlc_output_finish_frame(struct wlc_output *output, const struct timespec *ts)
+wlc_output_input_dispatched(struct wlc_output *output, uint64_t arrival)
+{
+   if (!output || !arrival)
+      return;
+
+   const uint64_t now = wlc_get_time_ns();
+   const uint64_t ns = (now > arrival ? now - arrival : 0);
+   latency_record(output->latency.histogram.dispatch, ns);
+   WLC_TRACE(WLC_TRACE_INPUT_DISPATCH_LATENCY, output, ns / 1000);
+
+   if (!output->latency.dispatched)
+      output->latency.dispatched = now;
+}
+
+// Frame reached the screen at ts.
+void
+wlc_output_frame_presented(struct wlc_output *output, const struct timespec *ts)
+{
+   WLC_TRACE(WLC_TRACE_FLIP, output, 0);
+
+   // TODO: handle presentation feedback here
+
+   if (output->latency.swapped) {
+      const uint64_t presented = (uint64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+      const uint64_t ns = (presented > output->latency.swapped ? presented - output->latency.swapped : 0);
+
+      if (ns < LATENCY_STALE_NS) {
+         latency_record(output->latency.histogram.present, ns);
+         WLC_TRACE(WLC_TRACE_INPUT_PRESENT_LATENCY, output, ns / 1000);
+      }
+
+      output->latency.swapped = 0;
+   }
+}
+
+// Output may render the next frame.
+// Backends with deeper swapchain call this before the frame is presented.
+void
+wlc_output_frame_done(struct wlc_output *output, const struct timespec *ts)
 {
    output->pending = false;
 
@@ -256,8 +431,6 @@ wlc_output_finish_frame(struct wlc_output *output, const struct timespec *ts)
    output->frame_time = ts->tv_sec * 1000 + ts->tv_nsec / 1000000;
    const uint32_t ms = output->frame_time - last;
 
-   // TODO: handle presentation feedback here
-
    if (output->compositor->options.enable_bg && output->background_visible && !is_visible(output)) {
       wlc_dlog(WLC_DBG_RENDER, "-> Background not visible");
       output->background_visible = false;
@@ -273,10 +446,23 @@ wlc_output_finish_frame(struct wlc_output *output, const struct timespec *ts)
       output->scheduled = false;
    }
 
-   wlc_dlog(WLC_DBG_RENDER, "-> Finished frame");
+   if (output->resume_time) {
+      wlc_log(WLC_LOG_INFO, "Output (%p) first frame %u ms after resume", output, wlc_get_time(NULL) - output->resume_time);
+      output->resume_time = 0;
+   }
+
+   wlc_startup_finish();
+
    finish_frame_tasks(output);
 }
 
+void
+wlc_output_finish_frame(struct wlc_output *output, const struct timespec *ts)
+{
+   wlc_output_frame_presented(output, ts);
+   wlc_output_frame_done(output, ts);
+}
+
 bool
 wlc_output_information_add_mode(struct wlc_output_information *info, struct wlc_output_mode *mode)
 {
@@ -396,12 +582,18 @@ wlc_output_set_backend_surface(struct wlc_output *output, struct wlc_backend_sur
    }
 
    if ((output->bsurface = bsurface)) {
+      uint64_t begin = wlc_get_time_ns();
       if (!(output->context = wlc_context_new(bsurface)))
          goto fail;
 
+      wlc_startup_phase(WLC_STARTUP_CONTEXT, begin);
+
+      begin = wlc_get_time_ns();
       if (!(output->render = wlc_render_new(output->context)))
          goto fail;
 
+      wlc_startup_phase(WLC_STARTUP_RENDER, begin);
+
       bsurface->output = output;
 
       struct wlc_surface *surface, *sn;
@@ -465,6 +657,29 @@ wlc_output_set_sleep(struct wlc_output *output, bool sleep)
    }
 }
 
+void
+wlc_output_suspend(struct wlc_output *output, bool suspend)
+{
+   assert(output);
+
+   if (!output->bsurface)
+      return;
+
+   if (!output->bsurface->api.suspend) {
+      // Backend can't keep the surface, it is created again on resume.
+      if (suspend)
+         wlc_output_set_backend_surface(output, NULL);
+      return;
+   }
+
+   output->bsurface->api.suspend(output->bsurface, suspend);
+
+   if (!suspend && !output->sleeping) {
+      output->resume_time = wlc_get_time(NULL);
+      wlc_output_schedule_repaint(output);
+   }
+}
+
 void
 wlc_output_terminate(struct wlc_output *output)
 {
@@ -626,6 +841,13 @@ wlc_output_get_userdata(struct wlc_output *output)
    return output->userdata;
 }
 
+WLC_API void
+wlc_output_get_input_latency(struct wlc_output *output, struct wlc_input_latency *out_latency)
+{
+   assert(output && out_latency);
+   memcpy(out_latency, &output->latency.histogram, sizeof(struct wlc_input_latency));
+}
+
 WLC_API void
 wlc_output_focus_space(struct wlc_output *output, struct wlc_space *space)
 {
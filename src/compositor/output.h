@@ -6,6 +6,7 @@
 
 #include "types/string.h"
 #include "types/geometry.h"
+#include "space-index.h"
 
 struct wl_global;
 struct wlc_backend_surface;
@@ -19,6 +20,7 @@ struct wlc_space {
    struct wlc_output *output;
    struct wl_list views;
    struct wl_list link;
+   struct wlc_space_index index;
 };
 
 struct wlc_output_mode {
@@ -58,6 +60,15 @@ struct wlc_output {
       bool sleep;
    } task;
 
+   // Session resume time, for measuring time to first frame.
+   uint32_t resume_time;
+
+   // Input sent to clients while this output was focused, see wlc_output_input_dispatched.
+   struct {
+      struct wlc_input_latency histogram;
+      uint64_t dispatched, swapped; // oldest send not yet in a frame, CLOCK_MONOTONIC ns
+   } latency;
+
    float ims;
    uint32_t frame_time;
    uint32_t mode;
@@ -66,7 +77,10 @@ struct wlc_output {
    bool background_visible;
 };
 
+void wlc_output_frame_presented(struct wlc_output *output, const struct timespec *ts);
+void wlc_output_frame_done(struct wlc_output *output, const struct timespec *ts);
 void wlc_output_finish_frame(struct wlc_output *output, const struct timespec *ts);
+void wlc_output_input_dispatched(struct wlc_output *output, uint64_t arrival);
 void wlc_output_schedule_repaint(struct wlc_output *output);
 bool wlc_output_information_add_mode(struct wlc_output_information *info, struct wlc_output_mode *mode);
 bool wlc_output_surface_attach(struct wlc_output *output, struct wlc_surface *surface, struct wlc_buffer *buffer);
@@ -74,6 +88,7 @@ void wlc_output_surface_destroy(struct wlc_output *output, struct wlc_surface *s
 bool wlc_output_set_backend_surface(struct wlc_output *output, struct wlc_backend_surface *surface);
 void wlc_output_set_information(struct wlc_output *output, struct wlc_output_information *information);
 void wlc_output_set_sleep(struct wlc_output *output, bool sleep);
+void wlc_output_suspend(struct wlc_output *output, bool suspend);
 struct wlc_output* wlc_output_new(struct wlc_compositor *compositor, struct wlc_backend_surface *surface, struct wlc_output_information *info);
 void wlc_output_terminate(struct wlc_output *output);
 void wlc_output_free(struct wlc_output *output);
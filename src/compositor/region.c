@@ -1,5 +1,7 @@
 #include "region.h"
+#include "client.h"
 #include "macros.h"
+#include "capture.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -10,14 +12,14 @@
 static void
 wl_cb_region_destroy(struct wl_client *wl_client, struct wl_resource *resource)
 {
-   (void)wl_client;
+   wlc_capture(wl_client, WLC_CAPTURE_REGION_DESTROY, 1, wl_resource_get_id(resource));
    wl_resource_destroy(resource);
 }
 
 static void
 wl_cb_region_add(struct wl_client *wl_client, struct wl_resource *resource, int32_t x, int32_t y, int32_t width, int32_t height)
 {
-   (void)wl_client;
+   wlc_capture(wl_client, WLC_CAPTURE_REGION_ADD, 5, wl_resource_get_id(resource), x, y, width, height);
    struct wlc_region *region = wl_resource_get_user_data(resource);
    pixman_region32_union_rect(&region->region, &region->region, x, y, width, height);
 }
@@ -25,7 +27,7 @@ wl_cb_region_add(struct wl_client *wl_client, struct wl_resource *resource, int3
 static void
 wl_cb_region_subtract(struct wl_client *wl_client, struct wl_resource *resource, int32_t x, int32_t y, int32_t width, int32_t height)
 {
-   (void)wl_client;
+   wlc_capture(wl_client, WLC_CAPTURE_REGION_SUBTRACT, 5, wl_resource_get_id(resource), x, y, width, height);
    struct wlc_region *region = wl_resource_get_user_data(resource);
 
    pixman_region32_t rect;
@@ -70,6 +72,7 @@ wlc_region_free(struct wlc_region *region)
 {
    assert(region);
    pixman_region32_fini(&region->region);
+   wlc_client_release(region->client, WLC_CLIENT_REGIONS, 1);
    free(region);
 }
 
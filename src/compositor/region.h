@@ -4,9 +4,11 @@
 #include <pixman.h>
 
 struct wl_resource;
+struct wlc_client;
 
 struct wlc_region {
    struct wl_resource *resource;
+   struct wlc_client *client;
    pixman_region32_t region;
 };
 
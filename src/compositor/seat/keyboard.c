@@ -1,6 +1,7 @@
 #include "internal.h"
 #include "keyboard.h"
 #include "keymap.h"
+#include "trace.h"
 
 #include "compositor/view.h"
 #include "compositor/client.h"
@@ -21,6 +22,13 @@ is_valid_view(struct wlc_view *view)
    return (view && view->client && view->client->input[WLC_KEYBOARD] && view->surface && view->surface->resource);
 }
 
+static void
+send_modifiers(struct wlc_keyboard *keyboard, struct wl_resource *resource)
+{
+   uint32_t serial = wl_display_next_serial(wlc_display());
+   wl_keyboard_send_modifiers(resource, serial, keyboard->mods.depressed, keyboard->mods.latched, keyboard->mods.locked, keyboard->mods.group);
+}
+
 static void
 update_modifiers(struct wlc_keyboard *keyboard)
 {
@@ -41,14 +49,9 @@ update_modifiers(struct wlc_keyboard *keyboard)
    keyboard->mods.locked = locked;
    keyboard->mods.group = group;
 
-   struct wlc_client *client;
-   wl_list_for_each(client, &keyboard->compositor->clients, link) {
-      if (!client->input[WLC_KEYBOARD])
-         continue;
-
-      uint32_t serial = wl_display_next_serial(wlc_display());
-      wl_keyboard_send_modifiers(client->input[WLC_KEYBOARD], serial, keyboard->mods.depressed, keyboard->mods.latched, keyboard->mods.locked, keyboard->mods.group);
-   }
+   // Only the focused client needs them, others get the current state on enter
+   if (is_valid_view(keyboard->focus))
+      send_modifiers(keyboard, keyboard->focus->client->input[WLC_KEYBOARD]);
 }
 
 static bool
@@ -126,7 +129,7 @@ wlc_keyboard_update(struct wlc_keyboard *keyboard, uint32_t key, enum wl_keyboar
 }
 
 void
-wlc_keyboard_key(struct wlc_keyboard *keyboard, uint32_t time, uint32_t key, enum wl_keyboard_key_state state)
+wlc_keyboard_key(struct wlc_keyboard *keyboard, uint32_t time, uint64_t arrival, uint32_t key, enum wl_keyboard_key_state state)
 {
    assert(keyboard);
 
@@ -135,6 +138,8 @@ wlc_keyboard_key(struct wlc_keyboard *keyboard, uint32_t time, uint32_t key, enu
 
    uint32_t serial = wl_display_next_serial(wlc_display());
    wl_keyboard_send_key(keyboard->focus->client->input[WLC_KEYBOARD], serial, time, key, state);
+   WLC_TRACE(WLC_TRACE_INPUT_DELIVERED, keyboard->focus, WLC_INPUT_EVENT_KEY);
+   wlc_output_input_dispatched(keyboard->compositor->output, arrival);
 }
 
 void
@@ -167,6 +172,7 @@ wlc_keyboard_focus(struct wlc_keyboard *keyboard, struct wlc_view *view)
       reset_keyboard(keyboard);
       uint32_t serial = wl_display_next_serial(wlc_display());
       wl_keyboard_send_enter(focus, serial, view->surface->resource, &keyboard->keys);
+      send_modifiers(keyboard, focus);
    }
 
    keyboard->focus = view;
@@ -184,18 +190,14 @@ wlc_keyboard_remove_client_for_resource(struct wlc_keyboard *keyboard, struct wl
    //    This is also safer against misbehaving clients, and simpler API.
 
    struct wlc_client *client;
-   wl_list_for_each(client, &keyboard->compositor->clients, link) {
-      if (client->input[WLC_KEYBOARD] != resource)
-         continue;
-
-      if (keyboard->focus && keyboard->focus->client && keyboard->focus->client->input[WLC_KEYBOARD] == resource) {
-         client->input[WLC_KEYBOARD] = NULL;
-         wlc_keyboard_focus(keyboard, NULL);
-      } else {
-         client->input[WLC_KEYBOARD] = NULL;
-      }
-
+   if (!(client = wlc_client_for_wl_client(&keyboard->compositor->clients, wl_resource_get_client(resource))) || client->input[WLC_KEYBOARD] != resource)
       return;
+
+   if (keyboard->focus && keyboard->focus->client && keyboard->focus->client->input[WLC_KEYBOARD] == resource) {
+      client->input[WLC_KEYBOARD] = NULL;
+      wlc_keyboard_focus(keyboard, NULL);
+   } else {
+      client->input[WLC_KEYBOARD] = NULL;
    }
 }
 
@@ -220,7 +222,7 @@ wlc_keyboard_free(struct wlc_keyboard *keyboard)
 
    if (keyboard->compositor) {
       struct wlc_client *client;
-      wl_list_for_each(client, &keyboard->compositor->clients, link) {
+      wl_list_for_each(client, &keyboard->compositor->clients.list, link) {
          if (!client->input[WLC_KEYBOARD])
             continue;
 
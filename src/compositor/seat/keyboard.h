@@ -30,7 +30,7 @@ struct wlc_keyboard {
 
 bool wlc_keyboard_request_key(struct wlc_keyboard *keyboard, uint32_t time, const struct wlc_modifiers *mods, uint32_t key, enum wl_keyboard_key_state state);
 bool wlc_keyboard_update(struct wlc_keyboard *keyboard, uint32_t key, enum wl_keyboard_key_state state);
-void wlc_keyboard_key(struct wlc_keyboard *keyboard, uint32_t time, uint32_t key, enum wl_keyboard_key_state state);
+void wlc_keyboard_key(struct wlc_keyboard *keyboard, uint32_t time, uint64_t arrival, uint32_t key, enum wl_keyboard_key_state state);
 void wlc_keyboard_focus(struct wlc_keyboard *keyboard, struct wlc_view *view);
 void wlc_keyboard_remove_client_for_resource(struct wlc_keyboard *keyboard, struct wl_resource *resource);
 bool wlc_keyboard_set_keymap(struct wlc_keyboard *keyboard, struct wlc_keymap *keymap);
@@ -2,15 +2,46 @@
 #include "keymap.h"
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <unistd.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <assert.h>
 
 #include <wayland-server.h>
 
+#ifndef MFD_CLOEXEC
+#  define MFD_CLOEXEC 0x0001U
+#  define MFD_ALLOW_SEALING 0x0002U
+#endif
+
+#ifndef F_ADD_SEALS
+#  define F_ADD_SEALS 1033
+#  define F_SEAL_SEAL 0x0001
+#  define F_SEAL_SHRINK 0x0002
+#  define F_SEAL_GROW 0x0004
+#  define F_SEAL_WRITE 0x0008
+#endif
+
+// Compiled keymaps are cached by rule names and flags, in memory and as text under
+// $XDG_CACHE_HOME/wlc. Disk entries also key on the mtimes of the xkb data in every
+// include path, so an xkeyboard-config update or a user override invalidates them.
+
+#define MEMORY_CACHE_SIZE 4
+
+// FIXME: contains global state
+static struct {
+   struct {
+      char *key, *string;
+      struct xkb_keymap *keymap;
+   } entries[MEMORY_CACHE_SIZE];
+   uint32_t next;
+} cache;
+
 const char* WLC_MOD_NAMES[WLC_MOD_LAST] = {
    XKB_MOD_NAME_SHIFT,
    XKB_MOD_NAME_CAPS,
@@ -126,6 +157,243 @@ os_create_anonymous_file(off_t size)
    return fd;
 }
 
+static int
+create_sealed_file(const char *data, size_t size)
+{
+#ifdef SYS_memfd_create
+   int fd;
+   if ((fd = syscall(SYS_memfd_create, "wlc-keymap", MFD_CLOEXEC | MFD_ALLOW_SEALING)) < 0)
+      return -1;
+
+   for (size_t off = 0; off < size;) {
+      const ssize_t ret = write(fd, data + off, size - off);
+
+      if (ret < 0 && errno == EINTR)
+         continue;
+
+      if (ret <= 0)
+         goto fail;
+
+      off += ret;
+   }
+
+   // Clients share the one fd, none of them can change it under the others
+   if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0)
+      goto fail;
+
+   return fd;
+
+fail:
+   close(fd);
+   return -1;
+#else
+   (void)data, (void)size;
+   errno = ENOSYS;
+   return -1;
+#endif
+}
+
+static uint64_t
+fnv1a(const char *data, size_t size)
+{
+   uint64_t h = 0xcbf29ce484222325ull;
+   for (size_t i = 0; i < size; ++i)
+      h = (h ^ (uint8_t)data[i]) * 0x100000001b3ull;
+   return h;
+}
+
+// Missing files are mixed in too, so adding an override changes the result.
+static uint64_t
+mix_mtime(uint64_t h, char *path)
+{
+   struct stat st;
+   const int64_t mtime = (path && stat(path, &st) == 0 ? (int64_t)st.st_mtime : -1);
+   free(path);
+   return (h ^ (uint64_t)mtime) * 0x100000001b3ull;
+}
+
+static uint64_t
+data_mtime(struct xkb_context *context, const struct xkb_rule_names *names)
+{
+   // Package updates replace files, which touches their directories
+   const char *dirs[] = { "rules", "keycodes", "types", "compat", "symbols" };
+   const char *rules = (names->rules && *names->rules ? names->rules : "evdev");
+   const char *layouts = (names->layout && *names->layout ? names->layout : "us");
+
+   uint64_t h = 0xcbf29ce484222325ull;
+   const uint32_t count = xkb_context_num_include_paths(context);
+   for (uint32_t i = 0; i < count; ++i) {
+      const char *root;
+      if (!(root = xkb_context_include_path_get(context, i)))
+         continue;
+
+      for (uint32_t d = 0; d < sizeof(dirs) / sizeof(dirs[0]); ++d)
+         h = mix_mtime(h, csprintf("%s/%s", root, dirs[d]));
+
+      h = mix_mtime(h, csprintf("%s/rules/%s", root, rules));
+
+      // Layouts are comma separated, a variant may follow in parentheses
+      for (const char *l = layouts; *l;) {
+         const size_t len = strcspn(l, ",(");
+         h = mix_mtime(h, csprintf("%s/symbols/%.*s", root, (int)len, l));
+         l += strcspn(l, ",");
+         l += (*l == ',');
+      }
+   }
+
+   return h;
+}
+
+static char*
+cache_key(struct xkb_context *context, const struct xkb_rule_names *names, enum xkb_keymap_compile_flags flags)
+{
+#define S(x) (names->x ? names->x : "")
+   return csprintf("# wlc keymap\n# rules: %s\n# model: %s\n# layout: %s\n# variant: %s\n# options: %s\n# flags: %d\n# data: %016llx\n",
+                   S(rules), S(model), S(layout), S(variant), S(options), flags, (unsigned long long)data_mtime(context, names));
+#undef S
+}
+
+static char*
+cache_path(const char *key)
+{
+   const char *xdg_cache, *home;
+   char *base = NULL;
+
+   if ((xdg_cache = getenv("XDG_CACHE_HOME")) && *xdg_cache) {
+      base = csprintf("%s", xdg_cache);
+   } else if ((home = getenv("HOME")) && *home) {
+      base = csprintf("%s/.cache", home);
+   }
+
+   char *dir;
+   if (!base || !(dir = csprintf("%s/wlc", base))) {
+      free(base);
+      return NULL;
+   }
+
+   mkdir(base, 0700);
+   free(base);
+
+   if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+      free(dir);
+      return NULL;
+   }
+
+   // Data mtime is left out of the name, so a stale entry gets replaced instead of piling up
+   const char *data = strstr(key, "# data:");
+   const uint64_t h = fnv1a(key, (data ? (size_t)(data - key) : strlen(key)));
+   char *path = csprintf("%s/keymap-%016llx.xkb", dir, (unsigned long long)h);
+   free(dir);
+   return path;
+}
+
+static char*
+disk_read(const char *path, const char *key)
+{
+   FILE *f;
+   if (!(f = fopen(path, "re")))
+      return NULL;
+
+   char *data = NULL;
+   struct stat st;
+   if (fstat(fileno(f), &st) != 0 || st.st_size <= 0 || !(data = calloc(1, st.st_size + 1)))
+      goto fail;
+
+   if (fread(data, 1, st.st_size, f) != (size_t)st.st_size)
+      goto fail;
+
+   // Full key is stored in the file, hash collisions and stale data are misses
+   const size_t len = strlen(key);
+   if (strncmp(data, key, len) != 0)
+      goto fail;
+
+   memmove(data, data + len, st.st_size - len + 1);
+   fclose(f);
+   return data;
+
+fail:
+   free(data);
+   fclose(f);
+   return NULL;
+}
+
+static void
+disk_write(const char *path, const char *key, const char *string)
+{
+   char *tmp;
+   if (!(tmp = csprintf("%s.XXXXXX", path)))
+      return;
+
+   int fd;
+   FILE *f = NULL;
+   if ((fd = mkstemp(tmp)) < 0 || !(f = fdopen(fd, "w")))
+      goto fail;
+
+   bool ok = (fputs(key, f) >= 0 && fputs(string, f) >= 0);
+   ok = (fclose(f) == 0 && ok);
+   f = NULL, fd = -1;
+
+   // Readers never see a partial file
+   if (ok && rename(tmp, path) == 0) {
+      free(tmp);
+      return;
+   }
+
+fail:
+   if (f)
+      fclose(f);
+   else if (fd >= 0)
+      close(fd);
+   unlink(tmp);
+   free(tmp);
+}
+
+static uint32_t
+memory_lookup(const char *key)
+{
+   for (uint32_t i = 0; i < MEMORY_CACHE_SIZE; ++i) {
+      if (cache.entries[i].key && !strcmp(cache.entries[i].key, key))
+         return i;
+   }
+
+   return MEMORY_CACHE_SIZE;
+}
+
+static void
+memory_release(uint32_t i)
+{
+   if (cache.entries[i].keymap)
+      xkb_map_unref(cache.entries[i].keymap);
+
+   free(cache.entries[i].key);
+   free(cache.entries[i].string);
+   memset(&cache.entries[i], 0, sizeof(cache.entries[i]));
+}
+
+static void
+memory_insert(const char *key, struct xkb_keymap *keymap, const char *string)
+{
+   const uint32_t i = cache.next;
+   cache.next = (cache.next + 1) % MEMORY_CACHE_SIZE;
+   memory_release(i);
+
+   if (!(cache.entries[i].key = strdup(key)) || !(cache.entries[i].string = strdup(string))) {
+      memory_release(i);
+      return;
+   }
+
+   cache.entries[i].keymap = xkb_map_ref(keymap);
+}
+
+void
+wlc_keymap_cache_release(void)
+{
+   for (uint32_t i = 0; i < MEMORY_CACHE_SIZE; ++i)
+      memory_release(i);
+
+   cache.next = 0;
+}
+
 void
 wlc_keymap_free(struct wlc_keymap *keymap)
 {
@@ -146,27 +414,66 @@ wlc_keymap_free(struct wlc_keymap *keymap)
 struct wlc_keymap*
 wlc_keymap_new(const struct xkb_rule_names *names, enum xkb_keymap_compile_flags flags)
 {
+   char *key = NULL, *path = NULL, *keymap_str = NULL;
+   struct xkb_context *context = NULL;
+
    struct wlc_keymap *keymap;
    if (!(keymap = calloc(1, sizeof(struct wlc_keymap))))
       goto fail;
 
-   struct xkb_context *context;
+   keymap->fd = -1;
+
    if (!(context = xkb_context_new(XKB_CONTEXT_NO_FLAGS)))
       goto context_fail;
 
-   if (!(keymap->keymap = xkb_map_new_from_names(context, names, flags)))
-      goto keymap_fail;
+   if (!(key = cache_key(context, names, flags)))
+      goto fail;
+
+   const char *source = "memory cache";
+   uint32_t cached;
+   if ((cached = memory_lookup(key)) < MEMORY_CACHE_SIZE) {
+      keymap->keymap = xkb_map_ref(cache.entries[cached].keymap);
+
+      if (!(keymap_str = strdup(cache.entries[cached].string)))
+         goto string_fail;
+   } else {
+      source = "disk cache";
+      path = cache_path(key);
+
+      if (!path || !(keymap_str = disk_read(path, key)) ||
+          !(keymap->keymap = xkb_map_new_from_string(context, keymap_str, XKB_KEYMAP_FORMAT_TEXT_V1, flags))) {
+         source = "rules";
+         free(keymap_str);
+         keymap_str = NULL;
+
+         if (!(keymap->keymap = xkb_map_new_from_names(context, names, flags)))
+            goto keymap_fail;
 
-   char *keymap_str;
-   if (!(keymap_str = xkb_map_get_as_string(keymap->keymap)))
-      goto string_fail;
+         if (!(keymap_str = xkb_map_get_as_string(keymap->keymap)))
+            goto string_fail;
+
+         if (path)
+            disk_write(path, key, keymap_str);
+      }
+
+      memory_insert(key, keymap->keymap, keymap_str);
+   }
+
+   wlc_log(WLC_LOG_INFO, "Keymap loaded from %s", source);
 
    keymap->size = strlen(keymap_str) + 1;
-   if ((keymap->fd = os_create_anonymous_file(keymap->size)) < 0)
-      goto file_fail;
+   if ((keymap->fd = create_sealed_file(keymap_str, keymap->size)) < 0) {
+      // Kernels without memfd get a writable file clients could scribble on
+      if ((keymap->fd = os_create_anonymous_file(keymap->size)) < 0)
+         goto file_fail;
 
-   if (!(keymap->area = mmap(NULL, keymap->size, PROT_READ | PROT_WRITE, MAP_SHARED, keymap->fd, 0)))
-      goto mmap_fail;
+      if ((keymap->area = mmap(NULL, keymap->size, PROT_READ | PROT_WRITE, MAP_SHARED, keymap->fd, 0)) == MAP_FAILED) {
+         keymap->area = NULL;
+         goto mmap_fail;
+      }
+
+      strcpy(keymap->area, keymap_str);
+   }
 
    for (int i = 0; i < WLC_MOD_LAST; ++i)
       keymap->mods[i] = xkb_map_mod_get_index(keymap->keymap, WLC_MOD_NAMES[i]);
@@ -175,8 +482,10 @@ wlc_keymap_new(const struct xkb_rule_names *names, enum xkb_keymap_compile_flags
       keymap->leds[i] = xkb_map_led_get_index(keymap->keymap, WLC_LED_NAMES[i]);
 
    keymap->format = WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1;
-   strcpy(keymap->area, keymap_str);
+   xkb_context_unref(context);
    free(keymap_str);
+   free(path);
+   free(key);
    return keymap;
 
 context_fail:
@@ -194,6 +503,11 @@ file_fail:
 mmap_fail:
    wlc_log(WLC_LOG_WARN, "Failed to mmap keymap");
 fail:
+   if (context)
+      xkb_context_unref(context);
+   free(keymap_str);
+   free(path);
+   free(key);
    if (keymap)
       wlc_keymap_free(keymap);
    return NULL;
@@ -40,6 +40,8 @@ struct wlc_keymap {
    xkb_led_index_t leds[WLC_LED_LAST];
 };
 
+// Drops compiled keymaps kept in memory, the disk cache stays.
+void wlc_keymap_cache_release(void);
 void wlc_keymap_free(struct wlc_keymap *keymap);
 struct wlc_keymap* wlc_keymap_new(const struct xkb_rule_names *names, enum xkb_keymap_compile_flags flags);
 
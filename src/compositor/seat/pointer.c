@@ -1,14 +1,17 @@
 #include "internal.h"
 #include "pointer.h"
 #include "macros.h"
+#include "trace.h"
 
 #include "compositor/view.h"
 #include "compositor/client.h"
 #include "compositor/output.h"
 #include "compositor/surface.h"
+#include "compositor/buffer.h"
 #include "compositor/compositor.h"
 
 #include "platform/render/render.h"
+#include "platform/backend/backend.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -31,17 +34,131 @@ view_under_pointer(struct wlc_pointer *pointer)
    if (pointer->focus && pointer->grabbing)
       return pointer->focus;
 
-   struct wlc_view *view;
-   wl_list_for_each_reverse(view, &pointer->compositor->output->space->views, link) {
-      struct wlc_geometry b;
-      wlc_view_get_bounds(view, &b, NULL);
-      if (pointer->pos.x >= b.origin.x && pointer->pos.x <= b.origin.x + (int32_t)b.size.w &&
-          pointer->pos.y >= b.origin.y && pointer->pos.y <= b.origin.y + (int32_t)b.size.h) {
-         return view;
+   return wlc_space_index_view_at(pointer->compositor->output->space, pointer->pos.x, pointer->pos.y, NULL);
+}
+
+static void
+release_hw_cursor(struct wlc_pointer *pointer)
+{
+   if (pointer->hw.bsurface && pointer->compositor) {
+      // Backend surface may be already gone with its output.
+      struct wlc_output *o;
+      wl_list_for_each(o, &pointer->compositor->outputs, link) {
+         if (o->bsurface == pointer->hw.bsurface)
+            o->bsurface->api.set_cursor(o->bsurface, NULL, NULL, NULL);
       }
    }
 
-   return NULL;
+   memset(&pointer->hw, 0, sizeof(pointer->hw));
+}
+
+static bool
+move_hw_cursor(struct wlc_pointer *pointer)
+{
+   struct wlc_output *output = pointer->compositor->output;
+   if (!output || !output->bsurface || output->bsurface != pointer->hw.bsurface || pointer->hw.dirty)
+      return false;
+
+   struct wlc_origin pos = { pointer->pos.x - pointer->hw.hotspot.x, pointer->pos.y - pointer->hw.hotspot.y };
+   output->bsurface->api.move_cursor(output->bsurface, &pos);
+   return true;
+}
+
+static bool
+shm_to_argb(struct wlc_buffer *buffer, uint32_t *out_pixels)
+{
+   struct wl_shm_buffer *shm_buffer;
+   if (!buffer->resource || !(shm_buffer = wl_shm_buffer_get(buffer->resource)))
+      return false;
+
+   uint32_t alpha;
+   switch (wl_shm_buffer_get_format(shm_buffer)) {
+      case WL_SHM_FORMAT_ARGB8888: alpha = 0; break;
+      case WL_SHM_FORMAT_XRGB8888: alpha = 0xff000000; break;
+      default: return false;
+   }
+
+   const int32_t w = wl_shm_buffer_get_width(shm_buffer), h = wl_shm_buffer_get_height(shm_buffer);
+   const int32_t stride = wl_shm_buffer_get_stride(shm_buffer);
+
+   wl_shm_buffer_begin_access(shm_buffer);
+   const uint8_t *data = wl_shm_buffer_get_data(shm_buffer);
+   for (int32_t y = 0; y < h; ++y) {
+      const uint32_t *row = (const uint32_t*)(data + y * stride);
+      for (int32_t x = 0; x < w; ++x)
+         out_pixels[y * w + x] = row[x] | alpha;
+   }
+   wl_shm_buffer_end_access(shm_buffer);
+   return true;
+}
+
+// Shows cursor on hardware cursor of output, returns false if it should be painted instead.
+static bool
+update_hw_cursor(struct wlc_pointer *pointer, struct wlc_output *output)
+{
+   struct wlc_backend_surface *bsurface = output->bsurface;
+   if (!bsurface || !bsurface->api.set_cursor)
+      goto fallback;
+
+   struct wlc_buffer *buffer = NULL;
+   uint32_t serial = 0;
+   bool builtin = false;
+
+   if (pointer->surface) {
+      if (!(buffer = pointer->surface->commit.buffer))
+         goto fallback;
+
+      serial = pointer->surface->commit_serial;
+   } else if (!pointer->focus || pointer->focus->x11_window) {
+      builtin = true;
+   }
+
+   // Buffer may be reused for new contents, only the commit serial tells if the image changed.
+   if (bsurface == pointer->hw.bsurface && serial == pointer->hw.serial && builtin == pointer->hw.builtin && !pointer->hw.dirty)
+      return move_hw_cursor(pointer);
+
+   if (pointer->hw.bsurface && pointer->hw.bsurface != bsurface)
+      release_hw_cursor(pointer);
+
+   uint32_t *pixels = NULL;
+   struct wlc_size size = wlc_size_zero;
+   struct wlc_origin hotspot = wlc_origin_zero;
+
+   if (buffer) {
+      size = buffer->size;
+      hotspot = pointer->tip;
+
+      if (!(pixels = malloc(size.w * size.h * sizeof(uint32_t))) || !shm_to_argb(buffer, pixels))
+         goto upload_fail;
+   } else if (builtin) {
+      size = (struct wlc_size){ WLC_POINTER_CURSOR_SIZE, WLC_POINTER_CURSOR_SIZE };
+
+      if (!(pixels = malloc(size.w * size.h * sizeof(uint32_t))))
+         goto upload_fail;
+
+      const uint32_t colors[] = { 0xff000000, 0xffffffff, 0x00000000 };
+      for (uint32_t i = 0; i < size.w * size.h; ++i)
+         pixels[i] = colors[wlc_pointer_cursor_palette[i]];
+   }
+
+   if (!bsurface->api.set_cursor(bsurface, pixels, &size, &hotspot))
+      goto upload_fail;
+
+   free(pixels);
+
+   // Backend copied the pixels, the buffer is not needed after upload.
+   pointer->hw.bsurface = bsurface;
+   pointer->hw.serial = serial;
+   pointer->hw.hotspot = hotspot;
+   pointer->hw.builtin = builtin;
+   pointer->hw.dirty = false;
+   return move_hw_cursor(pointer);
+
+upload_fail:
+   free(pixels);
+fallback:
+   release_hw_cursor(pointer);
+   return false;
 }
 
 static void
@@ -85,6 +202,9 @@ wlc_pointer_focus(struct wlc_pointer *pointer, struct wlc_view *view, struct wlc
    if (pointer->focus == view)
       return;
 
+   // Focus decides between built-in and hidden cursor.
+   pointer->hw.dirty = true;
+
    struct wl_resource *focused = (is_valid_view(pointer->focus) ? pointer->focus->client->input[WLC_POINTER] : NULL);
    struct wl_resource *focus = (is_valid_view(view) ? view->client->input[WLC_POINTER] : NULL);
 
@@ -124,6 +244,7 @@ wlc_pointer_button(struct wlc_pointer *pointer, uint32_t time, uint32_t button,
 
    uint32_t serial = wl_display_next_serial(wlc_display());
    wl_pointer_send_button(pointer->focus->client->input[WLC_POINTER], serial, time, button, state);
+   WLC_TRACE(WLC_TRACE_INPUT_DELIVERED, pointer->focus, WLC_INPUT_EVENT_BUTTON);
 }
 
 void
@@ -139,10 +260,12 @@ wlc_pointer_scroll(struct wlc_pointer *pointer, uint32_t time, uint8_t axis_bits
 
    if (axis_bits & WLC_SCROLL_AXIS_HORIZONTAL)
       wl_pointer_send_axis(pointer->focus->client->input[WLC_POINTER], time, WL_POINTER_AXIS_HORIZONTAL_SCROLL, wl_fixed_from_double(amount[1]));
+
+   WLC_TRACE(WLC_TRACE_INPUT_DELIVERED, pointer->focus, WLC_INPUT_EVENT_SCROLL);
 }
 
 void
-wlc_pointer_motion(struct wlc_pointer *pointer, uint32_t time, const struct wlc_pointer_origin *pos)
+wlc_pointer_motion(struct wlc_pointer *pointer, uint32_t time, uint64_t arrival, const struct wlc_pointer_origin *pos)
 {
    assert(pointer);
    memcpy(&pointer->pos, pos, sizeof(pointer->pos));
@@ -151,13 +274,16 @@ wlc_pointer_motion(struct wlc_pointer *pointer, uint32_t time, const struct wlc_
    struct wlc_pointer_origin d;
    wlc_pointer_focus(pointer, focused, &d);
 
-   if (pointer->compositor->output)
+   // Cursor only movement does not need composition.
+   if (pointer->compositor->output && !move_hw_cursor(pointer))
       wlc_output_schedule_repaint(pointer->compositor->output);
 
    if (!is_valid_view(focused))
       return;
 
    wl_pointer_send_motion(focused->client->input[WLC_POINTER], time, wl_fixed_from_double(d.x), wl_fixed_from_double(d.y));
+   WLC_TRACE(WLC_TRACE_INPUT_DELIVERED, focused, WLC_INPUT_EVENT_MOTION);
+   wlc_output_input_dispatched(pointer->compositor->output, arrival);
 
    if (pointer->grabbing) {
       struct wlc_geometry g = focused->pending.geometry;
@@ -189,9 +315,13 @@ wlc_pointer_motion(struct wlc_pointer *pointer, uint32_t time, const struct wlc_
             g.size.h = fmax(min.h, g.size.h + dy);
          }
 
-         wlc_view_set_state(focused, WLC_BIT_RESIZING, true);
+         if (!(focused->pending.state & WLC_BIT_RESIZING))
+            wlc_view_set_state(focused, WLC_BIT_RESIZING, true);
+
+         // Sizes are coalesced in pending geometry until the client commits the last configure
          focused->resizing = pointer->action_edges;
-         wlc_view_set_geometry(focused, &g);
+         if (!wlc_geometry_equals(&g, &focused->pending.geometry))
+            wlc_view_set_geometry(focused, &g);
       }
 
       pointer->grab = (struct wlc_origin){ pointer->pos.x, pointer->pos.y };
@@ -211,7 +341,7 @@ wlc_pointer_touch(struct wlc_pointer *pointer, uint32_t time, enum wlc_touch_typ
       struct wlc_pointer_origin d;
       wlc_pointer_focus(pointer, focused, &d);
 
-      if (pointer->compositor->output)
+      if (pointer->compositor->output && !move_hw_cursor(pointer))
          wlc_output_schedule_repaint(pointer->compositor->output);
    }
 
@@ -245,6 +375,8 @@ wlc_pointer_touch(struct wlc_pointer *pointer, uint32_t time, enum wlc_touch_typ
          wl_touch_send_cancel(focused->client->input[WLC_TOUCH]);
          break;
    }
+
+   WLC_TRACE(WLC_TRACE_INPUT_DELIVERED, focused, WLC_INPUT_EVENT_TOUCH);
 }
 
 void
@@ -253,18 +385,14 @@ wlc_pointer_remove_client_for_resource(struct wlc_pointer *pointer, struct wl_re
    assert(pointer && resource);
 
    struct wlc_client *client;
-   wl_list_for_each(client, &pointer->compositor->clients, link) {
-      if (client->input[WLC_POINTER] != resource)
-         continue;
-
-      if (pointer->focus && pointer->focus->client && pointer->focus->client->input[WLC_POINTER] == resource) {
-         client->input[WLC_POINTER] = NULL;
-         wlc_pointer_focus(pointer, NULL, NULL);
-      } else {
-         client->input[WLC_POINTER] = NULL;
-      }
-
+   if (!(client = wlc_client_for_wl_client(&pointer->compositor->clients, wl_resource_get_client(resource))) || client->input[WLC_POINTER] != resource)
       return;
+
+   if (pointer->focus && pointer->focus->client && pointer->focus->client->input[WLC_POINTER] == resource) {
+      client->input[WLC_POINTER] = NULL;
+      wlc_pointer_focus(pointer, NULL, NULL);
+   } else {
+      client->input[WLC_POINTER] = NULL;
    }
 }
 
@@ -278,14 +406,19 @@ wlc_pointer_set_surface(struct wlc_pointer *pointer, struct wlc_surface *surface
    if (pointer->surface)
       wlc_surface_invalidate(pointer->surface);
 
+   pointer->hw.dirty = true;
+
    if ((pointer->surface = surface))
       wlc_surface_attach_to_output(surface, pointer->compositor->output, surface->commit.buffer);
+   else if (pointer->compositor->output)
+      wlc_output_schedule_repaint(pointer->compositor->output);
 }
 
 void
-wlc_pointer_paint(struct wlc_pointer *pointer, struct wlc_render *render)
+wlc_pointer_paint(struct wlc_pointer *pointer, struct wlc_output *output)
 {
-   assert(pointer);
+   assert(pointer && output);
+   struct wlc_render *render = output->render;
 
    // Skip draw if surface is not on same context.
    // XXX: Should we draw default instead?
@@ -299,6 +432,9 @@ wlc_pointer_paint(struct wlc_pointer *pointer, struct wlc_render *render)
    if (pointer->focus != focused)
       wlc_pointer_focus(pointer, focused, NULL);
 
+   if (update_hw_cursor(pointer, output))
+      return;
+
    if (pointer->surface) {
       wlc_render_surface_paint(render, pointer->surface, &(struct wlc_origin){ pointer->pos.x - pointer->tip.x, pointer->pos.y - pointer->tip.y });
    } else if (!pointer->focus || pointer->focus->x11_window) {
@@ -315,7 +451,7 @@ wlc_pointer_free(struct wlc_pointer *pointer)
 
    if (pointer->compositor) {
       struct wlc_client *client;
-      wl_list_for_each(client, &pointer->compositor->clients, link) {
+      wl_list_for_each(client, &pointer->compositor->clients.list, link) {
          if (!client->input[WLC_POINTER])
             continue;
 
@@ -324,6 +460,7 @@ wlc_pointer_free(struct wlc_pointer *pointer)
       }
    }
 
+   // Backend surfaces take their cursors with them.
    free(pointer);
 }
 
@@ -339,3 +476,21 @@ wlc_pointer_new(struct wlc_compositor *compositor)
    pointer->compositor = compositor;
    return pointer;
 }
+
+// 0 == black, 1 == white, 2 == transparent
+const uint8_t wlc_pointer_cursor_palette[WLC_POINTER_CURSOR_SIZE * WLC_POINTER_CURSOR_SIZE] = {
+  0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01, 0x02,
+  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02, 0x02,
+  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02, 0x02, 0x02,
+  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02, 0x02, 0x02,
+  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02, 0x02,
+  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02,
+  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02,
+  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+  0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02,
+  0x01, 0x00, 0x01, 0x02, 0x02, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02,
+  0x01, 0x01, 0x02, 0x02, 0x02, 0x02, 0x01, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02, 0x02,
+  0x01, 0x01, 0x02, 0x02, 0x02, 0x02, 0x02, 0x01, 0x00, 0x01, 0x02, 0x02, 0x02, 0x02,
+  0x01, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x01, 0x02, 0x02, 0x02, 0x02, 0x02
+};
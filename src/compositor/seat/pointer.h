@@ -22,7 +22,13 @@ struct wl_resource;
 struct wlc_view;
 struct wlc_client;
 struct wlc_surface;
-struct wlc_render;
+struct wlc_buffer;
+struct wlc_output;
+struct wlc_backend_surface;
+
+// Built-in cursor image, also used by the renderer.
+#define WLC_POINTER_CURSOR_SIZE 14
+extern const uint8_t wlc_pointer_cursor_palette[WLC_POINTER_CURSOR_SIZE * WLC_POINTER_CURSOR_SIZE];
 
 // We want to store internally for sub-pixel precision
 // Events to wlc goes as wlc_origin though.
@@ -40,6 +46,16 @@ struct wlc_pointer {
    struct wlc_origin tip;
    struct wlc_origin grab;
 
+   // Cursor image shown on backend surface hardware cursor.
+   // serial is the commit serial of the uploaded cursor surface,
+   // serial == 0 && !builtin means hidden cursor.
+   struct {
+      struct wlc_backend_surface *bsurface;
+      uint32_t serial;
+      struct wlc_origin hotspot;
+      bool builtin, dirty;
+   } hw;
+
    uint32_t action_edges;
    enum grab_action action;
    bool grabbing;
@@ -48,11 +64,11 @@ struct wlc_pointer {
 void wlc_pointer_focus(struct wlc_pointer *pointer, struct wlc_view *view, struct wlc_pointer_origin *out_pos);
 void wlc_pointer_button(struct wlc_pointer *pointer, uint32_t time, uint32_t button, enum wl_pointer_button_state state);
 void wlc_pointer_scroll(struct wlc_pointer *pointer, uint32_t time, uint8_t axis_bits, double amount[2]);
-void wlc_pointer_motion(struct wlc_pointer *pointer, uint32_t time, const struct wlc_pointer_origin *pos);
+void wlc_pointer_motion(struct wlc_pointer *pointer, uint32_t time, uint64_t arrival, const struct wlc_pointer_origin *pos);
 void wlc_pointer_touch(struct wlc_pointer *pointer, uint32_t time, enum wlc_touch_type type, int32_t slot, const struct wlc_origin *pos);
 void wlc_pointer_remove_client_for_resource(struct wlc_pointer *pointer, struct wl_resource *resource);
 void wlc_pointer_set_surface(struct wlc_pointer *pointer, struct wlc_surface *surface, const struct wlc_origin *tip);
-void wlc_pointer_paint(struct wlc_pointer *pointer, struct wlc_render *render);
+void wlc_pointer_paint(struct wlc_pointer *pointer, struct wlc_output *output);
 void wlc_pointer_free(struct wlc_pointer *pointer);
 struct wlc_pointer* wlc_pointer_new(struct wlc_compositor *compositor);
 
@@ -5,6 +5,8 @@
 #include "keyboard.h"
 #include "keymap.h"
 #include "macros.h"
+#include "trace.h"
+#include "capture.h"
 
 #include "compositor/compositor.h"
 #include "compositor/output.h"
@@ -23,7 +25,8 @@
 static void
 wl_cb_pointer_set_cursor(struct wl_client *wl_client, struct wl_resource *resource, uint32_t serial, struct wl_resource *surface_resource, int32_t hotspot_x, int32_t hotspot_y)
 {
-   (void)serial;
+   wlc_capture(wl_client, WLC_CAPTURE_POINTER_SET_CURSOR, 5, wl_resource_get_id(resource), serial, (surface_resource ? wl_resource_get_id(surface_resource) : 0), hotspot_x, hotspot_y);
+
    struct wlc_pointer *pointer = wl_resource_get_user_data(resource);
    struct wlc_surface *surface = (surface_resource ? wl_resource_get_user_data(surface_resource) : NULL);
 
@@ -55,13 +58,15 @@ wl_cb_pointer_client_destructor(struct wl_resource *resource)
 static void
 wl_cb_seat_get_pointer(struct wl_client *wl_client, struct wl_resource *resource, uint32_t id)
 {
+   wlc_capture(wl_client, WLC_CAPTURE_SEAT_GET_POINTER, 1, id);
+
    struct wlc_seat *seat = wl_resource_get_user_data(resource);
 
    if (!seat->pointer)
       return;
 
    struct wlc_client *client;
-   if (!(client = wlc_client_for_client_with_wl_client_in_list(wl_client, &seat->compositor->clients))) {
+   if (!(client = wlc_client_for_wl_client(&seat->compositor->clients, wl_client))) {
       wl_resource_post_error(resource, 1, "client was not found (out of memory?)");
       return;
    }
@@ -91,14 +96,14 @@ wl_cb_keyboard_client_destructor(struct wl_resource *resource)
 static void
 wl_cb_seat_get_keyboard(struct wl_client *wl_client, struct wl_resource *resource, uint32_t id)
 {
-   (void)wl_client;
+   wlc_capture(wl_client, WLC_CAPTURE_SEAT_GET_KEYBOARD, 1, id);
    struct wlc_seat *seat = wl_resource_get_user_data(resource);
 
    if (!seat->keyboard)
       return;
 
    struct wlc_client *client;
-   if (!(client = wlc_client_for_client_with_wl_client_in_list(wl_client, &seat->compositor->clients))) {
+   if (!(client = wlc_client_for_wl_client(&seat->compositor->clients, wl_client))) {
       wl_resource_post_error(resource, 1, "client was not found (out of memory?)");
       return;
    }
@@ -137,7 +142,7 @@ wl_cb_seat_get_touch(struct wl_client *wl_client, struct wl_resource *resource,
       return;
 
    struct wlc_client *client;
-   if (!(client = wlc_client_for_client_with_wl_client_in_list(wl_client, &seat->compositor->clients))) {
+   if (!(client = wlc_client_for_wl_client(&seat->compositor->clients, wl_client))) {
       wl_resource_post_error(resource, 1, "client was not found (out of memory?)");
       return;
    }
@@ -234,7 +239,7 @@ seat_handle_key(struct wlc_seat *seat, const struct wlc_input_event *ev)
    if (!wlc_keyboard_request_key(seat->keyboard, ev->time, &seat->modifiers, ev->key.code, ev->key.state))
       return;
 
-   wlc_keyboard_key(seat->keyboard, ev->time, ev->key.code, ev->key.state);
+   wlc_keyboard_key(seat->keyboard, ev->time, ev->arrival, ev->key.code, ev->key.state);
 }
 
 static void
@@ -246,6 +251,8 @@ input_event(struct wl_listener *listener, void *data)
    if (!(seat = wl_container_of(listener, seat, listener.input)))
       return;
 
+   WLC_TRACE(WLC_TRACE_INPUT_RECEIVED, seat, ev->type);
+
    // Wake up output
    if (seat->compositor->output) {
       bool was_asleep = seat->compositor->output->sleeping;
@@ -269,7 +276,7 @@ input_event(struct wl_listener *listener, void *data)
             if (WLC_INTERFACE_EMIT_EXCEPT(pointer.motion, false, seat->compositor, seat->pointer->focus, ev->time, &(struct wlc_origin){ pos.x, pos.y }))
                return;
 
-            wlc_pointer_motion(seat->pointer, ev->time, &pos);
+            wlc_pointer_motion(seat->pointer, ev->time, ev->arrival, &pos);
          }
          break;
 
@@ -285,7 +292,7 @@ input_event(struct wl_listener *listener, void *data)
             if (WLC_INTERFACE_EMIT_EXCEPT(pointer.motion, false, seat->compositor, seat->pointer->focus, ev->time, &(struct wlc_origin){ pos.x, pos.y }))
                return;
 
-            wlc_pointer_motion(seat->pointer, ev->time, &pos);
+            wlc_pointer_motion(seat->pointer, ev->time, ev->arrival, &pos);
          }
          break;
 
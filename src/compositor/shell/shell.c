@@ -22,7 +22,7 @@ wl_cb_shell_get_shell_surface(struct wl_client *wl_client, struct wl_resource *r
    struct wlc_surface *surface = wl_resource_get_user_data(surface_resource);
 
    struct wlc_client *client;
-   if (!(client = wlc_client_for_client_with_wl_client_in_list(wl_client, &shell->compositor->clients))) {
+   if (!(client = wlc_client_for_wl_client(&shell->compositor->clients, wl_client))) {
       wl_resource_post_error(resource, WL_DISPLAY_ERROR_INVALID_OBJECT, "Could not find wlc_client for wl_client");
       return;
    }
@@ -136,6 +136,7 @@ wl_cb_shell_surface_destructor(struct wl_resource *resource)
    assert(resource);
    struct wlc_view *view = wl_resource_get_user_data(resource);
    view->shell_surface.resource = NULL;
+   wlc_view_invalidate_bounds(view);
    wlc_shell_surface_release(&view->shell_surface);
 }
 
@@ -152,6 +153,7 @@ wlc_shell_surface_implement(struct wlc_shell_surface *shell_surface, struct wlc_
 
    shell_surface->resource = resource;
    wl_resource_set_implementation(shell_surface->resource, &wl_shell_surface_implementation, view, wl_cb_shell_surface_destructor);
+   wlc_view_invalidate_bounds(view);
 }
 
 void
@@ -2,6 +2,7 @@
 #include "macros.h"
 #include "xdg-shell.h"
 #include "xdg-surface.h"
+#include "capture.h"
 
 #include "compositor/compositor.h"
 #include "compositor/surface.h"
@@ -28,11 +29,13 @@ xdg_cb_shell_use_unstable_version(struct wl_client *wl_client, struct wl_resourc
 static void
 xdg_cb_shell_get_surface(struct wl_client *wl_client, struct wl_resource *resource, uint32_t id, struct wl_resource *surface_resource)
 {
+   wlc_capture(wl_client, WLC_CAPTURE_XDG_GET_SURFACE, 2, id, wl_resource_get_id(surface_resource));
+
    struct wlc_xdg_shell *xdg_shell = wl_resource_get_user_data(resource);
    struct wlc_surface *surface = wl_resource_get_user_data(surface_resource);
 
    struct wlc_client *client;
-   if (!(client = wlc_client_for_client_with_wl_client_in_list(wl_client, &xdg_shell->compositor->clients))) {
+   if (!(client = wlc_client_for_wl_client(&xdg_shell->compositor->clients, wl_client))) {
       wl_resource_post_error(resource, WL_DISPLAY_ERROR_INVALID_OBJECT, "Could not find wlc_client for wl_client");
       return;
    }
@@ -66,7 +69,7 @@ xdg_cb_shell_get_popup(struct wl_client *wl_client, struct wl_resource *resource
    }
 
    struct wlc_client *client;
-   if (!(client = wlc_client_for_client_with_wl_client_in_list(wl_client, &xdg_shell->compositor->clients))) {
+   if (!(client = wlc_client_for_wl_client(&xdg_shell->compositor->clients, wl_client))) {
       wl_resource_post_error(resource, WL_DISPLAY_ERROR_INVALID_OBJECT, "Could not find wlc_client for wl_client");
       return;
    }
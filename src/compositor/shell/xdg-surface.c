@@ -1,5 +1,6 @@
 #include "xdg-surface.h"
 #include "macros.h"
+#include "capture.h"
 
 #include "compositor/view.h"
 #include "compositor/surface.h"
@@ -16,7 +17,7 @@
 static void
 xdg_cb_surface_destroy(struct wl_client *wl_client, struct wl_resource *resource)
 {
-   (void)wl_client, (void)resource;
+   wlc_capture(wl_client, WLC_CAPTURE_XDG_SURFACE_DESTROY, 1, wl_resource_get_id(resource));
    wl_resource_destroy(resource);
 }
 
@@ -80,17 +81,19 @@ xdg_cb_surface_resize(struct wl_client *wl_client, struct wl_resource *resource,
 static void
 xdg_cb_surface_ack_configure(struct wl_client *wl_client, struct wl_resource *resource, uint32_t serial)
 {
-   (void)wl_client, (void)serial;
-   (void)resource;
-   // XXX: Some clients such simple-damage from weston does not trigger this
-   // struct wlc_view *view = wl_resource_get_user_data(resource);
-   // view->ack = ACK_NEXT_COMMIT;
+   (void)wl_client;
+   wlc_capture(wl_client, WLC_CAPTURE_XDG_SURFACE_ACK_CONFIGURE, 2, wl_resource_get_id(resource), serial);
+
+   // XXX: Some clients such simple-damage from weston does not trigger this,
+   //      they keep completing configures on their next commit.
+   struct wlc_view *view = wl_resource_get_user_data(resource);
+   view->configure.acked = serial;
 }
 
 static void
 xdg_cb_surface_set_window_geometry(struct wl_client *wl_client, struct wl_resource *resource, int32_t x, int32_t y, int32_t width, int32_t height)
 {
-   (void)wl_client;
+   wlc_capture(wl_client, WLC_CAPTURE_XDG_SURFACE_WINDOW_GEOMETRY, 5, wl_resource_get_id(resource), x, y, width, height);
    struct wlc_view *view = wl_resource_get_user_data(resource);
    view->pending.visible = (struct wlc_geometry){ { x, y }, { width, height } };
 }
@@ -165,6 +168,7 @@ xdg_cb_surface_destructor(struct wl_resource *resource)
    assert(resource);
    struct wlc_view *view = wl_resource_get_user_data(resource);
    view->xdg_surface.resource = NULL;
+   wlc_view_invalidate_bounds(view);
    wlc_xdg_surface_release(&view->xdg_surface);
 }
 
@@ -181,6 +185,7 @@ wlc_xdg_surface_implement(struct wlc_xdg_surface *xdg_surface, struct wlc_view *
 
    xdg_surface->resource = resource;
    wl_resource_set_implementation(xdg_surface->resource, &xdg_surface_implementation, view, xdg_cb_surface_destructor);
+   wlc_view_invalidate_bounds(view);
 }
 
 void
@@ -0,0 +1,255 @@
+#include "internal.h"
+#include "space-index.h"
+#include "output.h"
+#include "view.h"
+#include "surface.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#include <pixman.h>
+#include <wayland-server.h>
+
+// Cells are hashed into a fixed number of buckets, so the grid is unbounded and
+// a bucket may hold views of other cells. Candidates are always tested against
+// their bounds, the topmost by stacking order wins.
+
+#define CELL_SHIFT 8 // 256px cells
+#define MAX_CELLS 64 // larger views are tested on every query
+
+static int32_t
+cell(int32_t v)
+{
+   // Arithmetic shift, floors negative coordinates
+   return v >> CELL_SHIFT;
+}
+
+static struct wl_array*
+bucket(struct wlc_space_index *index, int32_t cx, int32_t cy)
+{
+   const uint32_t h = ((uint32_t)cx * 73856093u) ^ ((uint32_t)cy * 19349663u);
+   return &index->buckets[h & (WLC_SPACE_INDEX_BUCKETS - 1)];
+}
+
+static bool
+array_append(struct wl_array *array, struct wlc_view *view)
+{
+   struct wlc_view **slot;
+   if (!(slot = wl_array_add(array, sizeof(struct wlc_view*))))
+      return false;
+
+   *slot = view;
+   return true;
+}
+
+static void
+array_remove(struct wl_array *array, struct wlc_view *view)
+{
+   struct wlc_view **views = array->data;
+   const size_t count = array->size / sizeof(struct wlc_view*);
+   for (size_t i = 0; i < count; ++i) {
+      if (views[i] != view)
+         continue;
+
+      views[i] = views[count - 1];
+      array->size -= sizeof(struct wlc_view*);
+      return;
+   }
+}
+
+static uint64_t
+cell_range(const struct wlc_geometry *b, int32_t out[4])
+{
+   // Bounds are inclusive of their right and bottom edge, like the hit test
+   out[0] = cell(b->origin.x);
+   out[1] = cell(b->origin.y);
+   out[2] = cell(b->origin.x + (int32_t)b->size.w);
+   out[3] = cell(b->origin.y + (int32_t)b->size.h);
+   return (uint64_t)(out[2] - out[0] + 1) * (uint64_t)(out[3] - out[1] + 1);
+}
+
+static void
+unlink_view(struct wlc_space_index *index, struct wlc_view *view)
+{
+   if (!view->index.indexed)
+      return;
+
+   int32_t r[4];
+   if (view->index.large) {
+      array_remove(&index->large, view);
+   } else {
+      cell_range(&view->index.bounds, r);
+      for (int32_t cy = r[1]; cy <= r[3]; ++cy) {
+         for (int32_t cx = r[0]; cx <= r[2]; ++cx)
+            array_remove(bucket(index, cx, cy), view);
+      }
+   }
+
+   view->index.indexed = view->index.large = false;
+}
+
+static void
+link_view(struct wlc_space_index *index, struct wlc_view *view)
+{
+   wlc_view_get_bounds(view, &view->index.bounds, NULL);
+   view->index.indexed = true;
+
+   int32_t r[4];
+   if (cell_range(&view->index.bounds, r) <= MAX_CELLS) {
+      for (int32_t cy = r[1]; cy <= r[3]; ++cy) {
+         for (int32_t cx = r[0]; cx <= r[2]; ++cx) {
+            if (!array_append(bucket(index, cx, cy), view))
+               goto large;
+         }
+      }
+
+      return;
+   }
+
+large:
+   // Out of memory in the grid, fall back to testing on every query
+   unlink_view(index, view);
+   view->index.indexed = view->index.large = array_append(&index->large, view);
+}
+
+static void
+flush(struct wlc_space *space)
+{
+   struct wlc_space_index *index = &space->index;
+
+   struct wlc_view *view, *vn;
+   wl_list_for_each_safe(view, vn, &index->dirty, index.dirty_link) {
+      unlink_view(index, view);
+      link_view(index, view);
+      wl_list_remove(&view->index.dirty_link);
+      view->index.dirty = false;
+   }
+
+   if (!index->restack)
+      return;
+
+   // Views are stacked bottom to top in the list
+   uint32_t stack = 0;
+   wl_list_for_each(view, &space->views, link)
+      view->index.stack = ++stack;
+
+   index->restack = false;
+}
+
+static bool
+accepts_input(struct wlc_view *view, double x, double y)
+{
+   struct wlc_surface *surface = view->surface;
+   if (!surface || !surface->size.w || !surface->size.h)
+      return true;
+
+   // Same mapping as wlc_pointer_focus uses for surface coordinates
+   struct wlc_geometry b, v;
+   wlc_view_get_bounds(view, &b, &v);
+   const double sx = (x - v.origin.x) * surface->size.w / v.size.w;
+   const double sy = (y - v.origin.y) * surface->size.h / v.size.h;
+
+   // Borders around a scaled surface belong to the view
+   if (sx < 0 || sy < 0 || sx >= surface->size.w || sy >= surface->size.h)
+      return true;
+
+   return pixman_region32_contains_point(&surface->commit.input, sx, sy, NULL);
+}
+
+static struct wlc_view*
+test_views(struct wl_array *array, struct wlc_view *best, double x, double y)
+{
+   struct wlc_view **views = array->data;
+   const size_t count = array->size / sizeof(struct wlc_view*);
+   for (size_t i = 0; i < count; ++i) {
+      struct wlc_view *view = views[i];
+      if (best && view->index.stack <= best->index.stack)
+         continue;
+
+      const struct wlc_geometry *b = &view->index.bounds;
+      if (x < b->origin.x || x > b->origin.x + (int32_t)b->size.w || y < b->origin.y || y > b->origin.y + (int32_t)b->size.h)
+         continue;
+
+      if (accepts_input(view, x, y))
+         best = view;
+   }
+
+   return best;
+}
+
+struct wlc_view*
+wlc_space_index_view_at(struct wlc_space *space, double x, double y, struct wlc_geometry *out_visible)
+{
+   assert(space);
+   flush(space);
+
+   struct wlc_view *view = test_views(&space->index.large, NULL, x, y);
+   view = test_views(bucket(&space->index, cell(floor(x)), cell(floor(y))), view, x, y);
+
+   if (view && out_visible) {
+      struct wlc_geometry b;
+      wlc_view_get_bounds(view, &b, out_visible);
+   }
+
+   return view;
+}
+
+void
+wlc_space_index_dirty(struct wlc_view *view)
+{
+   assert(view);
+
+   if (view->index.dirty || !view->space)
+      return;
+
+   wl_list_insert(view->space->index.dirty.prev, &view->index.dirty_link);
+   view->index.dirty = true;
+}
+
+void
+wlc_space_index_restack(struct wlc_space *space)
+{
+   if (space)
+      space->index.restack = true;
+}
+
+void
+wlc_space_index_remove(struct wlc_view *view)
+{
+   assert(view);
+
+   if (view->index.dirty) {
+      wl_list_remove(&view->index.dirty_link);
+      view->index.dirty = false;
+   }
+
+   if (view->space)
+      unlink_view(&view->space->index, view);
+}
+
+void
+wlc_space_index_release(struct wlc_space_index *index)
+{
+   assert(index);
+
+   for (uint32_t i = 0; i < WLC_SPACE_INDEX_BUCKETS; ++i)
+      wl_array_release(&index->buckets[i]);
+
+   wl_array_release(&index->large);
+   memset(index, 0, sizeof(struct wlc_space_index));
+}
+
+void
+wlc_space_index_init(struct wlc_space_index *index)
+{
+   assert(index);
+   memset(index, 0, sizeof(struct wlc_space_index));
+
+   for (uint32_t i = 0; i < WLC_SPACE_INDEX_BUCKETS; ++i)
+      wl_array_init(&index->buckets[i]);
+
+   wl_array_init(&index->large);
+   wl_list_init(&index->dirty);
+}
@@ -0,0 +1,39 @@
+#ifndef _WLC_SPACE_INDEX_H_
+#define _WLC_SPACE_INDEX_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <wayland-util.h>
+
+#include "types/geometry.h"
+
+struct wlc_view;
+struct wlc_space;
+
+#define WLC_SPACE_INDEX_BUCKETS 256 // hashed grid cells, power of two
+
+// Uniform grid over view bounds for hit-testing.
+// Views are reindexed lazily on the next query after they were marked dirty.
+struct wlc_space_index {
+   struct wl_array buckets[WLC_SPACE_INDEX_BUCKETS]; // struct wlc_view*
+   struct wl_array large; // views spanning too many cells
+   struct wl_list dirty;
+   bool restack;
+};
+
+// Index state kept in each view.
+struct wlc_space_index_entry {
+   struct wlc_geometry bounds; // as indexed
+   struct wl_list dirty_link;
+   uint32_t stack; // position in space views, higher is above
+   bool indexed, large, dirty;
+};
+
+void wlc_space_index_dirty(struct wlc_view *view);
+void wlc_space_index_restack(struct wlc_space *space);
+void wlc_space_index_remove(struct wlc_view *view);
+struct wlc_view* wlc_space_index_view_at(struct wlc_space *space, double x, double y, struct wlc_geometry *out_visible);
+void wlc_space_index_release(struct wlc_space_index *index);
+void wlc_space_index_init(struct wlc_space_index *index);
+
+#endif /* _WLC_SPACE_INDEX_H_ */
@@ -6,7 +6,10 @@
 #include "region.h"
 #include "buffer.h"
 #include "callback.h"
+#include "client.h"
 #include "macros.h"
+#include "trace.h"
+#include "capture.h"
 
 #include "platform/render/render.h"
 
@@ -59,9 +62,15 @@ state_set_buffer(struct wlc_surface_state *state, struct wlc_buffer *buffer)
 static void
 commit_state(struct wlc_surface *surface, struct wlc_surface_state *pending, struct wlc_surface_state *out)
 {
+   // FIXME: contains global state
+   static uint32_t serial;
+
    if (pending->attached) {
       surface_attach(surface, pending->buffer);
       pending->attached = false;
+
+      if (!(surface->commit_serial = ++serial))
+         surface->commit_serial = ++serial;
    }
 
    state_set_buffer(out, pending->buffer);
@@ -105,13 +114,15 @@ release_state(struct wlc_surface_state *state)
 static void
 wl_cb_surface_destroy(struct wl_client *wl_client, struct wl_resource *resource)
 {
-   (void)wl_client;
+   wlc_capture(wl_client, WLC_CAPTURE_SURFACE_DESTROY, 1, wl_resource_get_id(resource));
    wl_resource_destroy(resource);
 }
 
 static void
 wl_cb_surface_attach(struct wl_client *wl_client, struct wl_resource *resource, struct wl_resource *buffer_resource, int32_t x, int32_t y)
 {
+   wlc_capture_attach(wl_client, resource, buffer_resource, x, y);
+
    struct wlc_surface *surface = wl_resource_get_user_data(resource);
 
    // We can't set or get buffer_resource user data.
@@ -125,9 +136,14 @@ wl_cb_surface_attach(struct wl_client *wl_client, struct wl_resource *resource,
    // and the container_of macro to get owner.
 
    struct wlc_buffer *buffer = NULL;
-   if (buffer_resource && !(buffer = wlc_buffer_resource_get_container(buffer_resource)) && !(buffer = wlc_buffer_new(buffer_resource))) {
-      wl_client_post_no_memory(wl_client);
-      return;
+   if (buffer_resource && !(buffer = wlc_buffer_resource_get_container(buffer_resource))) {
+      if (!(buffer = wlc_buffer_new(buffer_resource))) {
+         wl_client_post_no_memory(wl_client);
+         return;
+      }
+
+      buffer->client = surface->client;
+      wlc_client_acquire(buffer->client, WLC_CLIENT_BUFFERS, 1);
    }
 
    state_set_buffer(&surface->pending, buffer);
@@ -135,13 +151,13 @@ wl_cb_surface_attach(struct wl_client *wl_client, struct wl_resource *resource,
    surface->pending.offset = (struct wlc_origin){ x, y };
    surface->pending.attached = true;
 
-   wlc_dlog(WLC_DBG_RENDER, "-> Attach request");
+   WLC_TRACE(WLC_TRACE_ATTACH, surface, (buffer ? wl_resource_get_id(buffer_resource) : 0));
 }
 
 static void
 wl_cb_surface_damage(struct wl_client *wl_client, struct wl_resource *resource, int32_t x, int32_t y, int32_t width, int32_t height)
 {
-   (void)wl_client;
+   wlc_capture(wl_client, WLC_CAPTURE_SURFACE_DAMAGE, 5, wl_resource_get_id(resource), x, y, width, height);
    struct wlc_surface *surface = wl_resource_get_user_data(resource);
    pixman_region32_union_rect(&surface->pending.damage, &surface->pending.damage, x, y, width, height);
    wlc_dlog(WLC_DBG_RENDER, "-> Damage request");
@@ -150,6 +166,8 @@ wl_cb_surface_damage(struct wl_client *wl_client, struct wl_resource *resource,
 static void
 wl_cb_surface_frame(struct wl_client *wl_client, struct wl_resource *resource, uint32_t callback_id)
 {
+   wlc_capture(wl_client, WLC_CAPTURE_SURFACE_FRAME, 2, wl_resource_get_id(resource), callback_id);
+
    struct wl_resource *callback_resource;
    if (!(callback_resource = wl_resource_create(wl_client, &wl_callback_interface, wl_resource_get_version(resource), callback_id)))
       goto fail;
@@ -161,6 +179,8 @@ wl_cb_surface_frame(struct wl_client *wl_client, struct wl_resource *resource, u
    wlc_callback_implement(callback);
 
    struct wlc_surface *surface = wl_resource_get_user_data(resource);
+   callback->client = surface->client;
+   wlc_client_acquire(callback->client, WLC_CLIENT_CALLBACKS, 1);
    wl_list_insert(surface->pending.frame_cb_list.prev, &callback->link);
    wlc_dlog(WLC_DBG_RENDER, "-> Frame request");
    return;
@@ -174,7 +194,7 @@ fail:
 static void
 wl_cb_surface_set_opaque_region(struct wl_client *wl_client, struct wl_resource *resource, struct wl_resource *region_resource)
 {
-   (void)wl_client;
+   wlc_capture(wl_client, WLC_CAPTURE_SURFACE_OPAQUE_REGION, 2, wl_resource_get_id(resource), (region_resource ? wl_resource_get_id(region_resource) : 0));
    struct wlc_surface *surface = wl_resource_get_user_data(resource);
 
    if (region_resource) {
@@ -188,7 +208,7 @@ wl_cb_surface_set_opaque_region(struct wl_client *wl_client, struct wl_resource
 static void
 wl_cb_surface_set_input_region(struct wl_client *wl_client, struct wl_resource *resource, struct wl_resource *region_resource)
 {
-   (void)wl_client;
+   wlc_capture(wl_client, WLC_CAPTURE_SURFACE_INPUT_REGION, 2, wl_resource_get_id(resource), (region_resource ? wl_resource_get_id(region_resource) : 0));
    struct wlc_surface *surface = wl_resource_get_user_data(resource);
 
    if (region_resource) {
@@ -203,7 +223,7 @@ wl_cb_surface_set_input_region(struct wl_client *wl_client, struct wl_resource *
 static void
 wl_cb_surface_commit(struct wl_client *wl_client, struct wl_resource *resource)
 {
-   (void)wl_client;
+   wlc_capture(wl_client, WLC_CAPTURE_SURFACE_COMMIT, 1, wl_resource_get_id(resource));
    struct wlc_surface *surface = wl_resource_get_user_data(resource);
 
    commit_state(surface, &surface->pending, &surface->commit);
@@ -211,7 +231,7 @@ wl_cb_surface_commit(struct wl_client *wl_client, struct wl_resource *resource)
    if (surface->output)
       wlc_output_schedule_repaint(surface->output);
 
-   wlc_dlog(WLC_DBG_RENDER, "-> Commit request");
+   WLC_TRACE(WLC_TRACE_COMMIT, surface, 0);
 }
 
 static void
@@ -224,7 +244,7 @@ wl_cb_surface_set_buffer_transform(struct wl_client *wl_client, struct wl_resour
 static void
 wl_cb_surface_set_buffer_scale(struct wl_client *wl_client, struct wl_resource *resource, int32_t scale)
 {
-   (void)wl_client;
+   wlc_capture(wl_client, WLC_CAPTURE_SURFACE_BUFFER_SCALE, 2, wl_resource_get_id(resource), scale);
    struct wlc_surface *surface = wl_resource_get_user_data(resource);
 
    if (scale < 1) {
@@ -334,9 +354,29 @@ wlc_surface_free(struct wlc_surface *surface)
    release_state(&surface->commit);
    release_state(&surface->pending);
 
+   wlc_surface_set_storage(surface, 0, 0, 0);
+   wlc_client_release(surface->client, WLC_CLIENT_SURFACES, 1);
    free(surface);
 }
 
+void
+wlc_surface_set_storage(struct wlc_surface *surface, uint64_t shm_bytes, uint64_t gpu_bytes, uint32_t images)
+{
+   assert(surface);
+
+   wlc_client_release(surface->client, WLC_CLIENT_SHM_BYTES, surface->storage.shm_bytes);
+   wlc_client_release(surface->client, WLC_CLIENT_GPU_BYTES, surface->storage.gpu_bytes);
+   wlc_client_release(surface->client, WLC_CLIENT_IMAGES, surface->storage.images);
+
+   surface->storage.shm_bytes = shm_bytes;
+   surface->storage.gpu_bytes = gpu_bytes;
+   surface->storage.images = images;
+
+   wlc_client_acquire(surface->client, WLC_CLIENT_SHM_BYTES, shm_bytes);
+   wlc_client_acquire(surface->client, WLC_CLIENT_GPU_BYTES, gpu_bytes);
+   wlc_client_acquire(surface->client, WLC_CLIENT_IMAGES, images);
+}
+
 struct wlc_surface*
 wlc_surface_new(void)
 {
@@ -7,6 +7,7 @@
 #include "types/geometry.h"
 
 struct wl_resource;
+struct wlc_client;
 struct wlc_buffer;
 struct wlc_callback;
 struct wlc_surface_state;
@@ -27,6 +28,7 @@ struct wlc_surface_state {
 
 struct wlc_surface {
    struct wl_resource *resource;
+   struct wlc_client *client;
    struct wlc_surface_state pending;
    struct wlc_surface_state commit;
    struct wlc_size size;
@@ -52,17 +54,30 @@ struct wlc_surface {
     */
    void *images[3];
 
+   /**
+    * Storage of textures and images accounted to the client.
+    * Updated by the renderer with wlc_surface_set_storage.
+    */
+   struct {
+      uint64_t shm_bytes, gpu_bytes;
+      uint32_t images;
+   } storage;
+
    enum wlc_surface_format {
       SURFACE_RGB,
       SURFACE_RGBA,
    } format;
 
+   /* Unique for every commit that attached a buffer, 0 before the first one */
+   uint32_t commit_serial;
+
    bool opaque;
    bool synchronized;
 };
 
 void wlc_surface_attach_to_output(struct wlc_surface *surface, struct wlc_output *output, struct wlc_buffer *buffer);
 void wlc_surface_invalidate(struct wlc_surface *surface);
+void wlc_surface_set_storage(struct wlc_surface *surface, uint64_t shm_bytes, uint64_t gpu_bytes, uint32_t images);
 void wlc_surface_implement(struct wlc_surface *surface, struct wl_resource *resource);
 void wlc_surface_free(struct wlc_surface *surface);
 struct wlc_surface* wlc_surface_new(void);
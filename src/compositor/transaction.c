@@ -0,0 +1,181 @@
+#include "internal.h"
+#include "transaction.h"
+#include "visibility.h"
+#include "compositor.h"
+#include "output.h"
+#include "surface.h"
+#include "view.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <wayland-server.h>
+
+// Views changed between begin and commit are configured together on commit.
+// Outputs showing them skip repaints until every client committed a buffer
+// for its configure, or the timeout expires, so the new layout shows up in one frame.
+// Frame callbacks are still answered meanwhile, clients throttled on them must be able to draw.
+
+#define DEFAULT_TIMEOUT 200 // ms
+
+static void
+clear(struct wl_list *views)
+{
+   struct wlc_view *view, *vn;
+   wl_list_for_each_safe(view, vn, views, transaction_link) {
+      wl_list_remove(&view->transaction_link);
+      view->transaction = TRANSACTION_NONE;
+   }
+}
+
+static void
+finish(struct wlc_transaction *transaction)
+{
+   assert(transaction);
+   clear(&transaction->waiting);
+   wl_event_source_timer_update(transaction->timer, 0);
+
+   struct wlc_compositor *compositor = wl_container_of(transaction, compositor, transaction);
+   struct wlc_output *output;
+   wl_list_for_each(output, &compositor->outputs, link)
+      wlc_output_schedule_repaint(output);
+}
+
+static int
+cb_timeout(void *data)
+{
+   struct wlc_transaction *transaction = data;
+   wlc_dlog(WLC_DBG_RENDER, "-> Transaction timed out with %d views waiting", wl_list_length(&transaction->waiting));
+   finish(transaction);
+   return 1;
+}
+
+bool
+wlc_transaction_add(struct wlc_transaction *transaction, struct wlc_view *view)
+{
+   assert(transaction && view);
+
+   if (!transaction->depth)
+      return false;
+
+   if (view->transaction != TRANSACTION_NONE)
+      wl_list_remove(&view->transaction_link);
+
+   wl_list_insert(transaction->views.prev, &view->transaction_link);
+   view->transaction = TRANSACTION_COLLECTED;
+   return true;
+}
+
+void
+wlc_transaction_ack(struct wlc_transaction *transaction, struct wlc_view *view)
+{
+   assert(transaction && view);
+
+   if (view->transaction != TRANSACTION_WAITING)
+      return;
+
+   wl_list_remove(&view->transaction_link);
+   view->transaction = TRANSACTION_NONE;
+
+   if (wl_list_empty(&transaction->waiting))
+      finish(transaction);
+}
+
+void
+wlc_transaction_remove(struct wlc_transaction *transaction, struct wlc_view *view)
+{
+   assert(transaction && view);
+
+   if (view->transaction == TRANSACTION_COLLECTED) {
+      wl_list_remove(&view->transaction_link);
+      view->transaction = TRANSACTION_NONE;
+   } else {
+      // Destroyed views can't answer their configure
+      wlc_transaction_ack(transaction, view);
+   }
+}
+
+bool
+wlc_transaction_holds(struct wlc_transaction *transaction, struct wlc_output *output)
+{
+   assert(transaction && output);
+
+   // Pending state of collected views is applied on repaint
+   if (transaction->depth > 0 && !wl_list_empty(&transaction->views))
+      return true;
+
+   struct wlc_view *view;
+   wl_list_for_each(view, &transaction->waiting, transaction_link) {
+      if (view->space && view->space->output == output)
+         return true;
+   }
+
+   return false;
+}
+
+void
+wlc_transaction_release(struct wlc_transaction *transaction)
+{
+   assert(transaction);
+
+   clear(&transaction->views);
+   clear(&transaction->waiting);
+
+   if (transaction->timer)
+      wl_event_source_remove(transaction->timer);
+
+   memset(transaction, 0, sizeof(struct wlc_transaction));
+}
+
+bool
+wlc_transaction_init(struct wlc_transaction *transaction)
+{
+   assert(transaction);
+   memset(transaction, 0, sizeof(struct wlc_transaction));
+   wl_list_init(&transaction->views);
+   wl_list_init(&transaction->waiting);
+   return (transaction->timer = wl_event_loop_add_timer(wlc_event_loop(), cb_timeout, transaction));
+}
+
+WLC_API void
+wlc_compositor_begin_transaction(struct wlc_compositor *compositor)
+{
+   assert(compositor);
+   compositor->transaction.depth++;
+}
+
+WLC_API void
+wlc_compositor_commit_transaction(struct wlc_compositor *compositor, uint32_t timeout_ms)
+{
+   assert(compositor);
+   struct wlc_transaction *transaction = &compositor->transaction;
+
+   if (!transaction->depth || --transaction->depth > 0)
+      return;
+
+   // Configure everything first so clients resize in parallel
+   struct wlc_view *view, *vn;
+   wl_list_for_each_safe(view, vn, &transaction->views, transaction_link) {
+      wl_list_remove(&view->transaction_link);
+      view->transaction = TRANSACTION_NONE;
+
+      if (!view->created || !view->space || !view->surface->commit.attached)
+         continue;
+
+      wlc_view_commit_state(view, &view->pending, &view->commit);
+
+      if (view->ack != ACK_NONE) {
+         wl_list_insert(transaction->waiting.prev, &view->transaction_link);
+         view->transaction = TRANSACTION_WAITING;
+      }
+   }
+
+   if (wl_list_empty(&transaction->waiting)) {
+      finish(transaction);
+      return;
+   }
+
+   wlc_dlog(WLC_DBG_RENDER, "-> Transaction waiting for %d views", wl_list_length(&transaction->waiting));
+   wl_event_source_timer_update(transaction->timer, (timeout_ms > 0 ? timeout_ms : DEFAULT_TIMEOUT));
+}
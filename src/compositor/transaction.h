@@ -0,0 +1,32 @@
+#ifndef _WLC_TRANSACTION_H_
+#define _WLC_TRANSACTION_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <wayland-util.h>
+
+struct wl_event_source;
+struct wlc_output;
+struct wlc_view;
+
+enum wlc_view_transaction {
+   TRANSACTION_NONE,
+   TRANSACTION_COLLECTED, // changed between begin and commit
+   TRANSACTION_WAITING, // configured, waiting for the client to commit
+};
+
+// Layout changes of many views presented in a single frame.
+struct wlc_transaction {
+   struct wl_list views, waiting;
+   struct wl_event_source *timer;
+   uint32_t depth;
+};
+
+bool wlc_transaction_add(struct wlc_transaction *transaction, struct wlc_view *view);
+void wlc_transaction_ack(struct wlc_transaction *transaction, struct wlc_view *view);
+void wlc_transaction_remove(struct wlc_transaction *transaction, struct wlc_view *view);
+bool wlc_transaction_holds(struct wlc_transaction *transaction, struct wlc_output *output);
+void wlc_transaction_release(struct wlc_transaction *transaction);
+bool wlc_transaction_init(struct wlc_transaction *transaction);
+
+#endif /* _WLC_TRANSACTION_H_ */
@@ -34,6 +34,48 @@ update(struct wlc_view *view)
    wlc_output_schedule_repaint(view->space->output);
 }
 
+static void
+ack_done(struct wlc_view *view)
+{
+   memcpy(&view->commit, &view->pending, sizeof(view->commit));
+   view->ack = ACK_NONE;
+   wlc_view_invalidate_bounds(view);
+   wlc_transaction_ack(&view->compositor->transaction, view);
+
+   if (view->ack_timer)
+      wl_event_source_timer_update(view->ack_timer, 0);
+}
+
+static int
+cb_ack_timer(void *data)
+{
+   struct wlc_view *view = data;
+
+   if (view->ack == ACK_NONE)
+      return 1;
+
+   // Stop waiting, the old buffer is shown in the new geometry until the client catches up
+   wlc_log(WLC_LOG_INFO, "View (%p) did not commit its configure in %u ms, client may be frozen", view, view->compositor->options.frozen_time);
+   ack_done(view);
+
+   if (view->space)
+      wlc_output_schedule_repaint(view->space->output);
+
+   return 1;
+}
+
+static void
+wait_ack(struct wlc_view *view)
+{
+   view->ack = ACK_NEXT_COMMIT;
+
+   const uint32_t ms = view->compositor->options.frozen_time;
+   if (!ms || (!view->ack_timer && !(view->ack_timer = wl_event_loop_add_timer(wlc_event_loop(), cb_ack_timer, view))))
+      return;
+
+   wl_event_source_timer_update(view->ack_timer, ms);
+}
+
 void
 wlc_view_commit_state(struct wlc_view *view, struct wlc_view_state *pending, struct wlc_view_state *out)
 {
@@ -69,12 +111,15 @@ wlc_view_commit_state(struct wlc_view *view, struct wlc_view_state *pending, str
       if (view->xdg_surface.resource) {
          uint32_t serial = wl_display_next_serial(wlc_display());
          xdg_surface_send_configure(view->xdg_surface.resource, pending->geometry.size.w, pending->geometry.size.h, &view->wl_state, serial);
+         view->configure.serial = serial;
          // XXX: Some clients such simple-damage from weston does not trigger the ack, force next commit.
          //      Otherwise we could go pending state here and wait for surface reply.
-         view->ack = (size_changed ? ACK_NEXT_COMMIT : ACK_NONE);
+         if (size_changed)
+            wait_ack(view);
       } else if (view->shell_surface.resource) {
          wl_shell_surface_send_configure(view->shell_surface.resource, view->resizing, pending->geometry.size.w, pending->geometry.size.h);
-         view->ack = (size_changed ? ACK_NEXT_COMMIT : ACK_NONE);
+         if (size_changed)
+            wait_ack(view);
       }
    }
 
@@ -84,14 +129,14 @@ wlc_view_commit_state(struct wlc_view *view, struct wlc_view_state *pending, str
 
       if (size_changed) {
          wlc_x11_window_resize(view->x11_window, pending->geometry.size.w, pending->geometry.size.h);
-         view->ack = ACK_NEXT_COMMIT;
+         wait_ack(view);
       }
    }
 
-   if (view->ack == ACK_NONE) {
+   if (view->ack == ACK_NONE && memcmp(out, pending, sizeof(struct wlc_view_state))) {
       // Commit immediately if no ack requested
-      // XXX: We may need to detect frozen client
       memcpy(out, pending, sizeof(struct wlc_view_state));
+      wlc_view_invalidate_bounds(view);
    }
 }
 
@@ -100,6 +145,9 @@ wlc_view_ack_surface_attach(struct wlc_view *view, struct wlc_size *old_surface_
 {
    assert(view && old_surface_size);
 
+   if (!wlc_size_equals(&view->surface->size, old_surface_size))
+      wlc_view_invalidate_bounds(view);
+
    if (!view->resizing && !wlc_size_equals(&view->surface->size, old_surface_size) && !wlc_size_equals(&view->pending.geometry.size, &view->surface->size)) {
       struct wlc_geometry r = { view->pending.geometry.origin, view->surface->size };
       wlc_view_request_geometry(view, &r);
@@ -111,6 +159,11 @@ wlc_view_ack_surface_attach(struct wlc_view *view, struct wlc_size *old_surface_
    if (view->ack != ACK_NEXT_COMMIT)
       return;
 
+   // Clients that ack configures commit frames of the old size until they ack the last one.
+   // Those must not complete the configure, or a new one is sent for every stale frame.
+   if (view->xdg_surface.resource && view->configure.acked && view->configure.acked != view->configure.serial)
+      return;
+
    bool reconfigure = false;
 
    if (view->resizing) {
@@ -132,24 +185,23 @@ wlc_view_ack_surface_attach(struct wlc_view *view, struct wlc_size *old_surface_
       if (view->xdg_surface.resource) {
          uint32_t serial = wl_display_next_serial(wlc_display());
          xdg_surface_send_configure(view->xdg_surface.resource, view->pending.geometry.size.w, view->pending.geometry.size.h, &view->wl_state, serial);
-         view->ack = ACK_NEXT_COMMIT;
+         view->configure.serial = serial;
+         wait_ack(view);
       } else if (view->shell_surface.resource) {
          wl_shell_surface_send_configure(view->shell_surface.resource, view->resizing, view->pending.geometry.size.w, view->pending.geometry.size.h);
-         view->ack = ACK_NEXT_COMMIT;
+         wait_ack(view);
       } else if (view->x11_window) {
          wlc_x11_window_resize(view->x11_window, view->pending.geometry.size.w, view->pending.geometry.size.h);
-         view->ack = ACK_NEXT_COMMIT;
+         wait_ack(view);
       }
    } else {
-      memcpy(&view->commit, &view->pending, sizeof(view->commit));
-      view->ack = ACK_NONE;
+      ack_done(view);
    }
 }
 
-void
-wlc_view_get_bounds(struct wlc_view *view, struct wlc_geometry *out_bounds, struct wlc_geometry *out_visible)
+static void
+compute_bounds(struct wlc_view *view, struct wlc_geometry *out_bounds, struct wlc_geometry *out_visible)
 {
-   assert(view && out_bounds);
    memcpy(out_bounds, &view->commit.geometry, sizeof(struct wlc_geometry));
 
    for (struct wlc_view *parent = view->parent; !(view->type & WLC_BIT_OVERRIDE_REDIRECT) && parent; parent = parent->parent) {
@@ -174,9 +226,6 @@ wlc_view_get_bounds(struct wlc_view *view, struct wlc_geometry *out_bounds, stru
    out_bounds->size.w = fmax(out_bounds->size.w, 1);
    out_bounds->size.h = fmax(out_bounds->size.h, 1);
 
-   if (!out_visible)
-      return;
-
    // Actual visible area of the view
    // The idea is to draw black borders to the bounds area, while centering the visible area.
    if ((view->x11_window || view->shell_surface.resource) && !wlc_size_equals(&view->surface->size, &out_bounds->size)) {
@@ -206,6 +255,56 @@ wlc_view_get_bounds(struct wlc_view *view, struct wlc_geometry *out_bounds, stru
    }
 }
 
+void
+wlc_view_get_bounds(struct wlc_view *view, struct wlc_geometry *out_bounds, struct wlc_geometry *out_visible)
+{
+   assert(view && out_bounds);
+
+   if (!view->bounds.valid) {
+      compute_bounds(view, &view->bounds.bounds, &view->bounds.visible);
+      view->bounds.valid = true;
+   }
+
+   memcpy(out_bounds, &view->bounds.bounds, sizeof(struct wlc_geometry));
+
+   if (out_visible)
+      memcpy(out_visible, &view->bounds.visible, sizeof(struct wlc_geometry));
+}
+
+bool
+wlc_view_get_stretch(struct wlc_view *view, struct wlc_geometry *out_geometry)
+{
+   assert(view);
+
+   // Waiting for a buffer of the new size, old one is scaled into the pending geometry meanwhile
+   if (!view->compositor->options.stretch_resize || view->ack != ACK_NEXT_COMMIT || wlc_size_equals(&view->pending.geometry.size, &view->surface->size))
+      return false;
+
+   if (out_geometry) {
+      struct wlc_geometry b;
+      wlc_view_get_bounds(view, &b, NULL);
+      out_geometry->origin.x = b.origin.x + view->pending.geometry.origin.x - view->commit.geometry.origin.x;
+      out_geometry->origin.y = b.origin.y + view->pending.geometry.origin.y - view->commit.geometry.origin.y;
+      out_geometry->size.w = fmax(view->pending.geometry.size.w, 1);
+      out_geometry->size.h = fmax(view->pending.geometry.size.h, 1);
+   }
+
+   return true;
+}
+
+void
+wlc_view_invalidate_bounds(struct wlc_view *view)
+{
+   assert(view);
+   view->bounds.valid = false;
+   wlc_space_index_dirty(view);
+
+   // Children are positioned relative to their parent
+   struct wlc_view *child;
+   wl_list_for_each(child, &view->childs, parent_link)
+      wlc_view_invalidate_bounds(child);
+}
+
 bool
 wlc_view_request_geometry(struct wlc_view *view, const struct wlc_geometry *r)
 {
@@ -274,8 +373,16 @@ wlc_view_free(struct wlc_view *view)
    if (view->surface)
       view->surface->view = NULL;
 
-   if (view->space)
+   wlc_space_index_remove(view);
+   wlc_transaction_remove(&view->compositor->transaction, view);
+
+   if (view->space) {
+      wlc_space_index_restack(view->space);
       wl_list_remove(&view->link);
+   }
+
+   if (view->ack_timer)
+      wl_event_source_remove(view->ack_timer);
 
    wl_array_release(&view->wl_state);
    free(view);
@@ -323,7 +430,16 @@ wlc_view_set_state(struct wlc_view *view, enum wlc_view_state_bit state, bool to
 #define BIT_TOGGLE(w, m, f) (w & ~m) | (-f & m)
    view->pending.state = BIT_TOGGLE(view->pending.state, state, toggle);
 #undef BIT_TOGGLE
-   update(view);
+
+   if (!wlc_transaction_add(&view->compositor->transaction, view))
+      update(view);
+}
+
+WLC_API bool
+wlc_view_get_scanout(struct wlc_view *view)
+{
+   assert(view);
+   return view->scanout;
 }
 
 WLC_API const struct wlc_geometry*
@@ -338,7 +454,9 @@ wlc_view_set_geometry(struct wlc_view *view, const struct wlc_geometry *geometry
 {
    assert(view && geometry);
    view->pending.geometry = *geometry;
-   update(view);
+
+   if (!wlc_transaction_add(&view->compositor->transaction, view))
+      update(view);
 }
 
 WLC_API void
@@ -354,7 +472,9 @@ wlc_view_close(struct wlc_view *view)
       wlc_x11_window_close(view->x11_window);
    } else if (view->shell_surface.resource) {
       wlc_shell_surface_release(&view->shell_surface);
-      wlc_client_free(view->client);
+
+      if (view->client && view->client->wl_client)
+         wl_client_destroy(view->client->wl_client);
    }
 }
 
@@ -398,6 +518,7 @@ wlc_view_send_below(struct wlc_view *view, struct wlc_view *below)
 
    wl_list_remove(&view->link);
    wl_list_insert(&below->link, &view->link);
+   wlc_space_index_restack(view->space);
    update(view);
 }
 
@@ -412,6 +533,7 @@ wlc_view_send_to_back(struct wlc_view *view)
 
    wl_list_remove(&view->link);
    wl_list_insert(views->prev, &view->link);
+   wlc_space_index_restack(view->space);
    update(view);
 }
 
@@ -425,6 +547,7 @@ wlc_view_bring_above(struct wlc_view *view, struct wlc_view *above)
 
    wl_list_remove(&view->link);
    wl_list_insert(above->link.prev, &view->link);
+   wlc_space_index_restack(view->space);
    update(view);
 }
 
@@ -439,6 +562,7 @@ wlc_view_bring_to_front(struct wlc_view *view)
 
    wl_list_remove(&view->link);
    wl_list_insert(views->prev, &view->link);
+   wlc_space_index_restack(view->space);
    update(view);
 }
 
@@ -450,8 +574,11 @@ wlc_view_set_space(struct wlc_view *view, struct wlc_space *space)
    if (view->space == space)
       return;
 
-   if (view->space)
+   if (view->space) {
+      wlc_space_index_remove(view);
+      wlc_space_index_restack(view->space);
       wl_list_remove(&view->link);
+   }
 
    if (space)
       wl_list_insert(space->views.prev, &view->link);
@@ -461,6 +588,8 @@ wlc_view_set_space(struct wlc_view *view, struct wlc_space *space)
 
    struct wlc_space *old_space = view->space;
    view->space = space;
+   wlc_space_index_restack(space);
+   wlc_view_invalidate_bounds(view);
 
    if (space && !view->created) {
       if (!wlc_size_equals(&view->pending.geometry.size, &wlc_size_zero))
@@ -543,6 +672,7 @@ wlc_view_set_parent(struct wlc_view *view, struct wlc_view *parent)
    if ((view->parent = parent))
       wl_list_insert(&parent->childs, &view->parent_link);
 
+   wlc_view_invalidate_bounds(view);
    update(view);
 }
 
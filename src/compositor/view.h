@@ -9,8 +9,11 @@
 #include "shell/xdg-surface.h"
 #include "shell/xdg-popup.h"
 #include "types/geometry.h"
+#include "space-index.h"
+#include "transaction.h"
 
 struct wl_resource;
+struct wl_event_source;
 struct wlc_client;
 struct wlc_surface;
 struct wlc_x11_window;
@@ -39,14 +42,33 @@ struct wlc_view {
    struct wlc_xdg_surface xdg_surface;
    struct wlc_xdg_popup xdg_popup;
    struct wl_list childs;
-   struct wl_list link, user_link, parent_link;
+   struct wl_list link, user_link, parent_link, transaction_link;
    struct wlc_view_state pending;
    struct wlc_view_state commit;
    struct wl_array wl_state;
    uint32_t type;
    uint32_t resizing;
    enum wlc_view_ack ack;
+   struct wl_event_source *ack_timer; // frozen client detection
+
+   // Serials of the last xdg configure sent and acked by the client.
+   struct {
+      uint32_t serial, acked;
+   } configure;
+
+   enum wlc_view_transaction transaction;
    bool created;
+
+   // Scanned out directly from overlay plane instead of composited.
+   bool scanout;
+
+   // Result of wlc_view_get_bounds, see wlc_view_invalidate_bounds.
+   struct {
+      struct wlc_geometry bounds, visible;
+      bool valid;
+   } bounds;
+
+   struct wlc_space_index_entry index;
 };
 
 bool wlc_view_request_geometry(struct wlc_view *view, const struct wlc_geometry *r);
@@ -54,6 +76,8 @@ void wlc_view_request_state(struct wlc_view *view, enum wlc_view_state_bit state
 void wlc_view_commit_state(struct wlc_view *view, struct wlc_view_state *pending, struct wlc_view_state *out);
 void wlc_view_ack_surface_attach(struct wlc_view *view, struct wlc_size *old_surface_size);
 void wlc_view_get_bounds(struct wlc_view *view, struct wlc_geometry *out_bounds, struct wlc_geometry *out_visible);
+void wlc_view_invalidate_bounds(struct wlc_view *view);
+bool wlc_view_get_stretch(struct wlc_view *view, struct wlc_geometry *out_geometry);
 struct wlc_space* wlc_view_get_mapped_space(struct wlc_view *view);
 void wlc_view_defocus(struct wlc_view *view);
 void wlc_view_free(struct wlc_view *view);
@@ -70,6 +70,7 @@ struct wlc_input_event {
    };
 
    uint32_t time;
+   uint64_t arrival; // CLOCK_MONOTONIC, ns, 0 if unknown
    enum wlc_input_event_type type;
 };
 
@@ -133,6 +134,9 @@ die(const char *format, ...)
 WLC_LOG_ATTR(2, 3) void wlc_dlog(enum wlc_debug dbg, const char *fmt, ...);
 
 uint32_t wlc_get_time(struct timespec *out_ts);
+uint64_t wlc_get_time_ns(void);
+void wlc_startup_phase(enum wlc_startup_phase phase, uint64_t begin);
+void wlc_startup_finish(void);
 void wlc_set_active(bool active);
 bool wlc_get_active(void);
 const struct wlc_interface* wlc_interface(void);
@@ -0,0 +1,384 @@
+#include "internal.h"
+#include "visibility.h"
+#include "log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+// Lines are formatted by the caller into a bounded MPMC ring and written in batches
+// by a background thread. When the ring is full lines are dropped and counted.
+// Before wlc_log_init, in forked children and after wlc_log_sync lines are written directly.
+
+#define RING_SIZE 1024 // lines, power of two
+#define LINE_SIZE 480
+
+struct line {
+   uint64_t seq;
+   uint64_t time; // CLOCK_REALTIME, ns
+   enum wlc_log_type type;
+   bool libwayland;
+   char text[LINE_SIZE];
+};
+
+static struct {
+   struct line ring[RING_SIZE];
+   uint64_t head, tail;
+   uint64_t dropped;
+   pthread_mutex_t write_lock;
+   pthread_t thread;
+   FILE *file;
+   int wake_fd;
+   bool sleeping, running, async;
+} logger = {
+   .write_lock = PTHREAD_MUTEX_INITIALIZER,
+   .wake_fd = -1,
+};
+
+static size_t
+format_timestamp(char *buf, size_t size, uint64_t time)
+{
+   // Most lines land within the same second, only the milliseconds change
+   static __thread struct {
+      time_t sec;
+      char hms[16];
+   } cache;
+   static int mday;
+
+   size_t n = 0;
+   const time_t sec = time / 1000000000;
+   if (sec != cache.sec) {
+      struct tm tm;
+      if (!localtime_r(&sec, &tm))
+         return snprintf(buf, size, "[(NULL)localtime] ");
+
+      if (__atomic_exchange_n(&mday, tm.tm_mday, __ATOMIC_RELAXED) != tm.tm_mday) {
+         char date[64];
+         strftime(date, sizeof(date), "%Y-%m-%d %Z", &tm);
+         n = snprintf(buf, size, "Date: %s\n", date);
+      }
+
+      strftime(cache.hms, sizeof(cache.hms), "%H:%M:%S", &tm);
+      cache.sec = sec;
+   }
+
+   return n + snprintf(buf + n, size - n, "[%s.%03u] ", cache.hms, (uint32_t)(time / 1000000 % 1000));
+}
+
+static void
+format_text(char *text, bool libwayland, const char *fmt, va_list args)
+{
+   const int n = vsnprintf(text, LINE_SIZE, fmt, args);
+
+   if (n < 0) {
+      *text = 0;
+   } else if (n >= LINE_SIZE) {
+      // libwayland lines bring their own newline, keep it when truncating
+      const char *tail = (libwayland ? "...\n" : "...");
+      const size_t len = strlen(tail) + 1;
+      memcpy(text + LINE_SIZE - len, tail, len);
+   }
+}
+
+static void
+write_line(FILE *out, const struct line *line)
+{
+   static const char *types[] = {
+      [WLC_LOG_INFO] = "",
+      [WLC_LOG_WARN] = "(WARN) ",
+      [WLC_LOG_ERROR] = "(ERROR) ",
+   };
+
+   // Build the whole line, so lines written from different threads never interleave
+   char buf[LINE_SIZE + 128];
+   size_t n = 0;
+   if (out != stderr && out != stdout) {
+      n = format_timestamp(buf, sizeof(buf), line->time);
+   } else if (!line->libwayland) {
+      n = snprintf(buf, sizeof(buf), "wlc: ");
+   }
+
+   n = (n < sizeof(buf) ? n : sizeof(buf) - 1);
+   if (line->libwayland) {
+      snprintf(buf + n, sizeof(buf) - n, "libwayland: %s", line->text);
+   } else {
+      snprintf(buf + n, sizeof(buf) - n, "%s%s\n", types[line->type], line->text);
+   }
+
+   fputs(buf, out);
+}
+
+static struct line*
+ring_claim(uint64_t *out_pos)
+{
+   uint64_t pos = __atomic_load_n(&logger.head, __ATOMIC_RELAXED);
+   for (;;) {
+      struct line *line = &logger.ring[pos & (RING_SIZE - 1)];
+      const int64_t diff = (int64_t)__atomic_load_n(&line->seq, __ATOMIC_ACQUIRE) - (int64_t)pos;
+
+      if (diff < 0)
+         return NULL;
+
+      if (diff == 0 && __atomic_compare_exchange_n(&logger.head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+         *out_pos = pos;
+         return line;
+      }
+
+      if (diff > 0)
+         pos = __atomic_load_n(&logger.head, __ATOMIC_RELAXED);
+   }
+}
+
+static bool
+ring_take(struct line *out_line)
+{
+   uint64_t pos = __atomic_load_n(&logger.tail, __ATOMIC_RELAXED);
+   for (;;) {
+      struct line *line = &logger.ring[pos & (RING_SIZE - 1)];
+      const int64_t diff = (int64_t)__atomic_load_n(&line->seq, __ATOMIC_ACQUIRE) - (int64_t)(pos + 1);
+
+      if (diff < 0)
+         return false;
+
+      if (diff == 0 && __atomic_compare_exchange_n(&logger.tail, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+         memcpy(out_line, line, sizeof(struct line));
+         __atomic_store_n(&line->seq, pos + RING_SIZE, __ATOMIC_RELEASE);
+         return true;
+      }
+
+      if (diff > 0)
+         pos = __atomic_load_n(&logger.tail, __ATOMIC_RELAXED);
+   }
+}
+
+static bool
+ring_pending(void)
+{
+   const uint64_t pos = __atomic_load_n(&logger.tail, __ATOMIC_RELAXED);
+   return (__atomic_load_n(&logger.ring[pos & (RING_SIZE - 1)].seq, __ATOMIC_ACQUIRE) == pos + 1 ||
+           __atomic_load_n(&logger.dropped, __ATOMIC_RELAXED) > 0);
+}
+
+static void
+drain(FILE *out)
+{
+   struct line line;
+   while (ring_take(&line))
+      write_line(out, &line);
+
+   uint64_t dropped;
+   if ((dropped = __atomic_exchange_n(&logger.dropped, 0, __ATOMIC_RELAXED)) > 0) {
+      struct timespec ts;
+      clock_gettime(CLOCK_REALTIME, &ts);
+      line.time = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+      line.type = WLC_LOG_WARN;
+      line.libwayland = false;
+      snprintf(line.text, sizeof(line.text), "Dropped %llu log lines", (unsigned long long)dropped);
+      write_line(out, &line);
+   }
+
+   fflush(out);
+}
+
+static void*
+writer(void *data)
+{
+   (void)data;
+
+   while (__atomic_load_n(&logger.running, __ATOMIC_ACQUIRE)) {
+      pthread_mutex_lock(&logger.write_lock);
+      drain(wlc_get_log_file());
+      pthread_mutex_unlock(&logger.write_lock);
+
+      __atomic_store_n(&logger.sleeping, true, __ATOMIC_SEQ_CST);
+
+      uint64_t count;
+      if (!ring_pending() && __atomic_load_n(&logger.running, __ATOMIC_ACQUIRE) && read(logger.wake_fd, &count, sizeof(count)) < 0)
+         break;
+
+      __atomic_store_n(&logger.sleeping, false, __ATOMIC_RELAXED);
+   }
+
+   return NULL;
+}
+
+static bool
+wake(void)
+{
+   // Only costs a syscall when the writer is about to sleep
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+   if (!__atomic_exchange_n(&logger.sleeping, false, __ATOMIC_SEQ_CST))
+      return true;
+
+   const uint64_t count = 1;
+   return (write(logger.wake_fd, &count, sizeof(count)) == sizeof(count));
+}
+
+static void
+log_line(enum wlc_log_type type, bool libwayland, const char *fmt, va_list args)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_REALTIME, &ts);
+   const uint64_t time = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+   if (!__atomic_load_n(&logger.async, __ATOMIC_ACQUIRE)) {
+      struct line line = { .time = time, .type = type, .libwayland = libwayland };
+      format_text(line.text, libwayland, fmt, args);
+      FILE *out = wlc_get_log_file();
+      write_line(out, &line);
+      fflush(out);
+      return;
+   }
+
+   uint64_t pos;
+   struct line *line;
+   if (!(line = ring_claim(&pos))) {
+      __atomic_add_fetch(&logger.dropped, 1, __ATOMIC_RELAXED);
+      return;
+   }
+
+   line->time = time;
+   line->type = type;
+   line->libwayland = libwayland;
+   format_text(line->text, libwayland, fmt, args);
+   __atomic_store_n(&line->seq, pos + 1, __ATOMIC_RELEASE);
+   wake();
+}
+
+static void
+atfork_child(void)
+{
+   // The writer thread does not exist in the child
+   logger.async = logger.running = false;
+}
+
+// Sync waits this long for the writer to finish its batch.
+// The ring takes multiple consumers, so a stuck writer only risks interleaved lines.
+#define SYNC_LOCK_TIMEOUT_MS 100
+
+void
+wlc_log_sync(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_REALTIME, &ts);
+   ts.tv_nsec += SYNC_LOCK_TIMEOUT_MS * 1000000L;
+   ts.tv_sec += ts.tv_nsec / 1000000000L;
+   ts.tv_nsec %= 1000000000L;
+
+   const bool locked = (pthread_mutex_timedlock(&logger.write_lock, &ts) == 0);
+
+   // Writer batch is out, what is left is written here and everything after directly
+   __atomic_store_n(&logger.async, false, __ATOMIC_SEQ_CST);
+   drain(wlc_get_log_file());
+
+   if (locked)
+      pthread_mutex_unlock(&logger.write_lock);
+}
+
+void
+wlc_log_wayland(const char *fmt, va_list args)
+{
+   log_line(WLC_LOG_INFO, true, fmt, args);
+}
+
+WLC_API void
+wlc_vlog(const enum wlc_log_type type, const char *fmt, va_list args)
+{
+   log_line(type, false, fmt, args);
+}
+
+WLC_API void
+wlc_log(const enum wlc_log_type type, const char *fmt, ...)
+{
+   va_list argp;
+   va_start(argp, fmt);
+   wlc_vlog(type, fmt, argp);
+   va_end(argp);
+}
+
+WLC_API FILE*
+wlc_get_log_file(void)
+{
+   return (logger.file ? logger.file : stderr);
+}
+
+WLC_API void
+wlc_set_log_file(FILE *out)
+{
+   pthread_mutex_lock(&logger.write_lock);
+
+   if (logger.file && logger.file != stdout && logger.file != stderr)
+      fclose(logger.file);
+
+   logger.file = out;
+   pthread_mutex_unlock(&logger.write_lock);
+}
+
+void
+wlc_log_terminate(void)
+{
+   if (!logger.running)
+      return;
+
+   __atomic_store_n(&logger.async, false, __ATOMIC_SEQ_CST);
+   __atomic_store_n(&logger.running, false, __ATOMIC_RELEASE);
+
+   const uint64_t count = 1;
+   if (write(logger.wake_fd, &count, sizeof(count)) == sizeof(count))
+      pthread_join(logger.thread, NULL);
+
+   close(logger.wake_fd);
+   logger.wake_fd = -1;
+   drain(wlc_get_log_file());
+}
+
+void
+wlc_log_init(void)
+{
+   static bool registered;
+
+   if (logger.running)
+      return;
+
+   for (uint32_t i = 0; i < RING_SIZE; ++i)
+      logger.ring[i].seq = i;
+
+   logger.head = logger.tail = logger.dropped = 0;
+
+   if ((logger.wake_fd = eventfd(0, EFD_CLOEXEC)) < 0)
+      goto fail;
+
+   // Signals are handled by the compositor thread
+   sigset_t all, old;
+   sigfillset(&all);
+   pthread_sigmask(SIG_SETMASK, &all, &old);
+
+   logger.running = true;
+   const int ret = pthread_create(&logger.thread, NULL, writer, NULL);
+   pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+   if (ret != 0)
+      goto thread_fail;
+
+   if (!registered) {
+      pthread_atfork(NULL, NULL, atfork_child);
+      atexit(wlc_log_sync);
+      registered = true;
+   }
+
+   __atomic_store_n(&logger.async, true, __ATOMIC_RELEASE);
+   return;
+
+thread_fail:
+   logger.running = false;
+   close(logger.wake_fd);
+   logger.wake_fd = -1;
+fail:
+   wlc_log(WLC_LOG_WARN, "Failed to start log thread, logging synchronously");
+}
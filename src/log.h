@@ -0,0 +1,15 @@
+#ifndef _WLC_LOG_H_
+#define _WLC_LOG_H_
+
+#include <stdarg.h>
+
+void wlc_log_init(void);
+void wlc_log_terminate(void);
+
+// Flush queued lines and log synchronously from now on, safe to call from crash handlers.
+void wlc_log_sync(void);
+
+// libwayland log handler
+void wlc_log_wayland(const char *fmt, va_list args);
+
+#endif /* _WLC_LOG_H_ */
@@ -2,8 +2,10 @@
 #include "backend.h"
 #include "x11.h"
 #include "drm.h"
+#include "headless.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 struct wlc_backend_surface*
@@ -68,6 +70,13 @@ wlc_backend_init(struct wlc_compositor *compositor)
       NULL
    };
 
+   // Virtual outputs only, for testing and benchmarking without display hardware
+   const char *env;
+   if ((env = getenv("WLC_HEADLESS")) && !strcmp(env, "1")) {
+      init[0] = wlc_headless_init;
+      init[1] = NULL;
+   }
+
    for (int i = 0; init[i]; ++i)
       if (init[i](backend, compositor))
          return backend;
@@ -3,9 +3,14 @@
 
 #include "EGL/egl.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 struct wlc_compositor;
 struct wlc_output;
+struct wlc_size;
+struct wlc_origin;
+struct wlc_geometry;
+struct wlc_buffer;
 
 struct wlc_backend_surface {
    void *internal;
@@ -14,10 +19,28 @@ struct wlc_backend_surface {
    EGLNativeWindowType window;
    size_t internal_size;
 
+   // Offscreen surface size, used when there is no native window.
+   struct {
+      EGLint width, height;
+   } pbuffer;
+
    struct {
       void (*terminate)(struct wlc_backend_surface *surface);
       void (*sleep)(struct wlc_backend_surface *surface, bool sleep);
       bool (*page_flip)(struct wlc_backend_surface *surface);
+
+      // Optional, session was switched away or back. Surface keeps its resources,
+      // without this the surface is destroyed and recreated instead.
+      void (*suspend)(struct wlc_backend_surface *surface, bool suspend);
+
+      // Optional hardware cursor, pixels are tightly packed ARGB8888.
+      // NULL pixels hides the cursor, returns false if image can't be shown.
+      bool (*set_cursor)(struct wlc_backend_surface *surface, const uint32_t *pixels, const struct wlc_size *size, const struct wlc_origin *hotspot);
+      void (*move_cursor)(struct wlc_backend_surface *surface, const struct wlc_origin *pos);
+
+      // Optional overlay planes, returns true if buffer is scanned out at geometry on next page flip.
+      // NULL buffer clears previous assignments, called before each frame.
+      bool (*assign_plane)(struct wlc_backend_surface *surface, struct wlc_buffer *buffer, const struct wlc_geometry *geometry);
    } api;
 };
 
@@ -4,6 +4,7 @@
 
 #include "compositor/compositor.h"
 #include "compositor/output.h"
+#include "compositor/buffer.h"
 
 #include "session/fd.h"
 
@@ -24,7 +25,13 @@
 
 // FIXME: contains global state (event_source && fd)
 
+// Default and maximum swapchain depth.
+// Override default with WLC_DRM_BUFFERS env variable (2 or 3).
 #define NUM_FBS 2
+#define MAX_FBS 3
+
+// Maximum overlay planes used per output.
+#define MAX_OVERLAYS 4
 
 struct drm_output_information {
    drmModeConnector *connector;
@@ -32,6 +39,55 @@ struct drm_output_information {
    drmModeCrtc *crtc;
    struct wlc_output_information info;
    uint32_t width, height;
+   uint32_t crtc_index;
+};
+
+// Property ids used when committing atomically.
+struct drm_plane_props {
+   uint32_t fb_id, crtc_id;
+   uint32_t src_x, src_y, src_w, src_h;
+   uint32_t crtc_x, crtc_y, crtc_w, crtc_h;
+};
+
+struct drm_props {
+   struct {
+      uint32_t mode_id, active;
+   } crtc;
+
+   struct {
+      uint32_t crtc_id;
+   } connector;
+
+   struct drm_plane_props plane;
+};
+
+// Client wl_buffer imported for scanout, kept until the wl_buffer is destroyed.
+// The wl_buffer holds one reference and every overlay fb showing it another.
+// bo is NULL when the buffer can't be scanned out, so we don't retry each frame.
+struct drm_import {
+   struct gbm_bo *bo;
+   struct wl_listener destroy_listener;
+   struct wl_list link;
+   uint32_t fd, refs;
+};
+
+// Client buffer scanned out from overlay plane.
+// Holds the buffer reference until plane stops showing it.
+struct drm_overlay_fb {
+   struct drm_import *import;
+   struct gbm_bo *bo;
+   struct wlc_buffer *buffer;
+   struct wlc_geometry geometry;
+   uint64_t zpos;
+   uint32_t fd;
+};
+
+// Plane stacking, prop is 0 when the kernel does not let us change it.
+// known is false when the driver does not expose zpos at all.
+struct drm_zpos {
+   uint64_t value, min, max;
+   uint32_t prop;
+   bool known;
 };
 
 struct drm_surface {
@@ -41,15 +97,50 @@ struct drm_surface {
    drmModeEncoder *encoder;
    drmModeCrtc *crtc;
 
+   // front is being scanned out, flip waits for page flip event.
+   // queued waits for flip to finish, used only when num_fbs > 2.
    struct drm_fb {
       struct gbm_bo *bo;
       uint32_t fd;
       uint32_t stride;
-   } fb[NUM_FBS];
+   } front, flip, queued;
+
+   // plane is 0 when surface uses legacy modesetting.
+   struct drm_props props;
+   uint32_t plane, mode_blob;
+
+   // Overlay planes, pending is assigned for the next page flip.
+   struct drm_overlay {
+      struct drm_plane_props props;
+      struct drm_overlay_fb pending, flip, front;
+      struct drm_zpos zpos;
+      uint32_t id;
+   } overlays[MAX_OVERLAYS];
+   struct drm_zpos zpos;
+   uint8_t num_overlays;
+
+   // Hardware cursor, bo[0] is NULL when not available.
+   // Written buffers alternate so we never touch the one being scanned out.
+   struct {
+      struct gbm_bo *bo[2];
+      struct wlc_origin pos, hotspot;
+      uint32_t w, h;
+      uint8_t current;
+      bool visible, restore;
+   } cursor;
 
    uint32_t stride;
-   uint8_t index;
-   bool flipping;
+   uint8_t num_fbs;
+
+   // finished is true when frame being flipped was already done for the output.
+   bool flipping, finished, suspended;
+};
+
+// Framebuffer registered for gbm_bo, stored as bo user data.
+// Lives as long as the bo does, gbm destroys it with the gbm_surface.
+struct drm_fb_data {
+   uint32_t fd;
+   uint32_t stride;
 };
 
 static struct {
@@ -62,10 +153,17 @@ static struct {
       void (*gbm_device_destroy)(struct gbm_device*);
       struct gbm_surface* (*gbm_surface_create)(struct gbm_device*, uint32_t, uint32_t, uint32_t, uint32_t);
       void (*gbm_surface_destroy)(struct gbm_surface*);
+      struct gbm_bo* (*gbm_bo_create)(struct gbm_device*, uint32_t, uint32_t, uint32_t, uint32_t);
+      void (*gbm_bo_destroy)(struct gbm_bo*);
+      int (*gbm_bo_write)(struct gbm_bo*, const void*, size_t);
+      struct gbm_bo* (*gbm_bo_import)(struct gbm_device*, uint32_t, void*, uint32_t);
+      uint32_t (*gbm_bo_get_format)(struct gbm_bo*);
       uint32_t (*gbm_bo_get_width)(struct gbm_bo*);
       uint32_t (*gbm_bo_get_height)(struct gbm_bo*);
       uint32_t (*gbm_bo_get_stride)(struct gbm_bo*);
       union gbm_bo_handle (*gbm_bo_get_handle)(struct gbm_bo*);
+      void (*gbm_bo_set_user_data)(struct gbm_bo*, void*, void (*)(struct gbm_bo*, void*));
+      void* (*gbm_bo_get_user_data)(struct gbm_bo*);
       int (*gbm_surface_has_free_buffers)(struct gbm_surface*);
       struct gbm_bo* (*gbm_surface_lock_front_buffer)(struct gbm_surface*);
       int (*gbm_surface_release_buffer)(struct gbm_surface*, struct gbm_bo*);
@@ -75,6 +173,8 @@ static struct {
 static struct {
    int fd;
    struct wl_event_source *event_source;
+   struct wl_list imports;
+   bool atomic;
 
    struct {
       void *handle;
@@ -92,6 +192,30 @@ static struct {
       void (*drmModeFreeConnector)(drmModeConnectorPtr);
       drmModeEncoderPtr (*drmModeGetEncoder)(int, uint32_t);
       void (*drmModeFreeEncoder)(drmModeEncoderPtr);
+      int (*drmModeSetCursor)(int, uint32_t, uint32_t, uint32_t, uint32_t);
+      int (*drmModeMoveCursor)(int, uint32_t, int, int);
+
+      // hardware cursor, optional
+      int (*drmGetCap)(int, uint64_t, uint64_t*);
+      int (*drmModeSetCursor2)(int, uint32_t, uint32_t, uint32_t, uint32_t, int32_t, int32_t);
+
+      // atomic modesetting, optional
+      int (*drmSetClientCap)(int, uint64_t, uint64_t);
+      int (*drmModeAddFB2)(int, uint32_t, uint32_t, uint32_t, const uint32_t[4], const uint32_t[4], const uint32_t[4], uint32_t*, uint32_t);
+      drmModeAtomicReqPtr (*drmModeAtomicAlloc)(void);
+      void (*drmModeAtomicFree)(drmModeAtomicReqPtr);
+      int (*drmModeAtomicAddProperty)(drmModeAtomicReqPtr, uint32_t, uint32_t, uint64_t);
+      int (*drmModeAtomicCommit)(int, drmModeAtomicReqPtr, uint32_t, void*);
+      int (*drmModeCreatePropertyBlob)(int, const void*, size_t, uint32_t*);
+      int (*drmModeDestroyPropertyBlob)(int, uint32_t);
+      drmModeObjectPropertiesPtr (*drmModeObjectGetProperties)(int, uint32_t, uint32_t);
+      void (*drmModeFreeObjectProperties)(drmModeObjectPropertiesPtr);
+      drmModePropertyPtr (*drmModeGetProperty)(int, uint32_t);
+      void (*drmModeFreeProperty)(drmModePropertyPtr);
+      drmModePlaneResPtr (*drmModeGetPlaneResources)(int);
+      void (*drmModeFreePlaneResources)(drmModePlaneResPtr);
+      drmModePlanePtr (*drmModeGetPlane)(int, uint32_t);
+      void (*drmModeFreePlane)(drmModePlanePtr);
    } api;
 } drm;
 
@@ -123,12 +247,25 @@ gbm_load(void)
       goto function_pointer_exception;
    if (!load(gbm_bo_get_stride))
       goto function_pointer_exception;
+   if (!load(gbm_bo_set_user_data))
+      goto function_pointer_exception;
+   if (!load(gbm_bo_get_user_data))
+      goto function_pointer_exception;
    if (!load(gbm_surface_has_free_buffers))
       goto function_pointer_exception;
    if (!load(gbm_surface_lock_front_buffer))
       goto function_pointer_exception;
    if (!load(gbm_surface_release_buffer))
       goto function_pointer_exception;
+   if (!load(gbm_bo_create))
+      goto function_pointer_exception;
+   if (!load(gbm_bo_destroy))
+      goto function_pointer_exception;
+
+   // without these we don't have hardware cursor or overlay planes
+   load(gbm_bo_write);
+   load(gbm_bo_import);
+   load(gbm_bo_get_format);
 
 #undef load
 
@@ -177,6 +314,31 @@ drm_load(void)
       goto function_pointer_exception;
    if (!load(drmModeFreeEncoder))
       goto function_pointer_exception;
+   if (!load(drmModeSetCursor))
+      goto function_pointer_exception;
+   if (!load(drmModeMoveCursor))
+      goto function_pointer_exception;
+
+   load(drmGetCap);
+   load(drmModeSetCursor2);
+
+   // Older libdrm does not have these, we fallback to legacy modesetting.
+   load(drmSetClientCap);
+   load(drmModeAddFB2);
+   load(drmModeAtomicAlloc);
+   load(drmModeAtomicFree);
+   load(drmModeAtomicAddProperty);
+   load(drmModeAtomicCommit);
+   load(drmModeCreatePropertyBlob);
+   load(drmModeDestroyPropertyBlob);
+   load(drmModeObjectGetProperties);
+   load(drmModeFreeObjectProperties);
+   load(drmModeGetProperty);
+   load(drmModeFreeProperty);
+   load(drmModeGetPlaneResources);
+   load(drmModeFreePlaneResources);
+   load(drmModeGetPlane);
+   load(drmModeFreePlane);
 
 #undef load
 
@@ -192,9 +354,7 @@ release_fb(struct gbm_surface *surface, struct drm_fb *fb)
 {
    assert(surface && fb);
 
-   if (fb->fd > 0)
-      drm.api.drmModeRmFB(drm.fd, fb->fd);
-
+   // framebuffer stays registered with the bo, see fb_data_for_bo
    if (fb->bo)
       gbm.api.gbm_surface_release_buffer(surface, fb->bo);
 
@@ -202,6 +362,207 @@ release_fb(struct gbm_surface *surface, struct drm_fb *fb)
    fb->fd = 0;
 }
 
+static void
+import_unref(struct drm_import *import)
+{
+   assert(import && import->refs > 0);
+
+   if (--import->refs > 0)
+      return;
+
+   // framebuffer is removed with the bo, see fb_data_destroy
+   if (import->bo)
+      gbm.api.gbm_bo_destroy(import->bo);
+
+   wl_list_remove(&import->link);
+   free(import);
+}
+
+static void
+release_overlay_fb(struct drm_overlay_fb *ofb)
+{
+   assert(ofb);
+
+   if (ofb->import)
+      import_unref(ofb->import);
+
+   if (ofb->buffer)
+      wlc_buffer_free(ofb->buffer);
+
+   memset(ofb, 0, sizeof(struct drm_overlay_fb));
+}
+
+static bool
+update_mode_blob(struct wlc_backend_surface *bsurface)
+{
+   assert(bsurface);
+   struct drm_surface *dsurface = bsurface->internal;
+
+   if (dsurface->mode_blob)
+      drm.api.drmModeDestroyPropertyBlob(drm.fd, dsurface->mode_blob);
+
+   dsurface->mode_blob = 0;
+   drmModeModeInfo *mode = &dsurface->connector->modes[bsurface->output->mode];
+   return !drm.api.drmModeCreatePropertyBlob(drm.fd, mode, sizeof(drmModeModeInfo), &dsurface->mode_blob);
+}
+
+static int
+add_plane(drmModeAtomicReq *req, uint32_t plane, const struct drm_plane_props *props, uint32_t crtc, uint32_t fb, const struct wlc_size *src, const struct wlc_geometry *dst)
+{
+   int ret = 0;
+
+#define add(p, v) (ret |= (drm.api.drmModeAtomicAddProperty(req, plane, p, v) < 0))
+
+   // fb == 0 disables the plane.
+   add(props->fb_id, fb);
+   add(props->crtc_id, (fb ? crtc : 0));
+
+   if (fb) {
+      add(props->src_x, 0);
+      add(props->src_y, 0);
+      add(props->src_w, (uint64_t)src->w << 16);
+      add(props->src_h, (uint64_t)src->h << 16);
+      add(props->crtc_x, dst->origin.x);
+      add(props->crtc_y, dst->origin.y);
+      add(props->crtc_w, dst->size.w);
+      add(props->crtc_h, dst->size.h);
+   }
+
+#undef add
+
+   return ret;
+}
+
+static bool
+atomic_commit(struct wlc_backend_surface *bsurface, struct drm_fb *fb, uint32_t flags)
+{
+   assert(bsurface);
+   struct drm_surface *dsurface = bsurface->internal;
+   const struct drm_props *props = &dsurface->props;
+   const uint32_t crtc = dsurface->encoder->crtc_id;
+   const uint32_t connector = dsurface->connector->connector_id;
+
+   drmModeAtomicReq *req;
+   if (!(req = drm.api.drmModeAtomicAlloc()))
+      return false;
+
+   int ret = 0;
+
+#define add(o, p, v) (ret |= (drm.api.drmModeAtomicAddProperty(req, o, p, v) < 0))
+
+   // fb == NULL disables the output.
+   if (flags & DRM_MODE_ATOMIC_ALLOW_MODESET) {
+      add(connector, props->connector.crtc_id, (fb ? crtc : 0));
+      add(crtc, props->crtc.mode_id, (fb ? dsurface->mode_blob : 0));
+      add(crtc, props->crtc.active, (fb ? 1 : 0));
+   }
+
+#undef add
+
+   struct wlc_geometry g = { { 0, 0 }, { 0, 0 } };
+   if (fb) {
+      g.size.w = gbm.api.gbm_bo_get_width(fb->bo);
+      g.size.h = gbm.api.gbm_bo_get_height(fb->bo);
+   }
+
+   ret |= add_plane(req, dsurface->plane, &props->plane, crtc, (fb ? fb->fd : 0), &g.size, &g);
+
+   // Overlays always show what was assigned for this commit.
+   for (uint32_t i = 0; i < dsurface->num_overlays; ++i) {
+      const struct drm_overlay *o = &dsurface->overlays[i];
+      const struct drm_overlay_fb *ofb = &o->pending;
+      const struct wlc_size src = { (ofb->bo ? gbm.api.gbm_bo_get_width(ofb->bo) : 0), (ofb->bo ? gbm.api.gbm_bo_get_height(ofb->bo) : 0) };
+      ret |= add_plane(req, o->id, &o->props, crtc, (fb ? ofb->fd : 0), &src, &ofb->geometry);
+
+      if (fb && ofb->bo && o->zpos.prop)
+         ret |= (drm.api.drmModeAtomicAddProperty(req, o->id, o->zpos.prop, ofb->zpos) < 0);
+   }
+
+   if (!ret)
+      ret = drm.api.drmModeAtomicCommit(drm.fd, req, flags, bsurface);
+
+   drm.api.drmModeAtomicFree(req);
+   return !ret;
+}
+
+static bool
+submit_fb(struct wlc_backend_surface *bsurface, struct drm_fb *fb)
+{
+   assert(bsurface && fb);
+   struct drm_surface *dsurface = bsurface->internal;
+   const bool modeset = (fb->stride != dsurface->stride);
+
+   if (dsurface->plane) {
+      uint32_t flags = DRM_MODE_PAGE_FLIP_EVENT | DRM_MODE_ATOMIC_NONBLOCK;
+
+      if (modeset) {
+         // Let the driver validate configuration before we touch the hardware.
+         if (!update_mode_blob(bsurface) || !atomic_commit(bsurface, fb, DRM_MODE_ATOMIC_TEST_ONLY | DRM_MODE_ATOMIC_ALLOW_MODESET))
+            goto test_fail;
+
+         flags |= DRM_MODE_ATOMIC_ALLOW_MODESET;
+      }
+
+      if (!atomic_commit(bsurface, fb, flags))
+         goto failed_to_page_flip;
+   } else {
+      if (modeset && drm.api.drmModeSetCrtc(drm.fd, dsurface->encoder->crtc_id, fb->fd, 0, 0, &dsurface->connector->connector_id, 1, &dsurface->connector->modes[bsurface->output->mode]))
+         goto set_crtc_fail;
+
+      if (drm.api.drmModePageFlip(drm.fd, dsurface->encoder->crtc_id, fb->fd, DRM_MODE_PAGE_FLIP_EVENT, bsurface))
+         goto failed_to_page_flip;
+   }
+
+   // Modeset may lose cursor, restore it once the flip is done.
+   dsurface->cursor.restore = (modeset && dsurface->cursor.visible);
+   for (uint32_t i = 0; i < dsurface->num_overlays; ++i) {
+      struct drm_overlay *o = &dsurface->overlays[i];
+      assert(!o->flip.bo);
+      o->flip = o->pending;
+      memset(&o->pending, 0, sizeof(o->pending));
+   }
+
+   dsurface->stride = fb->stride;
+   dsurface->flip = *fb;
+   dsurface->flipping = true;
+   memset(fb, 0, sizeof(struct drm_fb));
+   return true;
+
+test_fail:
+   wlc_log(WLC_LOG_WARN, "Atomic test commit for mode failed: %m");
+   goto fail;
+set_crtc_fail:
+   wlc_log(WLC_LOG_WARN, "Failed to set mode: %m");
+   goto fail;
+failed_to_page_flip:
+   wlc_log(WLC_LOG_WARN, "Failed to page flip: %m");
+fail:
+   release_fb(dsurface->surface, fb);
+   return false;
+}
+
+static bool
+apply_cursor(struct wlc_backend_surface *bsurface)
+{
+   assert(bsurface);
+   struct drm_surface *dsurface = bsurface->internal;
+   const uint32_t crtc = dsurface->encoder->crtc_id;
+
+   if (!dsurface->cursor.visible)
+      return !drm.api.drmModeSetCursor(drm.fd, crtc, 0, 0, 0);
+
+   const uint32_t handle = gbm.api.gbm_bo_get_handle(dsurface->cursor.bo[dsurface->cursor.current]).u32;
+
+   if (drm.api.drmModeSetCursor2) {
+      if (drm.api.drmModeSetCursor2(drm.fd, crtc, handle, dsurface->cursor.w, dsurface->cursor.h, dsurface->cursor.hotspot.x, dsurface->cursor.hotspot.y))
+         return false;
+   } else if (drm.api.drmModeSetCursor(drm.fd, crtc, handle, dsurface->cursor.w, dsurface->cursor.h)) {
+      return false;
+   }
+
+   return !drm.api.drmModeMoveCursor(drm.fd, crtc, dsurface->cursor.pos.x, dsurface->cursor.pos.y);
+}
+
 static void
 page_flip_handler(int fd, unsigned int frame, unsigned int sec, unsigned int usec, void *data)
 {
@@ -210,15 +571,45 @@ page_flip_handler(int fd, unsigned int frame, unsigned int sec, unsigned int use
    struct wlc_backend_surface *bsurface = data;
    struct drm_surface *dsurface = bsurface->internal;
 
-   uint8_t next = (dsurface->index + 1) % NUM_FBS;
-   release_fb(dsurface->surface, &dsurface->fb[next]);
-   dsurface->index = next;
+   release_fb(dsurface->surface, &dsurface->front);
+   dsurface->front = dsurface->flip;
+   memset(&dsurface->flip, 0, sizeof(dsurface->flip));
+   dsurface->flipping = false;
+
+   for (uint32_t i = 0; i < dsurface->num_overlays; ++i) {
+      struct drm_overlay *o = &dsurface->overlays[i];
+      release_overlay_fb(&o->front);
+      o->front = o->flip;
+      memset(&o->flip, 0, sizeof(o->flip));
+   }
+
+   if (dsurface->cursor.restore) {
+      apply_cursor(bsurface);
+      dsurface->cursor.restore = false;
+   }
 
    struct timespec ts;
    ts.tv_sec = sec;
    ts.tv_nsec = usec * 1000;
-   wlc_output_finish_frame(bsurface->output, &ts);
-   dsurface->flipping = false;
+   wlc_output_frame_presented(bsurface->output, &ts);
+
+   // Frame rendered ahead goes out on this vblank,
+   // while the renderer may start on the next one.
+   bool done = !dsurface->finished;
+   dsurface->finished = false;
+
+   if (dsurface->queued.bo) {
+      if (dsurface->suspended) {
+         release_fb(dsurface->surface, &dsurface->queued);
+      } else {
+         dsurface->finished = submit_fb(bsurface, &dsurface->queued);
+      }
+
+      done = true;
+   }
+
+   if (done)
+      wlc_output_frame_done(bsurface->output, &ts);
 }
 
 static int
@@ -233,6 +624,97 @@ drm_event(int fd, uint32_t mask, void *data)
    return 0;
 }
 
+static void
+fb_data_destroy(struct gbm_bo *bo, void *data)
+{
+   (void)bo;
+   struct drm_fb_data *fb_data = data;
+
+   if (fb_data->fd > 0 && drm.api.drmModeRmFB)
+      drm.api.drmModeRmFB(drm.fd, fb_data->fd);
+
+   free(fb_data);
+}
+
+// format == 0 registers legacy XRGB8888 framebuffer.
+static struct drm_fb_data*
+fb_data_for_bo(struct gbm_bo *bo, uint32_t format)
+{
+   assert(bo);
+
+   struct drm_fb_data *fb_data;
+   if ((fb_data = gbm.api.gbm_bo_get_user_data(bo)))
+      return fb_data;
+
+   if (!(fb_data = calloc(1, sizeof(struct drm_fb_data))))
+      return NULL;
+
+   uint32_t width = gbm.api.gbm_bo_get_width(bo);
+   uint32_t height = gbm.api.gbm_bo_get_height(bo);
+   uint32_t handle = gbm.api.gbm_bo_get_handle(bo).u32;
+   fb_data->stride = gbm.api.gbm_bo_get_stride(bo);
+
+   int ret;
+   if (format) {
+      const uint32_t handles[4] = { handle }, pitches[4] = { fb_data->stride }, offsets[4] = { 0 };
+      ret = drm.api.drmModeAddFB2(drm.fd, width, height, format, handles, pitches, offsets, &fb_data->fd, 0);
+   } else {
+      ret = drm.api.drmModeAddFB(drm.fd, width, height, 24, 32, fb_data->stride, handle, &fb_data->fd);
+   }
+
+   if (ret) {
+      free(fb_data);
+      return NULL;
+   }
+
+   gbm.api.gbm_bo_set_user_data(bo, fb_data, fb_data_destroy);
+   wlc_dlog(WLC_DBG_RENDER, "-> Registered fb (%u) for bo (%p)", fb_data->fd, bo);
+   return fb_data;
+}
+
+static void
+import_destroy(struct wl_listener *listener, void *data)
+{
+   (void)data;
+   struct drm_import *import;
+   import = wl_container_of(listener, import, destroy_listener);
+   wl_list_remove(&import->destroy_listener.link);
+   wl_list_init(&import->destroy_listener.link);
+   import_unref(import);
+}
+
+static struct drm_import*
+import_for_buffer(struct wl_resource *resource)
+{
+   assert(resource);
+
+   struct wl_listener *listener;
+   if ((listener = wl_resource_get_destroy_listener(resource, import_destroy))) {
+      struct drm_import *import;
+      return wl_container_of(listener, import, destroy_listener);
+   }
+
+   struct drm_import *import;
+   if (!(import = calloc(1, sizeof(struct drm_import))))
+      return NULL;
+
+   struct drm_fb_data *fb_data;
+   if ((import->bo = gbm.api.gbm_bo_import(gbm.device, GBM_BO_IMPORT_WL_BUFFER, resource, GBM_BO_USE_SCANOUT))) {
+      if ((fb_data = fb_data_for_bo(import->bo, gbm.api.gbm_bo_get_format(import->bo)))) {
+         import->fd = fb_data->fd;
+      } else {
+         gbm.api.gbm_bo_destroy(import->bo);
+         import->bo = NULL;
+      }
+   }
+
+   import->refs = 1;
+   import->destroy_listener.notify = import_destroy;
+   wl_resource_add_destroy_listener(resource, &import->destroy_listener);
+   wl_list_insert(&drm.imports, &import->link);
+   return import;
+}
+
 static bool
 create_fb(struct gbm_surface *surface, struct drm_fb *fb)
 {
@@ -244,15 +726,12 @@ create_fb(struct gbm_surface *surface, struct drm_fb *fb)
    if (!(fb->bo = gbm.api.gbm_surface_lock_front_buffer(surface)))
       goto failed_to_lock;
 
-   uint32_t width = gbm.api.gbm_bo_get_width(fb->bo);
-   uint32_t height = gbm.api.gbm_bo_get_height(fb->bo);
-   uint32_t handle = gbm.api.gbm_bo_get_handle(fb->bo).u32;
-   uint32_t stride = gbm.api.gbm_bo_get_stride(fb->bo);
-
-   if (drm.api.drmModeAddFB(drm.fd, width, height, 24, 32, stride, handle, &fb->fd))
+   struct drm_fb_data *fb_data;
+   if (!(fb_data = fb_data_for_bo(fb->bo, 0)))
       goto failed_to_create_fb;
 
-   fb->stride = stride;
+   fb->fd = fb_data->fd;
+   fb->stride = fb_data->stride;
    return true;
 
 no_buffers:
@@ -269,61 +748,265 @@ fail:
    return false;
 }
 
+static bool
+overlaps(const struct wlc_geometry *a, const struct wlc_geometry *b)
+{
+   assert(a && b);
+   return (a->origin.x < b->origin.x + (int32_t)b->size.w && b->origin.x < a->origin.x + (int32_t)a->size.w &&
+           a->origin.y < b->origin.y + (int32_t)b->size.h && b->origin.y < a->origin.y + (int32_t)a->size.h);
+}
+
+// Views are assigned from top to bottom, so overlay must stack below every plane assigned before it.
+static bool
+stack_overlay(struct drm_surface *dsurface, const struct drm_overlay *o, const struct wlc_geometry *geometry, uint64_t *out_zpos)
+{
+   assert(dsurface && o && geometry && out_zpos);
+
+   uint64_t ceiling = UINT64_MAX;
+   for (uint32_t i = 0; i < dsurface->num_overlays; ++i) {
+      const struct drm_overlay *p = &dsurface->overlays[i];
+      if (!p->pending.bo)
+         continue;
+
+      // Without zpos the hardware decides the order, they may not overlap then.
+      if (!o->zpos.known || !p->zpos.known) {
+         if (overlaps(geometry, &p->pending.geometry))
+            return false;
+         continue;
+      }
+
+      if (p->pending.zpos < ceiling)
+         ceiling = p->pending.zpos;
+   }
+
+   if (!o->zpos.known) {
+      *out_zpos = 0;
+      return true;
+   }
+
+   if (ceiling == 0)
+      return false;
+
+   const uint64_t zpos = (o->zpos.prop ? (o->zpos.max < ceiling ? o->zpos.max : ceiling - 1) : o->zpos.min);
+   if (zpos < o->zpos.min || zpos >= ceiling || (dsurface->zpos.known && zpos <= dsurface->zpos.value))
+      return false;
+
+   *out_zpos = zpos;
+   return true;
+}
+
+static bool
+assign_plane(struct wlc_backend_surface *bsurface, struct wlc_buffer *buffer, const struct wlc_geometry *geometry)
+{
+   assert(bsurface);
+   struct drm_surface *dsurface = bsurface->internal;
+
+   if (!buffer) {
+      for (uint32_t i = 0; i < dsurface->num_overlays; ++i)
+         release_overlay_fb(&dsurface->overlays[i].pending);
+      return true;
+   }
+
+   assert(geometry);
+
+   // Only hardware buffers, and we need current mode and framebuffer to test against.
+   if (!dsurface->stride || !dsurface->front.bo || !buffer->resource || !buffer->y_inverted || wl_shm_buffer_get(buffer->resource))
+      return false;
+
+   struct drm_import *import;
+   if (!(import = import_for_buffer(buffer->resource)) || !import->bo)
+      return false;
+
+   struct drm_overlay_fb ofb;
+   memset(&ofb, 0, sizeof(ofb));
+   ofb.bo = import->bo;
+   ofb.fd = import->fd;
+   ofb.geometry = *geometry;
+
+   // Planes differ in formats, scaling and stacking. Let the driver tell which one works.
+   for (uint32_t i = 0; i < dsurface->num_overlays; ++i) {
+      struct drm_overlay *o = &dsurface->overlays[i];
+      if (o->pending.bo || !stack_overlay(dsurface, o, geometry, &ofb.zpos))
+         continue;
+
+      o->pending = ofb;
+      if (atomic_commit(bsurface, &dsurface->front, DRM_MODE_ATOMIC_TEST_ONLY)) {
+         o->pending.import = import;
+         o->pending.buffer = wlc_buffer_use(buffer);
+         import->refs++;
+         return true;
+      }
+
+      memset(&o->pending, 0, sizeof(o->pending));
+   }
+
+   return false;
+}
+
 static bool
 page_flip(struct wlc_backend_surface *bsurface)
 {
    assert(bsurface && bsurface->internal);
    struct drm_surface *dsurface = bsurface->internal;
-   assert(!dsurface->flipping);
-   struct drm_fb *fb = &dsurface->fb[dsurface->index];
-   release_fb(dsurface->surface, fb);
 
-   if (!create_fb(dsurface->surface, fb))
+   if (dsurface->flipping) {
+      // Output renders ahead only when we finished the frame early below.
+      assert(dsurface->num_fbs > 2 && !dsurface->queued.bo);
+      return create_fb(dsurface->surface, &dsurface->queued);
+   }
+
+   struct drm_fb fb;
+   memset(&fb, 0, sizeof(fb));
+
+   if (!create_fb(dsurface->surface, &fb) || !submit_fb(bsurface, &fb))
       return false;
 
-   if (fb->stride != dsurface->stride) {
-      if (drm.api.drmModeSetCrtc(drm.fd, dsurface->encoder->crtc_id, fb->fd, 0, 0, &dsurface->connector->connector_id, 1, &dsurface->connector->modes[bsurface->output->mode]))
-         goto set_crtc_fail;
+   // With deeper swapchain let the renderer continue to next frame,
+   // instead of idling until the page flip event arrives.
+   // Presentation is reported from the page flip event.
+   if ((dsurface->finished = (dsurface->num_fbs > 2))) {
+      struct timespec ts;
+      wlc_get_time(&ts);
+      wlc_output_frame_done(bsurface->output, &ts);
+   }
+
+   return true;
+}
+
+static bool
+set_cursor(struct wlc_backend_surface *bsurface, const uint32_t *pixels, const struct wlc_size *size, const struct wlc_origin *hotspot)
+{
+   assert(bsurface);
+   struct drm_surface *dsurface = bsurface->internal;
+
+   if (!dsurface->cursor.bo[0])
+      return false;
 
-      dsurface->stride = fb->stride;
+   if (!pixels) {
+      dsurface->cursor.visible = false;
+      apply_cursor(bsurface);
+      return true;
    }
 
-   if (drm.api.drmModePageFlip(drm.fd, dsurface->encoder->crtc_id, fb->fd, DRM_MODE_PAGE_FLIP_EVENT, bsurface))
-      goto failed_to_page_flip;
+   assert(size && hotspot);
+   if (size->w > dsurface->cursor.w || size->h > dsurface->cursor.h)
+      goto too_large;
+
+   uint32_t *data;
+   if (!(data = calloc(dsurface->cursor.w * dsurface->cursor.h, sizeof(uint32_t))))
+      goto fail;
+
+   for (uint32_t y = 0; y < size->h; ++y)
+      memcpy(data + y * dsurface->cursor.w, pixels + y * size->w, size->w * sizeof(uint32_t));
+
+   const uint8_t next = !dsurface->cursor.current;
+   const int ret = gbm.api.gbm_bo_write(dsurface->cursor.bo[next], data, dsurface->cursor.w * dsurface->cursor.h * sizeof(uint32_t));
+   free(data);
+
+   if (ret)
+      goto write_fail;
+
+   dsurface->cursor.current = next;
+   dsurface->cursor.hotspot = *hotspot;
+   dsurface->cursor.visible = true;
+
+   // No mode set yet, cursor is applied after the first modeset.
+   if (!dsurface->stride) {
+      dsurface->cursor.restore = true;
+      return true;
+   }
+
+   if (!apply_cursor(bsurface))
+      goto set_cursor_fail;
 
-   dsurface->flipping = true;
    return true;
 
-set_crtc_fail:
-   wlc_log(WLC_LOG_WARN, "Failed to set mode: %m");
+too_large:
+   wlc_dlog(WLC_DBG_RENDER, "-> Cursor %ux%u does not fit %ux%u cursor plane", size->w, size->h, dsurface->cursor.w, dsurface->cursor.h);
    goto fail;
-failed_to_page_flip:
-   wlc_log(WLC_LOG_WARN, "Failed to page flip: %m");
+write_fail:
+   wlc_log(WLC_LOG_WARN, "Failed to write cursor bo");
+   goto fail;
+set_cursor_fail:
+   wlc_log(WLC_LOG_WARN, "Failed to set cursor: %m");
 fail:
-   release_fb(dsurface->surface, fb);
+   dsurface->cursor.visible = false;
+   apply_cursor(bsurface);
    return false;
 }
 
+static void
+move_cursor(struct wlc_backend_surface *bsurface, const struct wlc_origin *pos)
+{
+   assert(bsurface && pos);
+   struct drm_surface *dsurface = bsurface->internal;
+   dsurface->cursor.pos = *pos;
+
+   if (dsurface->cursor.visible && dsurface->stride)
+      drm.api.drmModeMoveCursor(drm.fd, dsurface->encoder->crtc_id, pos->x, pos->y);
+}
+
 static void
 surface_sleep(struct wlc_backend_surface *bsurface, bool sleep)
 {
    struct drm_surface *dsurface = bsurface->internal;
 
    if (sleep) {
-      drm.api.drmModeSetCrtc(drm.fd, dsurface->crtc->crtc_id, 0, 0, 0, NULL, 0, NULL);
+      if (dsurface->plane) {
+         atomic_commit(bsurface, NULL, DRM_MODE_ATOMIC_ALLOW_MODESET);
+
+         for (uint32_t i = 0; i < dsurface->num_overlays; ++i) {
+            release_overlay_fb(&dsurface->overlays[i].pending);
+            release_overlay_fb(&dsurface->overlays[i].flip);
+            release_overlay_fb(&dsurface->overlays[i].front);
+         }
+      } else
+         drm.api.drmModeSetCrtc(drm.fd, dsurface->crtc->crtc_id, 0, 0, 0, NULL, 0, NULL);
+
       dsurface->stride = 0;
    }
 }
 
+static void
+surface_suspend(struct wlc_backend_surface *bsurface, bool suspend)
+{
+   struct drm_surface *dsurface = bsurface->internal;
+
+   // We lost master, someone else owns the crtc until we get back.
+   // Keep everything, and just modeset again with the next frame.
+   if ((dsurface->suspended = suspend))
+      dsurface->stride = 0;
+
+   wlc_log(WLC_LOG_INFO, "%s drm surface (%p)", (suspend ? "Suspended" : "Resumed"), bsurface);
+}
+
 static void
 surface_free(struct wlc_backend_surface *bsurface)
 {
    struct drm_surface *dsurface = bsurface->internal;
-   struct drm_fb *fb = &dsurface->fb[dsurface->index];
-   release_fb(dsurface->surface, fb);
+   release_fb(dsurface->surface, &dsurface->queued);
+   release_fb(dsurface->surface, &dsurface->flip);
+   release_fb(dsurface->surface, &dsurface->front);
+
+   for (uint32_t i = 0; i < dsurface->num_overlays; ++i) {
+      release_overlay_fb(&dsurface->overlays[i].pending);
+      release_overlay_fb(&dsurface->overlays[i].flip);
+      release_overlay_fb(&dsurface->overlays[i].front);
+   }
+
+   if (dsurface->cursor.visible)
+      drm.api.drmModeSetCursor(drm.fd, dsurface->crtc->crtc_id, 0, 0, 0);
 
    drm.api.drmModeSetCrtc(drm.fd, dsurface->crtc->crtc_id, dsurface->crtc->buffer_id, dsurface->crtc->x, dsurface->crtc->y, &dsurface->connector->connector_id, 1, &dsurface->crtc->mode);
 
+   if (dsurface->mode_blob)
+      drm.api.drmModeDestroyPropertyBlob(drm.fd, dsurface->mode_blob);
+
+   for (uint32_t i = 0; i < 2; ++i) {
+      if (dsurface->cursor.bo[i])
+         gbm.api.gbm_bo_destroy(dsurface->cursor.bo[i]);
+   }
+
    if (dsurface->crtc)
       drm.api.drmModeFreeCrtc(dsurface->crtc);
 
@@ -339,6 +1022,187 @@ surface_free(struct wlc_backend_surface *bsurface)
    wlc_log(WLC_LOG_INFO, "Released drm surface (%p)", bsurface);
 }
 
+static bool
+get_property(uint32_t object, uint32_t type, const char *name, uint32_t *out_id, uint64_t *out_value)
+{
+   assert(name);
+
+   drmModeObjectProperties *props;
+   if (!(props = drm.api.drmModeObjectGetProperties(drm.fd, object, type)))
+      return false;
+
+   bool found = false;
+   for (uint32_t i = 0; i < props->count_props && !found; ++i) {
+      drmModePropertyRes *prop;
+      if (!(prop = drm.api.drmModeGetProperty(drm.fd, props->props[i])))
+         continue;
+
+      if ((found = !strcmp(prop->name, name))) {
+         if (out_id)
+            *out_id = prop->prop_id;
+         if (out_value)
+            *out_value = props->prop_values[i];
+      }
+
+      drm.api.drmModeFreeProperty(prop);
+   }
+
+   drm.api.drmModeFreeObjectProperties(props);
+   return found;
+}
+
+static uint32_t
+find_planes(uint32_t crtc_index, uint64_t type, uint32_t *out_planes, uint32_t max)
+{
+   assert(out_planes);
+
+   drmModePlaneRes *planes;
+   if (!(planes = drm.api.drmModeGetPlaneResources(drm.fd)))
+      return 0;
+
+   uint32_t count = 0;
+   for (uint32_t i = 0; i < planes->count_planes && count < max; ++i) {
+      drmModePlane *plane;
+      if (!(plane = drm.api.drmModeGetPlane(drm.fd, planes->planes[i])))
+         continue;
+
+      // Overlays shared between crtcs are left alone, so outputs never fight over them.
+      const uint32_t crtc = (1 << crtc_index);
+      const bool usable = (type == DRM_PLANE_TYPE_OVERLAY ? plane->possible_crtcs == crtc : (plane->possible_crtcs & crtc) != 0);
+
+      uint64_t value;
+      if (usable && get_property(plane->plane_id, DRM_MODE_OBJECT_PLANE, "type", NULL, &value) && value == type)
+         out_planes[count++] = plane->plane_id;
+
+      drm.api.drmModeFreePlane(plane);
+   }
+
+   drm.api.drmModeFreePlaneResources(planes);
+   return count;
+}
+
+static bool
+get_plane_props(uint32_t plane, struct drm_plane_props *out_props)
+{
+   assert(out_props);
+
+#define prop(n, out) get_property(plane, DRM_MODE_OBJECT_PLANE, n, out, NULL)
+
+   return (prop("FB_ID", &out_props->fb_id) &&
+           prop("CRTC_ID", &out_props->crtc_id) &&
+           prop("SRC_X", &out_props->src_x) &&
+           prop("SRC_Y", &out_props->src_y) &&
+           prop("SRC_W", &out_props->src_w) &&
+           prop("SRC_H", &out_props->src_h) &&
+           prop("CRTC_X", &out_props->crtc_x) &&
+           prop("CRTC_Y", &out_props->crtc_y) &&
+           prop("CRTC_W", &out_props->crtc_w) &&
+           prop("CRTC_H", &out_props->crtc_h));
+
+#undef prop
+}
+
+static void
+get_zpos(uint32_t plane, struct drm_zpos *out_zpos)
+{
+   assert(out_zpos);
+   memset(out_zpos, 0, sizeof(struct drm_zpos));
+
+   uint32_t id;
+   uint64_t value;
+   if (!get_property(plane, DRM_MODE_OBJECT_PLANE, "zpos", &id, &value))
+      return;
+
+   drmModePropertyRes *prop;
+   if (!(prop = drm.api.drmModeGetProperty(drm.fd, id)))
+      return;
+
+   out_zpos->known = true;
+   out_zpos->value = out_zpos->min = out_zpos->max = value;
+
+   if (!(prop->flags & DRM_MODE_PROP_IMMUTABLE) && (prop->flags & DRM_MODE_PROP_RANGE) && prop->count_values >= 2) {
+      out_zpos->prop = id;
+      out_zpos->min = prop->values[0];
+      out_zpos->max = prop->values[1];
+   }
+
+   drm.api.drmModeFreeProperty(prop);
+}
+
+static bool
+setup_atomic(struct drm_surface *dsurface, uint32_t crtc_index)
+{
+   assert(dsurface);
+
+   uint32_t plane;
+   if (!find_planes(crtc_index, DRM_PLANE_TYPE_PRIMARY, &plane, 1))
+      return false;
+
+   struct drm_props *p = &dsurface->props;
+   const uint32_t crtc = dsurface->crtc->crtc_id;
+   const uint32_t connector = dsurface->connector->connector_id;
+
+   if (!get_property(crtc, DRM_MODE_OBJECT_CRTC, "MODE_ID", &p->crtc.mode_id, NULL) ||
+       !get_property(crtc, DRM_MODE_OBJECT_CRTC, "ACTIVE", &p->crtc.active, NULL) ||
+       !get_property(connector, DRM_MODE_OBJECT_CONNECTOR, "CRTC_ID", &p->connector.crtc_id, NULL) ||
+       !get_plane_props(plane, &p->plane))
+      return false;
+
+   dsurface->plane = plane;
+   get_zpos(plane, &dsurface->zpos);
+
+   if (!gbm.api.gbm_bo_import || !gbm.api.gbm_bo_get_format || !drm.api.drmModeAddFB2)
+      return true;
+
+   uint32_t overlays[MAX_OVERLAYS];
+   const uint32_t count = find_planes(crtc_index, DRM_PLANE_TYPE_OVERLAY, overlays, MAX_OVERLAYS);
+   for (uint32_t i = 0; i < count; ++i) {
+      struct drm_overlay *o = &dsurface->overlays[dsurface->num_overlays];
+      if (!get_plane_props(overlays[i], &o->props))
+         continue;
+
+      get_zpos(overlays[i], &o->zpos);
+      o->id = overlays[i];
+      dsurface->num_overlays++;
+   }
+
+   wlc_log(WLC_LOG_INFO, "Found %u overlay planes for crtc (%u)", dsurface->num_overlays, crtc);
+   return true;
+}
+
+static void
+setup_cursor(struct gbm_device *device, struct drm_surface *dsurface)
+{
+   assert(device && dsurface);
+
+   if (!gbm.api.gbm_bo_write)
+      return;
+
+   uint64_t w = 64, h = 64;
+   if (drm.api.drmGetCap) {
+      drm.api.drmGetCap(drm.fd, DRM_CAP_CURSOR_WIDTH, &w);
+      drm.api.drmGetCap(drm.fd, DRM_CAP_CURSOR_HEIGHT, &h);
+   }
+
+   for (uint32_t i = 0; i < 2; ++i) {
+      if (!(dsurface->cursor.bo[i] = gbm.api.gbm_bo_create(device, w, h, GBM_FORMAT_ARGB8888, GBM_BO_USE_CURSOR | GBM_BO_USE_WRITE)))
+         goto fail;
+   }
+
+   dsurface->cursor.w = w;
+   dsurface->cursor.h = h;
+   return;
+
+fail:
+   wlc_log(WLC_LOG_WARN, "Failed to create cursor bo, using software cursor");
+
+   for (uint32_t i = 0; i < 2; ++i) {
+      if (dsurface->cursor.bo[i])
+         gbm.api.gbm_bo_destroy(dsurface->cursor.bo[i]);
+      dsurface->cursor.bo[i] = NULL;
+   }
+}
+
 static bool
 add_output(struct gbm_device *device, struct gbm_surface *surface, struct drm_output_information *info)
 {
@@ -352,12 +1216,31 @@ add_output(struct gbm_device *device, struct gbm_surface *surface, struct drm_ou
    dsurface->crtc = info->crtc;
    dsurface->surface = surface;
    dsurface->device = device;
+   dsurface->num_fbs = NUM_FBS;
+
+   const char *env;
+   if ((env = getenv("WLC_DRM_BUFFERS")))
+      dsurface->num_fbs = fmin(fmax(strtol(env, NULL, 10), 2), MAX_FBS);
+
+   if (drm.atomic && !setup_atomic(dsurface, info->crtc_index))
+      wlc_log(WLC_LOG_WARN, "No primary plane for connector (%u), using legacy modesetting", info->connector->connector_id);
+
+   setup_cursor(device, dsurface);
 
    bsurface->display = (EGLNativeDisplayType)device;
    bsurface->window = (EGLNativeWindowType)surface;
    bsurface->api.sleep = surface_sleep;
+   bsurface->api.suspend = surface_suspend;
    bsurface->api.page_flip = page_flip;
 
+   if (dsurface->num_overlays > 0)
+      bsurface->api.assign_plane = assign_plane;
+
+   if (dsurface->cursor.bo[0]) {
+      bsurface->api.set_cursor = set_cursor;
+      bsurface->api.move_cursor = move_cursor;
+   }
+
    struct wlc_output_event ev = { .add = { bsurface, &info->info }, .type = WLC_OUTPUT_EVENT_ADD };
    wl_signal_emit(&wlc_system_signals()->output, &ev);
    return true;
@@ -419,6 +1302,12 @@ query_drm(int fd, struct wl_array *out_infos)
       }
 
       memset(info, 0, sizeof(struct drm_output_information));
+
+      for (int i = 0; i < resources->count_crtcs; ++i) {
+         if (resources->crtcs[i] == crtc->crtc_id)
+            info->crtc_index = i;
+      }
+
       wlc_string_set(&info->info.make, "drm", false); // we can use colord for real info
       wlc_string_set(&info->info.model, "unknown", false); // ^
       info->info.physical_width = connector->mmWidth;
@@ -472,6 +1361,14 @@ terminate(void)
    if (drm.event_source)
       wl_event_source_remove(drm.event_source);
 
+   // Outputs are gone, only the wl_buffers still hold imports.
+   struct drm_import *import, *in;
+   wl_list_for_each_safe(import, in, &drm.imports, link) {
+      wl_list_remove(&import->destroy_listener.link);
+      wl_list_init(&import->destroy_listener.link);
+      import_unref(import);
+   }
+
    if (gbm.device)
       gbm.api.gbm_device_destroy(gbm.device);
 
@@ -559,9 +1456,28 @@ wlc_drm_init(struct wlc_backend *out_backend, struct wlc_compositor *compositor)
    if (!gbm_load() || !drm_load())
       goto fail;
 
-   if ((drm.fd = wlc_fd_open("/dev/dri/card0", O_RDWR, WLC_FD_DRM)) < 0)
+   const char *device = getenv("WLC_DRM_DEVICE");
+   if (!device)
+      device = "/dev/dri/card0";
+
+   if ((drm.fd = wlc_fd_open(device, O_RDWR, WLC_FD_DRM)) < 0)
       goto card_open_fail;
 
+   // Atomic modesetting needs universal planes, disable with WLC_DRM_ATOMIC=0
+   const char *atomic = getenv("WLC_DRM_ATOMIC");
+   drm.atomic = (!atomic || strcmp(atomic, "0")) &&
+                drm.api.drmSetClientCap && drm.api.drmModeAtomicAlloc && drm.api.drmModeAtomicFree &&
+                drm.api.drmModeAtomicAddProperty && drm.api.drmModeAtomicCommit &&
+                drm.api.drmModeCreatePropertyBlob && drm.api.drmModeDestroyPropertyBlob &&
+                drm.api.drmModeObjectGetProperties && drm.api.drmModeFreeObjectProperties &&
+                drm.api.drmModeGetProperty && drm.api.drmModeFreeProperty &&
+                drm.api.drmModeGetPlaneResources && drm.api.drmModeFreePlaneResources &&
+                drm.api.drmModeGetPlane && drm.api.drmModeFreePlane &&
+                !drm.api.drmSetClientCap(drm.fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1) &&
+                !drm.api.drmSetClientCap(drm.fd, DRM_CLIENT_CAP_ATOMIC, 1);
+
+   wlc_log(WLC_LOG_INFO, "Using %s modesetting on %s", (drm.atomic ? "atomic" : "legacy"), device);
+
    /* GBM will load a dri driver, but even though they need symbols from
     * libglapi, in some version of Mesa they are not linked to it. Since
     * only the gl-renderer module links to it, the call above won't make
@@ -572,6 +1488,8 @@ wlc_drm_init(struct wlc_backend *out_backend, struct wlc_compositor *compositor)
    if (!(gbm.device = gbm.api.gbm_create_device(drm.fd)))
       goto gbm_device_fail;
 
+   wl_list_init(&drm.imports);
+
    if (!update_outputs(NULL))
       goto fail;
 
@@ -583,7 +1501,7 @@ wlc_drm_init(struct wlc_backend *out_backend, struct wlc_compositor *compositor)
    return true;
 
 card_open_fail:
-   wlc_log(WLC_LOG_WARN, "Failed to open card: /dev/dri/card0");
+   wlc_log(WLC_LOG_WARN, "Failed to open card: %s", device);
    goto fail;
 gbm_device_fail:
    wlc_log(WLC_LOG_WARN, "gbm_create_device failed");
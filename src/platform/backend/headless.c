@@ -0,0 +1,422 @@
+#include "internal.h"
+#include "visibility.h"
+#include "headless.h"
+#include "backend.h"
+
+#include "compositor/compositor.h"
+#include "compositor/output.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <assert.h>
+#include <sys/timerfd.h>
+
+#include <wayland-server.h>
+#include <wayland-util.h>
+
+// FIXME: contains global state
+
+// Default mode of virtual outputs.
+// Override with WLC_HEADLESS_MODE env variable, eg. "1920x1080@60*2,1280x720@30".
+// Each entry configures one output, last entry is used for the rest of WLC_OUTPUTS.
+#define DEFAULT_WIDTH 1024
+#define DEFAULT_HEIGHT 768
+#define DEFAULT_REFRESH 60
+
+struct headless_output {
+   struct wlc_size resolution;
+   uint32_t refresh;
+   int32_t scale;
+   uint32_t id;
+};
+
+struct headless_surface {
+   struct wl_event_source *event_source;
+   int timer_fd;
+   uint32_t id;
+
+   // Vblanks are emulated at phase + n * period (CLOCK_MONOTONIC, ns)
+   uint64_t phase, period, vblank;
+   uint64_t frames;
+   bool pending;
+};
+
+static struct {
+   struct wl_array outputs;
+   uint32_t next_id;
+   bool init;
+} headless;
+
+static uint64_t
+timespec_to_ns(const struct timespec *ts)
+{
+   return (uint64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+static void
+ns_to_timespec(uint64_t ns, struct timespec *out_ts)
+{
+   out_ts->tv_sec = ns / 1000000000;
+   out_ts->tv_nsec = ns % 1000000000;
+}
+
+static int
+timer_event(int fd, uint32_t mask, void *data)
+{
+   (void)mask;
+   struct wlc_backend_surface *bsurface = data;
+   struct headless_surface *hsurface = bsurface->internal;
+
+   uint64_t expirations;
+   if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+      return 0;
+
+   if (!hsurface->pending)
+      return 0;
+
+   hsurface->pending = false;
+   hsurface->frames++;
+
+   struct timespec ts;
+   ns_to_timespec(hsurface->vblank, &ts);
+   wlc_output_finish_frame(bsurface->output, &ts);
+   return 0;
+}
+
+static bool
+page_flip(struct wlc_backend_surface *bsurface)
+{
+   struct headless_surface *hsurface = bsurface->internal;
+
+   if (hsurface->pending)
+      return true;
+
+   // Next vblank strictly after now, so each frame takes at least one period
+   struct timespec ts;
+   wlc_get_time(&ts);
+   const uint64_t now = timespec_to_ns(&ts);
+   hsurface->vblank = hsurface->phase + ((now - hsurface->phase) / hsurface->period + 1) * hsurface->period;
+
+   struct itimerspec its;
+   memset(&its, 0, sizeof(its));
+   ns_to_timespec(hsurface->vblank, &its.it_value);
+
+   if (timerfd_settime(hsurface->timer_fd, TFD_TIMER_ABSTIME, &its, NULL) != 0) {
+      wlc_log(WLC_LOG_WARN, "Failed to arm vblank timer");
+      return false;
+   }
+
+   hsurface->pending = true;
+   return true;
+}
+
+static void
+disarm(struct headless_surface *hsurface)
+{
+   struct itimerspec its;
+   memset(&its, 0, sizeof(its));
+   timerfd_settime(hsurface->timer_fd, 0, &its, NULL);
+   hsurface->pending = false;
+}
+
+static void
+surface_sleep(struct wlc_backend_surface *bsurface, bool sleep)
+{
+   if (sleep)
+      disarm(bsurface->internal);
+}
+
+static void
+surface_free(struct wlc_backend_surface *bsurface)
+{
+   struct headless_surface *hsurface = bsurface->internal;
+
+   if (hsurface->event_source)
+      wl_event_source_remove(hsurface->event_source);
+
+   if (hsurface->timer_fd >= 0)
+      close(hsurface->timer_fd);
+}
+
+static bool
+add_output(struct headless_output *hout)
+{
+   struct wlc_backend_surface *bsurface;
+   if (!(bsurface = wlc_backend_surface_new(surface_free, sizeof(struct headless_surface))))
+      return false;
+
+   struct headless_surface *hsurface = bsurface->internal;
+   hsurface->id = hout->id;
+   hsurface->period = 1000000000 / hout->refresh;
+
+   struct timespec ts;
+   wlc_get_time(&ts);
+   hsurface->phase = timespec_to_ns(&ts);
+
+   if ((hsurface->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)) < 0)
+      goto timer_fail;
+
+   if (!(hsurface->event_source = wl_event_loop_add_fd(wlc_event_loop(), hsurface->timer_fd, WL_EVENT_READABLE, timer_event, bsurface)))
+      goto timer_fail;
+
+   // No native window, context renders offscreen at the mode size
+   bsurface->display = EGL_DEFAULT_DISPLAY;
+   bsurface->pbuffer.width = hout->resolution.w;
+   bsurface->pbuffer.height = hout->resolution.h;
+   bsurface->api.page_flip = page_flip;
+   bsurface->api.sleep = surface_sleep;
+
+   struct wlc_output_information info;
+   memset(&info, 0, sizeof(info));
+   wlc_string_set(&info.make, "wlc", false);
+   wlc_string_set(&info.model, "Headless", false);
+   info.scale = hout->scale;
+
+   struct wlc_output_mode mode;
+   memset(&mode, 0, sizeof(mode));
+   mode.refresh = hout->refresh;
+   mode.width = hout->resolution.w;
+   mode.height = hout->resolution.h;
+   mode.flags = WL_OUTPUT_MODE_CURRENT | WL_OUTPUT_MODE_PREFERRED;
+   wlc_output_information_add_mode(&info, &mode);
+
+   wlc_log(WLC_LOG_INFO, "Headless output %u: %ux%u@%u scale %d", hout->id, hout->resolution.w, hout->resolution.h, hout->refresh, hout->scale);
+
+   struct wlc_output_event ev = { .add = { bsurface, &info }, .type = WLC_OUTPUT_EVENT_ADD };
+   wl_signal_emit(&wlc_system_signals()->output, &ev);
+   return true;
+
+timer_fail:
+   wlc_log(WLC_LOG_WARN, "Failed to create vblank timer");
+   wlc_backend_surface_free(bsurface);
+   return false;
+}
+
+static bool
+output_exists_for_id(struct wl_list *outputs, uint32_t id)
+{
+   struct wlc_output *o;
+   wl_list_for_each(o, outputs, link) {
+      if (o->bsurface && ((struct headless_surface*)o->bsurface->internal)->id == id)
+         return true;
+   }
+   return false;
+}
+
+static bool
+config_exists_for_id(uint32_t id)
+{
+   struct headless_output *hout;
+   wl_array_for_each(hout, &headless.outputs) {
+      if (hout->id == id)
+         return true;
+   }
+   return false;
+}
+
+static double
+pointer_abs_x(void *internal, uint32_t width)
+{
+   const struct wlc_origin *pos = internal;
+   return fmin(fmax(pos->x, 0), width);
+}
+
+static double
+pointer_abs_y(void *internal, uint32_t height)
+{
+   const struct wlc_origin *pos = internal;
+   return fmin(fmax(pos->y, 0), height);
+}
+
+static bool
+push_output(const struct wlc_size *resolution, uint32_t refresh, int32_t scale)
+{
+   if (!resolution->w || !resolution->h || !refresh || scale < 1)
+      return false;
+
+   struct headless_output *hout;
+   if (!(hout = wl_array_add(&headless.outputs, sizeof(struct headless_output))))
+      return false;
+
+   hout->resolution = *resolution;
+   hout->refresh = refresh;
+   hout->scale = scale;
+   hout->id = ++headless.next_id;
+   return true;
+}
+
+static bool
+parse_mode(const char *str, struct headless_output *out)
+{
+   int n = 0;
+   out->refresh = DEFAULT_REFRESH;
+   out->scale = 1;
+
+   if (sscanf(str, "%ux%u%n", &out->resolution.w, &out->resolution.h, &n) != 2)
+      return false;
+
+   str += n;
+   if (*str == '@' && sscanf(str, "@%u%n", &out->refresh, &n) == 1)
+      str += n;
+
+   if (*str == '*' && sscanf(str, "*%d%n", &out->scale, &n) == 1)
+      str += n;
+
+   return (*str == 0 || *str == ',');
+}
+
+static bool
+load_config(void)
+{
+   const char *env;
+   uint32_t count = 1;
+   if ((env = getenv("WLC_OUTPUTS")))
+      count = fmax(strtol(env, NULL, 10), 1);
+
+   struct headless_output mode = { { DEFAULT_WIDTH, DEFAULT_HEIGHT }, DEFAULT_REFRESH, 1, 0 };
+   const char *modes = getenv("WLC_HEADLESS_MODE");
+
+   for (uint32_t i = 0; i < count; ++i) {
+      if (modes && *modes) {
+         if (!parse_mode(modes, &mode)) {
+            wlc_log(WLC_LOG_WARN, "Invalid WLC_HEADLESS_MODE: %s", modes);
+            return false;
+         }
+
+         modes = strchr(modes, ',');
+         modes = (modes ? modes + 1 : NULL);
+      }
+
+      if (!push_output(&mode.resolution, mode.refresh, mode.scale))
+         return false;
+   }
+
+   return true;
+}
+
+static uint32_t
+update_outputs(struct wl_list *outputs)
+{
+   if (outputs) {
+      struct wlc_output *o, *on;
+      wl_list_for_each_safe(o, on, outputs, link) {
+         struct headless_surface *hsurface = (o->bsurface ? o->bsurface->internal : NULL);
+         if (hsurface && !config_exists_for_id(hsurface->id))
+            wlc_output_terminate(o);
+      }
+   }
+
+   uint32_t count = 0;
+   struct headless_output *hout;
+   wl_array_for_each(hout, &headless.outputs) {
+      if (outputs && output_exists_for_id(outputs, hout->id))
+         continue;
+
+      count += (add_output(hout) ? 1 : 0);
+   }
+
+   return count;
+}
+
+static void
+terminate(void)
+{
+   wl_array_release(&headless.outputs);
+   memset(&headless, 0, sizeof(headless));
+}
+
+WLC_API bool
+wlc_headless_add_output(const struct wlc_size *resolution, uint32_t refresh, int32_t scale)
+{
+   assert(resolution);
+
+   if (!headless.init || !push_output(resolution, refresh, scale))
+      return false;
+
+   struct wlc_output_event ev = { .type = WLC_OUTPUT_EVENT_UPDATE };
+   wl_signal_emit(&wlc_system_signals()->output, &ev);
+   return true;
+}
+
+WLC_API bool
+wlc_headless_remove_output(struct wlc_output *output)
+{
+   assert(output);
+
+   if (!headless.init || !output->bsurface || output->bsurface->api.page_flip != page_flip)
+      return false;
+
+   const uint32_t id = ((struct headless_surface*)output->bsurface->internal)->id;
+
+   struct headless_output *hout;
+   wl_array_for_each(hout, &headless.outputs) {
+      if (hout->id != id)
+         continue;
+
+      const size_t offset = (char*)hout - (char*)headless.outputs.data;
+      memmove(hout, hout + 1, headless.outputs.size - offset - sizeof(struct headless_output));
+      headless.outputs.size -= sizeof(struct headless_output);
+
+      struct wlc_output_event ev = { .type = WLC_OUTPUT_EVENT_UPDATE };
+      wl_signal_emit(&wlc_system_signals()->output, &ev);
+      return true;
+   }
+
+   return false;
+}
+
+WLC_API uint64_t
+wlc_headless_get_frames(struct wlc_output *output)
+{
+   assert(output);
+
+   if (!headless.init || !output->bsurface || output->bsurface->api.page_flip != page_flip)
+      return 0;
+
+   return ((struct headless_surface*)output->bsurface->internal)->frames;
+}
+
+WLC_API void
+wlc_headless_pointer_motion(const struct wlc_origin *pos, uint32_t time)
+{
+   assert(pos);
+
+   if (!headless.init)
+      return;
+
+   struct wlc_input_event ev;
+   ev.type = WLC_INPUT_EVENT_MOTION_ABSOLUTE;
+   ev.time = time;
+   ev.arrival = wlc_get_time_ns();
+   ev.motion_abs.x = pointer_abs_x;
+   ev.motion_abs.y = pointer_abs_y;
+   ev.motion_abs.internal = (void*)pos;
+   wl_signal_emit(&wlc_system_signals()->input, &ev);
+}
+
+bool
+wlc_headless_init(struct wlc_backend *out_backend, struct wlc_compositor *compositor)
+{
+   (void)compositor;
+
+   wl_array_init(&headless.outputs);
+
+   if (!load_config())
+      goto fail;
+
+   if (!update_outputs(NULL))
+      goto output_fail;
+
+   headless.init = true;
+   out_backend->api.update_outputs = update_outputs;
+   out_backend->api.terminate = terminate;
+   return true;
+
+output_fail:
+   wlc_log(WLC_LOG_WARN, "Failed to create output");
+fail:
+   terminate();
+   return false;
+}
@@ -0,0 +1,11 @@
+#ifndef _WLC_HEADLESS_H_
+#define _WLC_HEADLESS_H_
+
+#include <stdbool.h>
+
+struct wlc_backend;
+struct wlc_compositor;
+
+bool wlc_headless_init(struct wlc_backend *out_backend, struct wlc_compositor *compositor);
+
+#endif /* _WLC_HEADLESS_H_ */
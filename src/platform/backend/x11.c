@@ -261,6 +261,7 @@ x11_event(int fd, uint32_t mask, void *data)
    int count = 0;
    xcb_generic_event_t *event;
    struct wlc_compositor *compositor = data;
+   const uint64_t arrival = wlc_get_time_ns();
 
    while ((event = x11.api.xcb_poll_for_event(x11.connection))) {
       switch (event->response_type & ~0x80) {
@@ -316,6 +317,7 @@ x11_event(int fd, uint32_t mask, void *data)
             struct wlc_input_event ev;
             ev.type = WLC_INPUT_EVENT_MOTION_ABSOLUTE;
             ev.time = xev->time;
+            ev.arrival = arrival;
             ev.motion_abs.x = pointer_abs_x;
             ev.motion_abs.y = pointer_abs_y;
             ev.motion_abs.internal = xev;
@@ -329,6 +331,7 @@ x11_event(int fd, uint32_t mask, void *data)
             struct wlc_input_event ev;
             ev.type = WLC_INPUT_EVENT_BUTTON;
             ev.time = xev->time;
+            ev.arrival = arrival;
             ev.button.code = (xev->detail == 2 ? BTN_MIDDLE : (xev->detail == 3 ? BTN_RIGHT : xev->detail + BTN_LEFT - 1));
             ev.button.state = WL_POINTER_BUTTON_STATE_PRESSED;
             wl_signal_emit(&wlc_system_signals()->input, &ev);
@@ -340,6 +343,7 @@ x11_event(int fd, uint32_t mask, void *data)
             xcb_button_press_event_t *xev = (xcb_button_press_event_t*)event;
             struct wlc_input_event ev;
             ev.time = xev->time;
+            ev.arrival = arrival;
             switch (xev->detail) {
                case 4:
                case 5:
@@ -372,6 +376,7 @@ x11_event(int fd, uint32_t mask, void *data)
             struct wlc_input_event ev;
             ev.type = WLC_INPUT_EVENT_KEY;
             ev.time = xev->time;
+            ev.arrival = arrival;
             ev.key.code = xev->detail - 8;
             ev.key.state = WL_KEYBOARD_KEY_STATE_PRESSED;
             wl_signal_emit(&wlc_system_signals()->input, &ev);
@@ -384,6 +389,7 @@ x11_event(int fd, uint32_t mask, void *data)
             struct wlc_input_event ev;
             ev.type = WLC_INPUT_EVENT_KEY;
             ev.time = xev->time;
+            ev.arrival = arrival;
             ev.key.code = xev->detail - 8;
             ev.key.state = WL_KEYBOARD_KEY_STATE_RELEASED;
             wl_signal_emit(&wlc_system_signals()->input, &ev);
@@ -17,6 +17,10 @@
 
 #include <wayland-server.h>
 
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#  define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
 static void *bound = NULL;
 
 struct ctx {
@@ -54,6 +58,7 @@ static struct {
       EGLContext (*eglCreateContext)(EGLDisplay, EGLConfig, EGLContext, EGLint const*);
       EGLBoolean (*eglDestroyContext)(EGLDisplay, EGLContext);
       EGLSurface (*eglCreateWindowSurface)(EGLDisplay, EGLConfig, NativeWindowType, EGLint const*);
+      EGLSurface (*eglCreatePbufferSurface)(EGLDisplay, EGLConfig, EGLint const*);
       EGLBoolean (*eglDestroySurface)(EGLDisplay, EGLSurface);
       EGLBoolean (*eglMakeCurrent)(EGLDisplay, EGLSurface, EGLSurface, EGLContext);
       EGLBoolean (*eglSwapBuffers)(EGLDisplay, EGLSurface);
@@ -66,6 +71,9 @@ static struct {
       PFNEGLUNBINDWAYLANDDISPLAYWL eglUnbindWaylandDisplayWL;
       PFNEGLQUERYWAYLANDBUFFERWL eglQueryWaylandBufferWL;
       PFNEGLSWAPBUFFERSWITHDAMAGEEXTPROC eglSwapBuffersWithDamage;
+
+      // EGL 1.5, offscreen rendering without a windowing system
+      EGLDisplay (*eglGetPlatformDisplay)(EGLenum, void*, const intptr_t*);
    } api;
 } egl;
 
@@ -103,6 +111,8 @@ egl_load(void)
       goto function_pointer_exception;
    if (!load(eglCreateWindowSurface))
       goto function_pointer_exception;
+   if (!load(eglCreatePbufferSurface))
+      goto function_pointer_exception;
    if (!load(eglDestroySurface))
       goto function_pointer_exception;
    if (!load(eglMakeCurrent))
@@ -119,6 +129,8 @@ egl_load(void)
    load(eglUnbindWaylandDisplayWL);
    load(eglQueryWaylandBufferWL);
 
+   load(eglGetPlatformDisplay);
+
 #undef load
 
    return true;
@@ -251,7 +263,13 @@ create_context(struct wlc_backend_surface *surface)
    if (!(context = calloc(1, sizeof(struct ctx))))
       return NULL;
 
-   if (!(context->display = egl.api.eglGetDisplay(surface->display)))
+   // Without a native window render to a pbuffer, preferably on the surfaceless platform
+   const bool offscreen = !surface->window;
+
+   if (offscreen && egl.api.eglGetPlatformDisplay)
+      context->display = egl.api.eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+
+   if (!context->display && !(context->display = egl.api.eglGetDisplay(surface->display)))
       goto egl_fail;
 
    EGLint major, minor;
@@ -261,8 +279,8 @@ create_context(struct wlc_backend_surface *surface)
    if (!egl.api.eglBindAPI(EGL_OPENGL_ES_API))
       goto egl_fail;
 
-   static const EGLint config_attribs[] = {
-      EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
+   const EGLint config_attribs[] = {
+      EGL_SURFACE_TYPE, (offscreen ? EGL_PBUFFER_BIT : EGL_WINDOW_BIT),
       EGL_RED_SIZE, 1,
       EGL_GREEN_SIZE, 1,
       EGL_BLUE_SIZE, 1,
@@ -284,8 +302,18 @@ create_context(struct wlc_backend_surface *surface)
    if ((context->context = egl.api.eglCreateContext(context->display, context->config, EGL_NO_CONTEXT, context_attribs)) == EGL_NO_CONTEXT)
       goto egl_fail;
 
-   if ((context->surface = egl.api.eglCreateWindowSurface(context->display, context->config, surface->window, NULL)) == EGL_NO_SURFACE)
+   if (offscreen) {
+      const EGLint pbuffer_attribs[] = {
+         EGL_WIDTH, surface->pbuffer.width,
+         EGL_HEIGHT, surface->pbuffer.height,
+         EGL_NONE
+      };
+
+      if ((context->surface = egl.api.eglCreatePbufferSurface(context->display, context->config, pbuffer_attribs)) == EGL_NO_SURFACE)
+         goto egl_fail;
+   } else if ((context->surface = egl.api.eglCreateWindowSurface(context->display, context->config, surface->window, NULL)) == EGL_NO_SURFACE) {
       goto egl_fail;
+   }
 
    if (!egl.api.eglMakeCurrent(context->display, context->surface, context->surface, context->context))
       goto egl_fail;
@@ -9,6 +9,7 @@
 #include "compositor/surface.h"
 #include "compositor/buffer.h"
 #include "compositor/output.h"
+#include "compositor/seat/pointer.h"
 
 #include "compositor/shell/xdg-surface.h"
 #include "xwayland/xwm.h"
@@ -25,8 +26,6 @@
 
 static float DIM = 0.5f;
 
-static GLubyte cursor_palette[];
-
 enum program_type {
    PROGRAM_RGB,
    PROGRAM_RGBA,
@@ -437,7 +436,7 @@ create_context(void)
       const void *data;
    } images[TEXTURE_LAST] = {
       { GL_LUMINANCE, 1, 1, GL_UNSIGNED_BYTE, (GLubyte[]){ 0 } }, // TEXTURE_BLACK
-      { GL_LUMINANCE, 14, 14, GL_UNSIGNED_BYTE, cursor_palette }, // TEXTURE_CURSOR
+      { GL_LUMINANCE, WLC_POINTER_CURSOR_SIZE, WLC_POINTER_CURSOR_SIZE, GL_UNSIGNED_BYTE, wlc_pointer_cursor_palette }, // TEXTURE_CURSOR
    };
 
    GL_CALL(gl.api.glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
@@ -538,6 +537,7 @@ surface_destroy(struct ctx *context, struct wlc_surface *surface)
 
    surface_flush_textures(surface);
    surface_flush_images(surface->output->context, surface);
+   wlc_surface_set_storage(surface, 0, 0, 0);
    wlc_dlog(WLC_DBG_RENDER, "-> Destroyed surface");
 
    if (surface->output->context != context->context)
@@ -594,6 +594,9 @@ shm_attach(struct wlc_surface *surface, struct wlc_buffer *buffer, struct wl_shm
    void *data = wl_shm_buffer_get_data(buffer->shm_buffer);
    GL_CALL(gl.api.glTexImage2D(GL_TEXTURE_2D, 0, gl_format, pitch, buffer->size.h, 0, gl_format, gl_pixel_type, data));
    wl_shm_buffer_end_access(buffer->shm_buffer);
+
+   const uint64_t bytes = (uint64_t)pitch * buffer->size.h * (gl_pixel_type == GL_UNSIGNED_BYTE ? 4 : 2);
+   wlc_surface_set_storage(surface, bytes, bytes, 0);
    return true;
 }
 
@@ -656,6 +659,8 @@ egl_attach(struct ctx *context, struct wlc_surface *surface, struct wlc_buffer *
       GL_CALL(context->api.glEGLImageTargetTexture2DOES(target, surface->images[i]));
    }
 
+   // Actual layout is up to the driver, assume 32bpp
+   wlc_surface_set_storage(surface, 0, (uint64_t)buffer->size.w * buffer->size.h * 4, num_planes);
    return true;
 }
 
@@ -786,6 +791,11 @@ view_paint(struct ctx *context, struct wlc_view *view)
 
    struct wlc_geometry geometry;
    wlc_view_get_bounds(view, &geometry, &settings.visible);
+
+   // Filtered since sizes differ, without letterbox borders
+   if (wlc_view_get_stretch(view, &geometry))
+      memcpy(&settings.visible, &geometry, sizeof(struct wlc_geometry));
+
    surface_paint_internal(context, view->surface, &geometry, &settings);
 }
 
@@ -796,7 +806,7 @@ pointer_paint(struct ctx *context, struct wlc_origin *pos)
    struct paint settings;
    memset(&settings, 0, sizeof(settings));
    settings.program = PROGRAM_CURSOR;
-   struct wlc_geometry g = { *pos, { 14, 14 } };
+   struct wlc_geometry g = { *pos, { WLC_POINTER_CURSOR_SIZE, WLC_POINTER_CURSOR_SIZE } };
    texture_paint(context, &context->textures[TEXTURE_CURSOR], 1, &g, &settings);
 }
 
@@ -897,21 +907,3 @@ wlc_gles2_new(struct wlc_context *context, struct wlc_render_api *api)
    wlc_log(WLC_LOG_INFO, "GLES2 renderer initialized");
    return gl;
 }
-
-// 0 == black, 1 == white, 2 == transparent
-static GLubyte cursor_palette[] = {
-  0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
-  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01, 0x02,
-  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02, 0x02,
-  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02, 0x02, 0x02,
-  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02, 0x02, 0x02,
-  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02, 0x02,
-  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02,
-  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02,
-  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
-  0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02,
-  0x01, 0x00, 0x01, 0x02, 0x02, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02,
-  0x01, 0x01, 0x02, 0x02, 0x02, 0x02, 0x01, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02, 0x02,
-  0x01, 0x01, 0x02, 0x02, 0x02, 0x02, 0x02, 0x01, 0x00, 0x01, 0x02, 0x02, 0x02, 0x02,
-  0x01, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x01, 0x02, 0x02, 0x02, 0x02, 0x02
-};
@@ -3,13 +3,15 @@
 
 #include <dlfcn.h>
 #include <signal.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
 #include <sys/ioctl.h>
-#include <sys/select.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 
@@ -31,6 +33,10 @@ struct msg_request_fd_open {
    enum wlc_fd_type type;
 };
 
+struct msg_request_fd_close {
+   uint32_t slot, id; // of the open request
+};
+
 enum msg_type {
    TYPE_CHECK,
    TYPE_FD_OPEN,
@@ -39,30 +45,55 @@ enum msg_type {
    TYPE_DEACTIVATE
 };
 
+// Requests may be pipelined, the id pairs each response with its request.
 struct msg_request {
    enum msg_type type;
+   uint32_t id;
    union {
       struct msg_request_fd_open fd_open;
+      struct msg_request_fd_close fd_close;
    };
 };
 
 struct msg_response {
    enum msg_type type;
+   uint32_t id;
    union {
       bool activate;
       bool deactivate;
-      bool open;
+      struct {
+         uint32_t slot;
+         bool ok;
+      } open;
    };
 };
 
+// Open requests in flight at once, the socket buffers must hold them all.
+#define PIPELINE_DEPTH 16
+
 static struct {
+   // child: fds opened on behalf of the parent
    struct wlc_fd {
       int fd;
+      uint32_t id;
       enum wlc_fd_type type;
-   } fds[32];
+   } *fds;
+   uint32_t num_fds;
+
+   // parent: child slot of each received fd, indexed by the fd
+   struct wlc_fd_handle {
+      uint32_t slot, id;
+   } *handles;
+   uint32_t num_handles;
+
+   uint32_t next_id;
    int socket;
    pid_t child;
-} wlc;
+   pthread_mutex_t lock; // requests may come from the input thread
+} wlc = {
+   .next_id = 1,
+   .lock = PTHREAD_MUTEX_INITIALIZER,
+};
 
 static bool
 drm_load(void)
@@ -105,13 +136,16 @@ write_fd(const int sock, const int fd, const void *buffer, const ssize_t buffer_
       .msg_iovlen = 1,
    };
 
-   message.msg_control = control;
-   message.msg_controllen = sizeof(control);
-   struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
-   cmsg->cmsg_len = CMSG_LEN(sizeof(fd));
-   cmsg->cmsg_level = SOL_SOCKET;
-   cmsg->cmsg_type = SCM_RIGHTS;
-   memcpy(CMSG_DATA(cmsg), &fd, sizeof(fd));
+   if (fd >= 0) {
+      message.msg_control = control;
+      message.msg_controllen = sizeof(control);
+      struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+      cmsg->cmsg_len = CMSG_LEN(sizeof(fd));
+      cmsg->cmsg_level = SOL_SOCKET;
+      cmsg->cmsg_type = SCM_RIGHTS;
+      memcpy(CMSG_DATA(cmsg), &fd, sizeof(fd));
+   }
+
    return sendmsg(sock, &message, 0);
 }
 
@@ -146,22 +180,9 @@ recv_fd(const int sock, int *out_fd, void *out_buffer, const ssize_t buffer_size
 }
 
 static int
-fd_open(const char *path, const int flags, const enum wlc_fd_type type)
+fd_open(const char *path, const int flags, const enum wlc_fd_type type, const uint32_t id, uint32_t *out_slot)
 {
-   assert(path);
-
-   struct wlc_fd *pfd = NULL;
-   for (unsigned int i = 0; i < sizeof(wlc.fds) / sizeof(struct wlc_fd); ++i) {
-      if (wlc.fds[i].fd < 0) {
-         pfd = &wlc.fds[i];
-         break;
-      }
-   }
-
-   if (!pfd) {
-      wlc_log(WLC_LOG_ERROR, "Maximum number of fds opened");
-      return -1;
-   }
+   assert(path && out_slot);
 
    /* we will only open allowed paths */
 #define FILTER(x) { x, (sizeof(x) > 32 ? 32 : sizeof(x)) - 1 }
@@ -174,13 +195,39 @@ fd_open(const char *path, const int flags, const enum wlc_fd_type type)
    };
 #undef FILTER
 
-   if (type > WLC_FD_LAST || memcmp(path, allow[type].base, allow[type].size)) {
-      wlc_log(WLC_LOG_WARN, "Denying open from: %s", path);
+   if (type >= WLC_FD_LAST || memcmp(path, allow[type].base, allow[type].size) || !memchr(path, 0, sizeof(((struct msg_request_fd_open*)NULL)->path))) {
+      wlc_log(WLC_LOG_WARN, "Denying open from: %.32s", path);
       return -1;
    }
 
+   struct wlc_fd *pfd = NULL;
+   for (uint32_t i = 0; i < wlc.num_fds; ++i) {
+      if (wlc.fds[i].fd < 0) {
+         pfd = &wlc.fds[i];
+         break;
+      }
+   }
+
+   if (!pfd) {
+      const uint32_t num = (wlc.num_fds > 0 ? wlc.num_fds * 2 : 32);
+
+      struct wlc_fd *fds;
+      if (!(fds = realloc(wlc.fds, num * sizeof(struct wlc_fd)))) {
+         wlc_log(WLC_LOG_ERROR, "Could not grow fd table to %u", num);
+         return -1;
+      }
+
+      for (uint32_t i = wlc.num_fds; i < num; ++i)
+         fds[i].fd = -1;
+
+      pfd = &fds[wlc.num_fds];
+      wlc.fds = fds;
+      wlc.num_fds = num;
+   }
+
    pfd->fd = open(path, flags);
    pfd->type = type;
+   pfd->id = id;
 
    if (pfd->type == WLC_FD_DRM && drm.api.drmSetMaster)
       drm.api.drmSetMaster(pfd->fd);
@@ -188,25 +235,18 @@ fd_open(const char *path, const int flags, const enum wlc_fd_type type)
    if (pfd->fd < 0)
       wlc_log(WLC_LOG_WARN, "Error opening (%m): %s", path);
 
+   *out_slot = pfd - wlc.fds;
    return pfd->fd;
 }
 
 static void
-fd_close(const int fd)
+fd_close(const uint32_t slot, const uint32_t id)
 {
-   if (fd < 0)
+   // the fd may already be gone (revoked on deactivate) and the slot reused
+   if (slot >= wlc.num_fds || wlc.fds[slot].fd < 0 || wlc.fds[slot].id != id)
       return;
 
-   struct wlc_fd *pfd = NULL;
-   for (unsigned int i = 0; i < sizeof(wlc.fds) / sizeof(struct wlc_fd); ++i) {
-      if (wlc.fds[i].fd == fd) {
-         pfd = &wlc.fds[i];
-         break;
-      }
-   }
-
-   if (!pfd)
-      return;
+   struct wlc_fd *pfd = &wlc.fds[slot];
 
    if (pfd->type == WLC_FD_DRM && drm.api.drmDropMaster)
       drm.api.drmDropMaster(pfd->fd);
@@ -218,7 +258,7 @@ fd_close(const int fd)
 static bool
 activate(void)
 {
-   for (unsigned int i = 0; i < sizeof(wlc.fds) / sizeof(struct wlc_fd); ++i) {
+   for (uint32_t i = 0; i < wlc.num_fds; ++i) {
       if (wlc.fds[i].fd < 0)
          continue;
 
@@ -242,7 +282,7 @@ static bool
 deactivate(void)
 {
    // try drop drm fds first before we kill input
-   for (unsigned int i = 0; i < sizeof(wlc.fds) / sizeof(struct wlc_fd); ++i) {
+   for (uint32_t i = 0; i < wlc.num_fds; ++i) {
       if (wlc.fds[i].fd < 0 || wlc.fds[i].type != WLC_FD_DRM)
          continue;
 
@@ -252,7 +292,7 @@ deactivate(void)
       }
    }
 
-   for (unsigned int i = 0; i < sizeof(wlc.fds) / sizeof(struct wlc_fd); ++i) {
+   for (uint32_t i = 0; i < wlc.num_fds; ++i) {
       if (wlc.fds[i].fd < 0)
          continue;
 
@@ -276,32 +316,34 @@ deactivate(void)
 }
 
 static void
-handle_request(const int sock, int fd, const struct msg_request *request)
+handle_request(const int sock, const struct msg_request *request)
 {
    struct msg_response response;
    memset(&response, 0, sizeof(response));
    response.type = request->type;
+   response.id = request->id;
 
+   int fd = -1;
    switch (request->type) {
       case TYPE_CHECK:
-         write_fd(sock, (fd >= 0 ? fd : 0), &response, sizeof(response));
+         write_fd(sock, -1, &response, sizeof(response));
          break;
       case TYPE_FD_OPEN:
-         fd = fd_open(request->fd_open.path, request->fd_open.flags, request->fd_open.type);
-         response.open = (fd != -1);
-         write_fd(sock, (fd >= 0 ? fd : 0), &response, sizeof(response));
+         fd = fd_open(request->fd_open.path, request->fd_open.flags, request->fd_open.type, request->id, &response.open.slot);
+         response.open.ok = (fd >= 0);
+         write_fd(sock, fd, &response, sizeof(response));
          break;
       case TYPE_FD_CLOSE:
          /* we will only close file descriptors opened by us. */
-         fd_close(fd);
+         fd_close(request->fd_close.slot, request->fd_close.id);
          break;
       case TYPE_ACTIVATE:
          response.activate = activate();
-         write_fd(sock, (fd >= 0 ? fd : 0), &response, sizeof(response));
+         write_fd(sock, -1, &response, sizeof(response));
          break;
       case TYPE_DEACTIVATE:
          response.deactivate = deactivate();
-         write_fd(sock, (fd >= 0 ? fd : 0), &response, sizeof(response));
+         write_fd(sock, -1, &response, sizeof(response));
          break;
    }
 }
@@ -309,17 +351,22 @@ handle_request(const int sock, int fd, const struct msg_request *request)
 static void
 communicate(const int sock, const pid_t parent)
 {
-   memset(wlc.fds, -1, sizeof(wlc.fds));
-
    do {
       int fd = -1;
       struct msg_request request;
-      while (recv_fd(sock, &fd, &request, sizeof(request)) == sizeof(request))
-         handle_request(sock, fd, &request);
+      while (recv_fd(sock, &fd, &request, sizeof(request)) == sizeof(request)) {
+         // requests carry no fds, don't keep any that were sent anyway
+         if (fd >= 0) {
+            close(fd);
+            fd = -1;
+         }
+
+         handle_request(sock, &request);
+      }
    } while (kill(parent, 0) == 0);
 
    // Close all open fds
-   for (unsigned int i = 0; i < sizeof(wlc.fds) / sizeof(struct wlc_fd); ++i) {
+   for (uint32_t i = 0; i < wlc.num_fds; ++i) {
       if (wlc.fds[i].fd < 0)
          continue;
 
@@ -329,46 +376,87 @@ communicate(const int sock, const pid_t parent)
       close(wlc.fds[i].fd);
    }
 
+   free(wlc.fds);
+   wlc.fds = NULL;
+   wlc.num_fds = 0;
+
    wlc_log(WLC_LOG_INFO, "Parent exit (%u)", parent);
    wlc_cleanup();
 }
 
+static void
+write_or_die(const int sock, const int fd, const void *buffer, const ssize_t size)
+{
+   ssize_t ret;
+   while ((ret = write_fd(sock, fd, buffer, size)) < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+      struct pollfd pfd = { .fd = sock, .events = POLLOUT };
+      poll(&pfd, 1, 1000);
+   }
+
+   if (ret != size)
+      die("Failed to write %zu bytes to socket", size);
+}
+
+static void
+request_close(const int sock, const uint32_t slot, const uint32_t id)
+{
+   struct msg_request request;
+   memset(&request, 0, sizeof(request));
+   request.type = TYPE_FD_CLOSE;
+   request.id = wlc.next_id++;
+   request.fd_close.slot = slot;
+   request.fd_close.id = id;
+   write_or_die(sock, -1, &request, sizeof(request));
+}
+
 static bool
-read_response(const int sock, int *out_fd, struct msg_response *response, const enum msg_type expected_type)
+read_response(const int sock, const uint32_t id, int *out_fd, struct msg_response *response, const enum msg_type expected_type)
 {
    if (out_fd)
       *out_fd = -1;
 
-   memset(response, 0, sizeof(struct msg_response));
+   for (;;) {
+      memset(response, 0, sizeof(struct msg_response));
+
+      // poll instead of select, the socket may be above FD_SETSIZE
+      int ret;
+      struct pollfd pfd = { .fd = sock, .events = POLLIN };
+      while ((ret = poll(&pfd, 1, 1000)) < 0 && errno == EINTR);
 
-   fd_set set;
-   FD_ZERO(&set);
-   FD_SET(sock, &set);
+      if (ret != 1)
+         return false;
 
-   struct timeval timeout;
-   memset(&timeout, 0, sizeof(timeout));
-   timeout.tv_sec = 1;
+      int fd = -1;
+      ssize_t read = 0;
+      do {
+         read = recv_fd(sock, &fd, response, sizeof(struct msg_response));
+      } while (read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR));
+
+      if (read != sizeof(struct msg_response)) {
+         if (fd >= 0)
+            close(fd);
+         return false;
+      }
 
-   if (select(sock + 1, &set, NULL, NULL, &timeout) != 1)
-      return false;
+      // response to a request that timed out earlier, the child still holds what it opened
+      if (response->id != id) {
+         wlc_log(WLC_LOG_WARN, "Dropping stale response %u (waiting for %u)", response->id, id);
 
-   int fd = -1;
-   ssize_t ret = 0;
-   do {
-      ret = recv_fd(sock, &fd, response, sizeof(struct msg_response));
-   } while (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+         if (response->type == TYPE_FD_OPEN && response->open.ok)
+            request_close(sock, response->open.slot, response->id);
 
-   if (out_fd)
-      *out_fd = fd;
+         if (fd >= 0)
+            close(fd);
+         continue;
+      }
 
-   return (ret == sizeof(struct msg_response) && response->type == expected_type);
-}
+      if (out_fd)
+         *out_fd = fd;
+      else if (fd >= 0)
+         close(fd);
 
-static void
-write_or_die(const int sock, const int fd, const void *buffer, const ssize_t size)
-{
-   if (write_fd(sock, (fd >= 0 ? fd : 0), buffer, size) != size)
-      die("Failed to write %zu bytes to socket", size);
+      return (response->type == expected_type);
+   }
 }
 
 static bool
@@ -376,9 +464,53 @@ check_socket(const int sock)
 {
    struct msg_request request;
    memset(&request, 0, sizeof(request));
+   request.type = TYPE_CHECK;
+   request.id = wlc.next_id++;
    write_or_die(sock, -1, &request, sizeof(request));
    struct msg_response response;
-   return read_response(sock, NULL, &response, TYPE_CHECK);
+   return read_response(sock, request.id, NULL, &response, TYPE_CHECK);
+}
+
+static void
+lock(sigset_t *out_old)
+{
+   // VT switch signals call wlc_fd_(de)activate from the handler, keep them
+   // from interrupting a request that holds the lock on this thread.
+   sigset_t set;
+   sigemptyset(&set);
+   sigaddset(&set, SIGUSR1);
+   sigaddset(&set, SIGUSR2);
+   pthread_sigmask(SIG_BLOCK, &set, out_old);
+   pthread_mutex_lock(&wlc.lock);
+}
+
+static void
+unlock(const sigset_t *old)
+{
+   pthread_mutex_unlock(&wlc.lock);
+   pthread_sigmask(SIG_SETMASK, old, NULL);
+}
+
+static void
+track(const int fd, const uint32_t slot, const uint32_t id)
+{
+   if ((uint32_t)fd >= wlc.num_handles) {
+      uint32_t num = (wlc.num_handles > 0 ? wlc.num_handles : 32);
+      while (num <= (uint32_t)fd)
+         num *= 2;
+
+      struct wlc_fd_handle *handles;
+      if (!(handles = realloc(wlc.handles, num * sizeof(struct wlc_fd_handle)))) {
+         wlc_log(WLC_LOG_WARN, "Could not track fd %d, it stays open in the child", fd);
+         return;
+      }
+
+      memset(handles + wlc.num_handles, 0, (num - wlc.num_handles) * sizeof(struct wlc_fd_handle));
+      wlc.handles = handles;
+      wlc.num_handles = num;
+   }
+
+   wlc.handles[fd] = (struct wlc_fd_handle){ .slot = slot, .id = id };
 }
 
 static void
@@ -388,32 +520,87 @@ signal_handler(int signal)
       _exit(EXIT_SUCCESS);
 }
 
-int
-wlc_fd_open(const char *path, const int flags, const enum wlc_fd_type type)
+void
+wlc_fd_open_many(struct wlc_fd_request *requests, const uint32_t count)
 {
-   struct msg_request request;
-   memset(&request, 0, sizeof(request));
-   request.type = TYPE_FD_OPEN;
-   strncpy(request.fd_open.path, path, sizeof(request.fd_open.path));
-   request.fd_open.flags = flags;
-   request.fd_open.type = type;
-   write_or_die(wlc.socket, -1, &request, sizeof(request));
+   assert(requests || count == 0);
+
+   sigset_t old;
+   lock(&old);
+
+   for (uint32_t start = 0; start < count; start += PIPELINE_DEPTH) {
+      const uint32_t end = (count - start > PIPELINE_DEPTH ? start + PIPELINE_DEPTH : count);
+
+      // send the whole window before reading anything back, so the child
+      // opens the next device while we receive the previous one
+      uint32_t ids[PIPELINE_DEPTH];
+      for (uint32_t i = start; i < end; ++i) {
+         requests[i].fd = -1;
+         ids[i - start] = 0;
+
+         if (strlen(requests[i].path) >= sizeof(((struct msg_request_fd_open*)NULL)->path)) {
+            wlc_log(WLC_LOG_WARN, "Path too long: %s", requests[i].path);
+            continue;
+         }
+
+         struct msg_request request;
+         memset(&request, 0, sizeof(request));
+         request.type = TYPE_FD_OPEN;
+         request.id = ids[i - start] = wlc.next_id++;
+         strncpy(request.fd_open.path, requests[i].path, sizeof(request.fd_open.path));
+         request.fd_open.flags = requests[i].flags;
+         request.fd_open.type = requests[i].type;
+         write_or_die(wlc.socket, -1, &request, sizeof(request));
+      }
 
-   int fd = -1;
-   struct msg_response response;
-   if (!read_response(wlc.socket, &fd, &response, TYPE_FD_OPEN) || !response.open)
-      return -1;
+      for (uint32_t i = start; i < end; ++i) {
+         if (!ids[i - start])
+            continue;
+
+         int fd = -1;
+         struct msg_response response;
+         if (!read_response(wlc.socket, ids[i - start], &fd, &response, TYPE_FD_OPEN) || !response.open.ok || fd < 0) {
+            // opened in the child, but the fd did not make it here
+            if (response.type == TYPE_FD_OPEN && response.id == ids[i - start] && response.open.ok)
+               request_close(wlc.socket, response.open.slot, response.id);
+
+            if (fd >= 0)
+               close(fd);
+            continue;
+         }
+
+         track(fd, response.open.slot, ids[i - start]);
+         requests[i].fd = fd;
+      }
+   }
 
-   return fd;
+   unlock(&old);
+}
+
+int
+wlc_fd_open(const char *path, const int flags, const enum wlc_fd_type type)
+{
+   struct wlc_fd_request request = { .path = path, .flags = flags, .type = type };
+   wlc_fd_open_many(&request, 1);
+   return request.fd;
 }
 
 void
 wlc_fd_close(const int fd)
 {
-   struct msg_request request;
-   memset(&request, 0, sizeof(request));
-   request.type = TYPE_FD_CLOSE;
-   write_or_die(wlc.socket, fd, &request, sizeof(request));
+   if (fd < 0)
+      return;
+
+   sigset_t old;
+   lock(&old);
+
+   if ((uint32_t)fd < wlc.num_handles && wlc.handles[fd].id) {
+      request_close(wlc.socket, wlc.handles[fd].slot, wlc.handles[fd].id);
+      memset(&wlc.handles[fd], 0, sizeof(struct wlc_fd_handle));
+   }
+
+   close(fd);
+   unlock(&old);
 }
 
 bool
@@ -423,8 +610,13 @@ wlc_fd_activate(void)
    struct msg_request request;
    memset(&request, 0, sizeof(request));
    request.type = TYPE_ACTIVATE;
+   sigset_t old;
+   lock(&old);
+   request.id = wlc.next_id++;
    write_or_die(wlc.socket, -1, &request, sizeof(request));
-   return read_response(wlc.socket, NULL, &response, TYPE_ACTIVATE) && response.activate;
+   const bool activated = read_response(wlc.socket, request.id, NULL, &response, TYPE_ACTIVATE) && response.activate;
+   unlock(&old);
+   return activated;
 }
 
 bool
@@ -434,8 +626,13 @@ wlc_fd_deactivate(void)
    struct msg_request request;
    memset(&request, 0, sizeof(request));
    request.type = TYPE_DEACTIVATE;
+   sigset_t old;
+   lock(&old);
+   request.id = wlc.next_id++;
    write_or_die(wlc.socket, -1, &request, sizeof(request));
-   return read_response(wlc.socket, NULL, &response, TYPE_DEACTIVATE) && response.deactivate;
+   const bool deactivated = read_response(wlc.socket, request.id, NULL, &response, TYPE_DEACTIVATE) && response.deactivate;
+   unlock(&old);
+   return deactivated;
 }
 
 void
@@ -446,6 +643,10 @@ wlc_fd_terminate(void)
 
    kill(wlc.child, SIGTERM);
    wlc.child = 0;
+
+   free(wlc.handles);
+   wlc.handles = NULL;
+   wlc.num_handles = 0;
 }
 
 void
@@ -455,7 +656,7 @@ wlc_fd_init(const int argc, char *argv[])
    if (socketpair(AF_LOCAL, SOCK_SEQPACKET, 0, sock) != 0)
       die("Failed to create fd passing unix domain socket pair: %m");
 
-   if (fcntl(sock[0], F_SETFD, FD_CLOEXEC | O_NONBLOCK) != 0)
+   if (fcntl(sock[0], F_SETFD, FD_CLOEXEC) != 0 || fcntl(sock[0], F_SETFL, fcntl(sock[0], F_GETFL) | O_NONBLOCK) != 0)
       die("Could not set CLOEXEC and NONBLOCK on socket: %m");
 
    if (fcntl(sock[1], F_SETFL, fcntl(sock[1], F_GETFL) & ~O_NONBLOCK) != 0)
@@ -2,6 +2,7 @@
 #define _WLC_FD_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 enum wlc_fd_type {
    WLC_FD_INPUT,
@@ -9,9 +10,17 @@ enum wlc_fd_type {
    WLC_FD_LAST
 };
 
+struct wlc_fd_request {
+   const char *path;
+   int flags;
+   enum wlc_fd_type type;
+   int fd; // result, -1 on failure
+};
+
 bool wlc_fd_activate(void);
 bool wlc_fd_deactivate(void);
 int wlc_fd_open(const char *path, const int flags, const enum wlc_fd_type type);
+void wlc_fd_open_many(struct wlc_fd_request *requests, const uint32_t count);
 void wlc_fd_close(const int fd);
 void wlc_fd_terminate(void);
 void wlc_fd_init(const int argc, char *argv[]);
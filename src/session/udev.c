@@ -4,20 +4,67 @@
 
 #include "compositor/compositor.h"
 #include "compositor/output.h"
+#include "trace.h"
 
 #include <stdlib.h>
 #include <assert.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #include <libudev.h>
 #include <libinput.h>
 #include <wayland-server.h>
 
+// With WLC_INPUT_THREAD=1 libinput is dispatched on its own thread, so a blocked compositor
+// loop does not leave events in the kernel queue. Translated events are passed through a
+// single-producer, single-consumer ring and an eventfd wakes the compositor to drain it.
+
+#define QUEUE_SIZE 1024 // events, power of two
+#define PREFETCH_MAX 64 // input devices opened at startup
+
+struct queued_event {
+   struct wlc_input_event ev;
+   double x, y; // absolute motion and touch, normalized
+};
+
 static struct input {
    struct libinput *handle;
    struct wl_event_source *event_source;
+   struct wlc_input_event coalesced; // pending motion or scroll
+   bool pending, coalesce;
+
+   struct {
+      struct queued_event ring[QUEUE_SIZE];
+      uint64_t head, tail, dropped;
+      struct {
+         uint64_t count, total, max; // ns
+      } queued;
+      pthread_t thread;
+      int epoll_fd, wake_fd, stop_fd;
+      bool enabled, running;
+   } thread;
+
+   // VT switches arrive in a signal handler, devices are suspended or resumed from the event loop.
+   struct {
+      struct wl_event_source *source;
+      volatile sig_atomic_t wanted;
+      int fd;
+      bool suspended;
+   } activate;
+
+   // Devices of the seat opened in one batch before libinput asks for them one by one.
+   struct {
+      struct wlc_fd_request requests[PREFETCH_MAX];
+      char paths[PREFETCH_MAX][32];
+      uint32_t count;
+   } prefetch;
 } input;
 
 static struct udev {
@@ -30,7 +77,24 @@ static int
 input_open_restricted(const char *path, int flags, void *user_data)
 {
    (void)user_data;
-   return wlc_fd_open(path, flags, WLC_FD_INPUT);
+
+   for (uint32_t i = 0; i < input.prefetch.count; ++i) {
+      struct wlc_fd_request *request = &input.prefetch.requests[i];
+      if (request->fd < 0 || strcmp(request->path, path) || (request->flags & ~O_CLOEXEC) != (flags & ~O_CLOEXEC))
+         continue;
+
+      const int fd = request->fd;
+      request->fd = -1;
+      return fd;
+   }
+
+   const uint64_t start = wlc_get_time_ns();
+   const int fd = wlc_fd_open(path, flags, WLC_FD_INPUT);
+
+   if (fd >= 0)
+      wlc_log(WLC_LOG_INFO, "Opened %s in %.2f ms", path, (wlc_get_time_ns() - start) / 1e6);
+
+   return fd;
 }
 
 static void
@@ -95,128 +159,416 @@ wlc_touch_type_for_libinput_type(enum libinput_event_type type)
    return WLC_TOUCH_CANCEL;
 }
 
+static void
+flush_coalesced(struct input *input)
+{
+   if (!input->pending)
+      return;
+
+   input->pending = false;
+   wl_signal_emit(&wlc_system_signals()->input, &input->coalesced);
+}
+
+static bool
+coalesce(struct input *input, const struct wlc_input_event *ev)
+{
+   if (!input->pending || input->coalesced.type != ev->type)
+      return false;
+
+   struct wlc_input_event *c = &input->coalesced;
+   if (ev->type == WLC_INPUT_EVENT_MOTION) {
+      c->motion.dx += ev->motion.dx;
+      c->motion.dy += ev->motion.dy;
+   } else if (ev->type == WLC_INPUT_EVENT_SCROLL && c->scroll.axis_bits == ev->scroll.axis_bits) {
+      c->scroll.amount[0] += ev->scroll.amount[0];
+      c->scroll.amount[1] += ev->scroll.amount[1];
+   } else {
+      return false;
+   }
+
+   c->time = ev->time;
+   return true;
+}
+
+static void
+emit(struct input *input, const struct wlc_input_event *ev)
+{
+   // Runs of relative motion or scroll within one dispatch are delivered as one event, with the arrival of the first.
+   // Anything else flushes the run first, so ordering against buttons and keys is kept.
+   if (input->coalesce && coalesce(input, ev))
+      return;
+
+   flush_coalesced(input);
+
+   if (input->coalesce && (ev->type == WLC_INPUT_EVENT_MOTION || ev->type == WLC_INPUT_EVENT_SCROLL)) {
+      memcpy(&input->coalesced, ev, sizeof(struct wlc_input_event));
+      input->pending = true;
+      return;
+   }
+
+   wl_signal_emit(&wlc_system_signals()->input, (void*)ev);
+}
+
+static bool
+translate(struct libinput_event *event, struct wlc_input_event *ev)
+{
+   switch (libinput_event_get_type(event)) {
+      case LIBINPUT_EVENT_DEVICE_ADDED:
+         wlc_log(WLC_LOG_INFO, "INPUT DEVICE ADDED");
+         break;
+
+      case LIBINPUT_EVENT_DEVICE_REMOVED:
+         wlc_log(WLC_LOG_INFO, "INPUT DEVICE REMOVED");
+         break;
+
+      case LIBINPUT_EVENT_POINTER_MOTION:
+         {
+            struct libinput_event_pointer *pev = libinput_event_get_pointer_event(event);
+            ev->type = WLC_INPUT_EVENT_MOTION;
+            ev->time = libinput_event_pointer_get_time(pev);
+            ev->motion.dx = libinput_event_pointer_get_dx(pev);
+            ev->motion.dy = libinput_event_pointer_get_dy(pev);
+            return true;
+         }
+
+      case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+         {
+            struct libinput_event_pointer *pev = libinput_event_get_pointer_event(event);
+            ev->type = WLC_INPUT_EVENT_MOTION_ABSOLUTE;
+            ev->time = libinput_event_pointer_get_time(pev);
+            ev->motion_abs.x = pointer_abs_x;
+            ev->motion_abs.y = pointer_abs_y;
+            ev->motion_abs.internal = pev;
+            return true;
+         }
+
+      case LIBINPUT_EVENT_POINTER_BUTTON:
+         {
+            struct libinput_event_pointer *pev = libinput_event_get_pointer_event(event);
+            ev->type = WLC_INPUT_EVENT_BUTTON;
+            ev->time = libinput_event_pointer_get_time(pev);
+            ev->button.code  = libinput_event_pointer_get_button(pev);
+            ev->button.state = (enum wl_pointer_button_state)libinput_event_pointer_get_button_state(pev);
+            return true;
+         }
+
+      case LIBINPUT_EVENT_POINTER_AXIS:
+         {
+            struct libinput_event_pointer *pev = libinput_event_get_pointer_event(event);
+            ev->type = WLC_INPUT_EVENT_SCROLL;
+            ev->time = libinput_event_pointer_get_time(pev);
+
+            ev->scroll.amount[0] = libinput_event_pointer_get_axis_value(pev, LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL);
+            ev->scroll.amount[1] = libinput_event_pointer_get_axis_value(pev, LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL);
+
+            ev->scroll.axis_bits = 0;
+            if (libinput_event_pointer_has_axis(pev, LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL))
+               ev->scroll.axis_bits |= WLC_SCROLL_AXIS_VERTICAL;
+
+            if (libinput_event_pointer_has_axis(pev, LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL))
+               ev->scroll.axis_bits |= WLC_SCROLL_AXIS_HORIZONTAL;
+
+            // We should get other axis information from libinput as well, like source (finger, wheel) (v0.8)
+            return true;
+         }
+
+      case LIBINPUT_EVENT_KEYBOARD_KEY:
+         {
+            struct libinput_event_keyboard *kev = libinput_event_get_keyboard_event(event);
+            ev->type = WLC_INPUT_EVENT_KEY;
+            ev->time = libinput_event_keyboard_get_time(kev);
+            ev->key.code = libinput_event_keyboard_get_key(kev);
+            ev->key.state = (enum wl_keyboard_key_state)libinput_event_keyboard_get_key_state(kev);
+            return true;
+         }
+
+      case LIBINPUT_EVENT_TOUCH_UP:
+      case LIBINPUT_EVENT_TOUCH_DOWN:
+      case LIBINPUT_EVENT_TOUCH_MOTION:
+      case LIBINPUT_EVENT_TOUCH_FRAME:
+      case LIBINPUT_EVENT_TOUCH_CANCEL:
+         {
+            struct libinput_event_touch *tev = libinput_event_get_touch_event(event);
+            ev->type = WLC_INPUT_EVENT_TOUCH;
+            ev->time = libinput_event_touch_get_time(tev);
+            ev->touch.type = wlc_touch_type_for_libinput_type(libinput_event_get_type(event));
+            ev->touch.x = touch_abs_x;
+            ev->touch.y = touch_abs_y;
+            ev->touch.internal = tev;
+            ev->touch.slot = libinput_event_touch_get_seat_slot(tev);
+            return true;
+         }
+
+      default:
+         break;
+   }
+
+   return false;
+}
+
 static int
 input_event(int fd, uint32_t mask, void *data)
 {
    (void)fd, (void)mask;
    struct input *input = data;
+   const uint64_t arrival = wlc_get_time_ns();
 
    if (libinput_dispatch(input->handle) != 0)
       wlc_log(WLC_LOG_WARN, "Failed to dispatch libinput");
 
    struct libinput_event *event;
    while ((event = libinput_get_event(input->handle))) {
-      struct libinput *handle = libinput_event_get_context(event);
-      (void)handle;
-
-      switch (libinput_event_get_type(event)) {
-         case LIBINPUT_EVENT_DEVICE_ADDED:
-            wlc_log(WLC_LOG_INFO, "INPUT DEVICE ADDED");
-            break;
-
-         case LIBINPUT_EVENT_DEVICE_REMOVED:
-            wlc_log(WLC_LOG_INFO, "INPUT DEVICE REMOVED");
-            break;
-
-         case LIBINPUT_EVENT_POINTER_MOTION:
-            {
-               struct libinput_event_pointer *pev = libinput_event_get_pointer_event(event);
-               struct wlc_input_event ev;
-               ev.type = WLC_INPUT_EVENT_MOTION;
-               ev.time = libinput_event_pointer_get_time(pev);
-               ev.motion.dx = libinput_event_pointer_get_dx(pev);
-               ev.motion.dy = libinput_event_pointer_get_dy(pev);
-               wl_signal_emit(&wlc_system_signals()->input, &ev);
-            }
-            break;
-
-         case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
-            {
-               struct libinput_event_pointer *pev = libinput_event_get_pointer_event(event);
-               struct wlc_input_event ev;
-               ev.type = WLC_INPUT_EVENT_MOTION_ABSOLUTE;
-               ev.time = libinput_event_pointer_get_time(pev);
-               ev.motion_abs.x = pointer_abs_x;
-               ev.motion_abs.y = pointer_abs_y;
-               ev.motion_abs.internal = pev;
-               wl_signal_emit(&wlc_system_signals()->input, &ev);
-            }
-            break;
-
-         case LIBINPUT_EVENT_POINTER_BUTTON:
-            {
-               struct libinput_event_pointer *pev = libinput_event_get_pointer_event(event);
-               struct wlc_input_event ev;
-               ev.type = WLC_INPUT_EVENT_BUTTON;
-               ev.time = libinput_event_pointer_get_time(pev);
-               ev.button.code  = libinput_event_pointer_get_button(pev);
-               ev.button.state = (enum wl_pointer_button_state)libinput_event_pointer_get_button_state(pev);
-               wl_signal_emit(&wlc_system_signals()->input, &ev);
-            }
-            break;
-
-         case LIBINPUT_EVENT_POINTER_AXIS:
-            {
-               struct libinput_event_pointer *pev = libinput_event_get_pointer_event(event);
-               struct wlc_input_event ev;
-               ev.type = WLC_INPUT_EVENT_SCROLL;
-               ev.time = libinput_event_pointer_get_time(pev);
-
-               ev.scroll.amount[0] = libinput_event_pointer_get_axis_value(pev, LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL);
-               ev.scroll.amount[1] = libinput_event_pointer_get_axis_value(pev, LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL);
-
-               ev.scroll.axis_bits = 0;
-               if (libinput_event_pointer_has_axis(pev, LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL))
-                  ev.scroll.axis_bits |= WLC_SCROLL_AXIS_VERTICAL;
-
-               if (libinput_event_pointer_has_axis(pev, LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL))
-                  ev.scroll.axis_bits |= WLC_SCROLL_AXIS_HORIZONTAL;
-
-               // We should get other axis information from libinput as well, like source (finger, wheel) (v0.8)
-               wl_signal_emit(&wlc_system_signals()->input, &ev);
-            }
-            break;
-
-         case LIBINPUT_EVENT_KEYBOARD_KEY:
-            {
-               struct libinput_event_keyboard *kev = libinput_event_get_keyboard_event(event);
-               struct wlc_input_event ev;
-               ev.type = WLC_INPUT_EVENT_KEY;
-               ev.time = libinput_event_keyboard_get_time(kev);
-               ev.key.code = libinput_event_keyboard_get_key(kev);
-               ev.key.state = (enum wl_keyboard_key_state)libinput_event_keyboard_get_key_state(kev);
-               wl_signal_emit(&wlc_system_signals()->input, &ev);
-            }
-            break;
-
-         case LIBINPUT_EVENT_TOUCH_UP:
-         case LIBINPUT_EVENT_TOUCH_DOWN:
-         case LIBINPUT_EVENT_TOUCH_MOTION:
-         case LIBINPUT_EVENT_TOUCH_FRAME:
-         case LIBINPUT_EVENT_TOUCH_CANCEL:
-            {
-               struct libinput_event_touch *tev = libinput_event_get_touch_event(event);
-               struct wlc_input_event ev;
-               ev.type = WLC_INPUT_EVENT_TOUCH;
-               ev.time = libinput_event_touch_get_time(tev);
-               ev.touch.type = wlc_touch_type_for_libinput_type(libinput_event_get_type(event));
-               ev.touch.x = touch_abs_x;
-               ev.touch.y = touch_abs_y;
-               ev.touch.slot = libinput_event_touch_get_seat_slot(tev);
-               wl_signal_emit(&wlc_system_signals()->input, &ev);
-            }
-            break;
-
-         default:
-            break;
+      struct wlc_input_event ev;
+      if (translate(event, &ev)) {
+         ev.arrival = arrival;
+         emit(input, &ev);
       }
 
       libinput_event_destroy(event);
    }
 
+   flush_coalesced(input);
    return 0;
 }
 
+static double
+queued_x(void *internal, uint32_t width)
+{
+   return ((struct queued_event*)internal)->x * width;
+}
+
+static double
+queued_y(void *internal, uint32_t height)
+{
+   return ((struct queued_event*)internal)->y * height;
+}
+
+static bool
+queue_push(struct input *input, struct libinput_event *event, const struct wlc_input_event *ev)
+{
+   // Single producer, head is only written by the input thread
+   const uint64_t head = __atomic_load_n(&input->thread.head, __ATOMIC_RELAXED);
+   if (head - __atomic_load_n(&input->thread.tail, __ATOMIC_ACQUIRE) >= QUEUE_SIZE) {
+      __atomic_add_fetch(&input->thread.dropped, 1, __ATOMIC_RELAXED);
+      return false;
+   }
+
+   struct queued_event *q = &input->thread.ring[head & (QUEUE_SIZE - 1)];
+   memcpy(&q->ev, ev, sizeof(struct wlc_input_event));
+   q->x = q->y = 0;
+
+   // The libinput event is gone by the time the compositor reads this, resolve coordinates here
+   const enum libinput_event_type type = libinput_event_get_type(event);
+   if (type == LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE) {
+      struct libinput_event_pointer *pev = libinput_event_get_pointer_event(event);
+      q->x = libinput_event_pointer_get_absolute_x_transformed(pev, 1);
+      q->y = libinput_event_pointer_get_absolute_y_transformed(pev, 1);
+   } else if (type == LIBINPUT_EVENT_TOUCH_DOWN || type == LIBINPUT_EVENT_TOUCH_MOTION) {
+      struct libinput_event_touch *tev = libinput_event_get_touch_event(event);
+      q->x = libinput_event_touch_get_x_transformed(tev, 1);
+      q->y = libinput_event_touch_get_y_transformed(tev, 1);
+   }
+
+   __atomic_store_n(&input->thread.head, head + 1, __ATOMIC_RELEASE);
+   return true;
+}
+
+static bool
+queue_pop(struct input *input, struct queued_event *out_event)
+{
+   // Single consumer, tail is only written by the compositor thread
+   const uint64_t tail = __atomic_load_n(&input->thread.tail, __ATOMIC_RELAXED);
+   if (tail == __atomic_load_n(&input->thread.head, __ATOMIC_ACQUIRE))
+      return false;
+
+   memcpy(out_event, &input->thread.ring[tail & (QUEUE_SIZE - 1)], sizeof(struct queued_event));
+   __atomic_store_n(&input->thread.tail, tail + 1, __ATOMIC_RELEASE);
+   return true;
+}
+
+static void
+queue_drain(struct input *input)
+{
+   const uint64_t now = wlc_get_time_ns();
+
+   struct queued_event q;
+   while (queue_pop(input, &q)) {
+      const uint64_t queued = (now > q.ev.arrival ? now - q.ev.arrival : 0);
+      input->thread.queued.count++;
+      input->thread.queued.total += queued;
+      if (queued > input->thread.queued.max)
+         input->thread.queued.max = queued;
+
+      WLC_TRACE(WLC_TRACE_INPUT_QUEUED, input, queued / 1000);
+
+      if (q.ev.type == WLC_INPUT_EVENT_MOTION_ABSOLUTE) {
+         q.ev.motion_abs.x = queued_x;
+         q.ev.motion_abs.y = queued_y;
+         q.ev.motion_abs.internal = &q;
+      } else if (q.ev.type == WLC_INPUT_EVENT_TOUCH) {
+         q.ev.touch.x = queued_x;
+         q.ev.touch.y = queued_y;
+         q.ev.touch.internal = &q;
+      }
+
+      emit(input, &q.ev);
+   }
+
+   flush_coalesced(input);
+
+   uint64_t dropped;
+   if ((dropped = __atomic_exchange_n(&input->thread.dropped, 0, __ATOMIC_RELAXED)) > 0)
+      wlc_log(WLC_LOG_WARN, "Input queue full, dropped %llu events", (unsigned long long)dropped);
+}
+
+static int
+queue_event(int fd, uint32_t mask, void *data)
+{
+   (void)mask;
+   struct input *input = data;
+
+   uint64_t count;
+   if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+      wlc_log(WLC_LOG_WARN, "Failed to read input queue eventfd: %m");
+
+   queue_drain(input);
+   return 0;
+}
+
+static void
+thread_dispatch(struct input *input)
+{
+   // Taken before dispatch, so the queued time includes translating the batch
+   const uint64_t arrival = wlc_get_time_ns();
+
+   if (libinput_dispatch(input->handle) != 0)
+      wlc_log(WLC_LOG_WARN, "Failed to dispatch libinput");
+
+   bool queued = false;
+   struct libinput_event *event;
+   while ((event = libinput_get_event(input->handle))) {
+      struct wlc_input_event ev;
+      if (translate(event, &ev)) {
+         ev.arrival = arrival;
+         queued |= queue_push(input, event, &ev);
+      }
+
+      libinput_event_destroy(event);
+   }
+
+   const uint64_t count = 1;
+   if (queued && write(input->thread.wake_fd, &count, sizeof(count)) != sizeof(count))
+      wlc_log(WLC_LOG_WARN, "Failed to wake compositor for input: %m");
+}
+
+static void*
+thread_main(void *data)
+{
+   struct input *input = data;
+
+   // Events libinput read before the thread started do not make the fd readable again
+   thread_dispatch(input);
+
+   for (;;) {
+      struct epoll_event events[2];
+      const int n = epoll_wait(input->thread.epoll_fd, events, 2, -1);
+
+      if (n < 0 && errno == EINTR)
+         continue;
+
+      if (n < 0) {
+         wlc_log(WLC_LOG_ERROR, "Input thread epoll_wait failed: %m");
+         break;
+      }
+
+      for (int i = 0; i < n; ++i) {
+         if (events[i].data.fd == input->thread.stop_fd)
+            return NULL;
+      }
+
+      thread_dispatch(input);
+   }
+
+   return NULL;
+}
+
+static void
+thread_close_fds(struct input *input)
+{
+   int *fds[] = { &input->thread.epoll_fd, &input->thread.wake_fd, &input->thread.stop_fd };
+   for (unsigned int i = 0; i < sizeof(fds) / sizeof(fds[0]); ++i) {
+      if (*fds[i] >= 0)
+         close(*fds[i]);
+
+      *fds[i] = -1;
+   }
+}
+
+static void
+thread_stop(struct input *input)
+{
+   if (!input->thread.running)
+      return;
+
+   const uint64_t count = 1;
+   if (write(input->thread.stop_fd, &count, sizeof(count)) == sizeof(count))
+      pthread_join(input->thread.thread, NULL);
+
+   input->thread.running = false;
+   thread_close_fds(input);
+
+   // Deliver what was already read, key releases before a VT switch matter
+   queue_drain(input);
+
+   if (input->thread.queued.count > 0) {
+      wlc_log(WLC_LOG_INFO, "Input thread: %llu events, queued avg %.3f ms, max %.3f ms",
+              (unsigned long long)input->thread.queued.count,
+              input->thread.queued.total / (double)input->thread.queued.count / 1e6,
+              input->thread.queued.max / 1e6);
+   }
+
+   memset(&input->thread.queued, 0, sizeof(input->thread.queued));
+}
+
+static bool
+thread_start(struct input *input)
+{
+   input->thread.head = input->thread.tail = input->thread.dropped = 0;
+   input->thread.epoll_fd = input->thread.wake_fd = input->thread.stop_fd = -1;
+
+   if ((input->thread.epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0 ||
+       (input->thread.wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0 ||
+       (input->thread.stop_fd = eventfd(0, EFD_CLOEXEC)) < 0)
+      goto fail;
+
+   struct epoll_event ev = { .events = EPOLLIN };
+   ev.data.fd = libinput_get_fd(input->handle);
+   if (epoll_ctl(input->thread.epoll_fd, EPOLL_CTL_ADD, ev.data.fd, &ev) != 0)
+      goto fail;
+
+   ev.data.fd = input->thread.stop_fd;
+   if (epoll_ctl(input->thread.epoll_fd, EPOLL_CTL_ADD, ev.data.fd, &ev) != 0)
+      goto fail;
+
+   // Signals are handled by the compositor thread
+   sigset_t all, old;
+   sigfillset(&all);
+   pthread_sigmask(SIG_SETMASK, &all, &old);
+   const int ret = pthread_create(&input->thread.thread, NULL, thread_main, input);
+   pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+   if (ret != 0)
+      goto fail;
+
+   input->thread.running = true;
+   return true;
+
+fail:
+   wlc_log(WLC_LOG_WARN, "Failed to start input thread, dispatching libinput on the compositor thread");
+   thread_close_fds(input);
+   return false;
+}
+
 static bool
 input_set_event_loop(struct wl_event_loop *loop)
 {
@@ -225,7 +577,17 @@ input_set_event_loop(struct wl_event_loop *loop)
       input.event_source = NULL;
    }
 
+   thread_stop(&input);
+
    if (input.handle && loop) {
+      if (input.thread.enabled && thread_start(&input)) {
+         if ((input.event_source = wl_event_loop_add_fd(loop, input.thread.wake_fd, WL_EVENT_READABLE, queue_event, &input)))
+            return true;
+
+         thread_stop(&input);
+         return false;
+      }
+
       if (!(input.event_source = wl_event_loop_add_fd(loop, libinput_get_fd(input.handle), WL_EVENT_READABLE, input_event, &input)))
          return false;
 
@@ -304,18 +666,51 @@ udev_set_event_loop(struct wl_event_loop *loop)
    return true;
 }
 
+static int
+cb_activate(int fd, uint32_t mask, void *data)
+{
+   (void)mask, (void)data;
+
+   uint64_t count;
+   if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+      wlc_log(WLC_LOG_WARN, "Failed to read input activate eventfd: %m");
+
+   const bool suspend = !input.activate.wanted;
+   if (!input.handle || suspend == input.activate.suspended)
+      return 0;
+
+   // libinput is not thread safe, park the input thread while devices are closed or reopened
+   const bool threaded = input.thread.running;
+   if (threaded)
+      input_set_event_loop(NULL);
+
+   if (suspend) {
+      libinput_suspend(input.handle);
+   } else {
+      libinput_resume(input.handle);
+   }
+
+   input.activate.suspended = suspend;
+
+   if (threaded)
+      input_set_event_loop(wlc_event_loop());
+
+   return 0;
+}
+
 static void
 activated(struct wl_listener *listener, void *data)
 {
    (void)listener;
-   bool activated = *(bool*)data;
 
-   if (input.handle) {
-      if (!activated) {
-         libinput_suspend(input.handle);
-      } else {
-         libinput_resume(input.handle);
-      }
+   // Runs in the VT signal handler, the main loop may be draining the input queue.
+   // Only note the state here and let cb_activate do the work.
+   input.activate.wanted = *(bool*)data;
+
+   const uint64_t count = 1;
+   if (input.activate.source) {
+      const ssize_t ret = write(input.activate.fd, &count, sizeof(count));
+      (void)ret;
    }
 }
 
@@ -330,6 +725,70 @@ cb_input_log_handler(struct libinput *input, enum libinput_log_priority priority
    wlc_vlog(WLC_LOG_INFO, format, args);
 }
 
+static void
+prefetch_devices(const char *seat)
+{
+   struct udev_enumerate *enumerate;
+   if (!(enumerate = udev_enumerate_new(udev.handle)))
+      return;
+
+   udev_enumerate_add_match_subsystem(enumerate, "input");
+   udev_enumerate_add_match_sysname(enumerate, "event[0-9]*");
+   udev_enumerate_scan_devices(enumerate);
+
+   struct udev_list_entry *entry;
+   udev_list_entry_foreach(entry, udev_enumerate_get_list_entry(enumerate)) {
+      if (input.prefetch.count >= PREFETCH_MAX)
+         break;
+
+      struct udev_device *device;
+      if (!(device = udev_device_new_from_syspath(udev.handle, udev_list_entry_get_name(entry))))
+         continue;
+
+      const char *node = udev_device_get_devnode(device);
+      const char *device_seat = udev_device_get_property_value(device, "ID_SEAT");
+
+      if (node && strlen(node) < sizeof(input.prefetch.paths[0]) && !strcmp((device_seat ? device_seat : "seat0"), seat)) {
+         const uint32_t i = input.prefetch.count++;
+         strcpy(input.prefetch.paths[i], node);
+         input.prefetch.requests[i] = (struct wlc_fd_request){
+            .path = input.prefetch.paths[i],
+            .flags = O_RDWR | O_NONBLOCK | O_CLOEXEC,
+            .type = WLC_FD_INPUT,
+            .fd = -1,
+         };
+      }
+
+      udev_device_unref(device);
+   }
+
+   udev_enumerate_unref(enumerate);
+
+   if (!input.prefetch.count)
+      return;
+
+   const uint64_t start = wlc_get_time_ns();
+   wlc_fd_open_many(input.prefetch.requests, input.prefetch.count);
+
+   uint32_t opened = 0;
+   for (uint32_t i = 0; i < input.prefetch.count; ++i)
+      opened += (input.prefetch.requests[i].fd >= 0);
+
+   wlc_log(WLC_LOG_INFO, "Opened %u input devices in %.2f ms", opened, (wlc_get_time_ns() - start) / 1e6);
+}
+
+static void
+prefetch_release(void)
+{
+   // devices libinput did not want (not a keyboard, pointer or touch device)
+   for (uint32_t i = 0; i < input.prefetch.count; ++i) {
+      if (input.prefetch.requests[i].fd >= 0)
+         wlc_fd_close(input.prefetch.requests[i].fd);
+   }
+
+   input.prefetch.count = 0;
+}
+
 bool
 wlc_input_has_init(void)
 {
@@ -339,6 +798,11 @@ wlc_input_has_init(void)
 void
 wlc_input_terminate(void)
 {
+   if (input.activate.source) {
+      wl_event_source_remove(input.activate.source);
+      close(input.activate.fd);
+   }
+
    input_set_event_loop(NULL);
 
    if (input.handle)
@@ -361,13 +825,37 @@ wlc_input_init(void)
    }
 
    const char *xdg_seat = getenv("XDG_SEAT");
-   if (libinput_udev_assign_seat(input.handle, (xdg_seat ? xdg_seat : "seat0")) != 0) {
+   prefetch_devices((xdg_seat ? xdg_seat : "seat0"));
+
+   const int assigned = libinput_udev_assign_seat(input.handle, (xdg_seat ? xdg_seat : "seat0"));
+   prefetch_release();
+
+   if (assigned != 0) {
       wlc_log(WLC_LOG_WARN, "Failed to assign seat to libinput");
       return false;
    }
 
+   // WLC_INPUT_COALESCE=0 delivers every libinput event, for clients that want raw rates
+   const char *coalesce = getenv("WLC_INPUT_COALESCE");
+   input.coalesce = !(coalesce && !strcmp(coalesce, "0"));
+
+   const char *thread = getenv("WLC_INPUT_THREAD");
+   input.thread.enabled = (thread && !strcmp(thread, "1"));
+
    libinput_log_set_handler(input.handle, &cb_input_log_handler);
    libinput_log_set_priority(input.handle, LIBINPUT_LOG_PRIORITY_ERROR);
+
+   input.activate.wanted = true;
+   if ((input.activate.fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0 ||
+       !(input.activate.source = wl_event_loop_add_fd(wlc_event_loop(), input.activate.fd, WL_EVENT_READABLE, cb_activate, NULL))) {
+      wlc_log(WLC_LOG_WARN, "Failed to create input activate eventfd");
+
+      if (input.activate.fd >= 0)
+         close(input.activate.fd);
+
+      return false;
+   }
+
    return input_set_event_loop(wlc_event_loop());
 }
 
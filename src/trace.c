@@ -0,0 +1,221 @@
+#include "internal.h"
+#include "visibility.h"
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <wayland-server.h>
+
+// Records are written to a ring owned by the recording thread.
+// Export may run on any thread, records overwritten while copying are dropped.
+//
+// Enable with WLC_TRACE=path/to/trace.json, the trace is written on terminate,
+// on SIGRTMIN (kill -s RTMIN <pid>) and with wlc_trace_export.
+// Open the file in chrome://tracing or ui.perfetto.dev.
+
+#define RING_SIZE (1 << 16) // records per thread, power of two
+
+struct record {
+   uint64_t time; // CLOCK_MONOTONIC, ns
+   uintptr_t object;
+   uint32_t event, arg;
+};
+
+struct ring {
+   struct record records[RING_SIZE];
+   uint64_t head;
+   pid_t tid;
+   struct ring *next;
+};
+
+static const struct {
+   const char *name, *phase;
+} events[WLC_TRACE_LAST] = {
+   { "commit", "i" },
+   { "attach", "i" },
+   { "repaint", "B" },
+   { "repaint", "E" },
+   { "swap", "i" },
+   { "flip", "i" },
+   { "input", "i" },
+   { "deliver", "i" },
+   { "input queued us", "C" },
+   { "input dispatch us", "C" },
+   { "input present us", "C" },
+   { "dispatch", "B" },
+   { "dispatch", "E" },
+   { "client resources", "C" },
+   { "client gpu kib", "C" },
+   { "xwm round trips", "C" },
+};
+
+bool wlc_trace_active;
+
+static __thread struct ring *ring;
+
+static struct {
+   struct ring *rings; // lock-free list, rings are only freed on terminate
+   struct wl_event_source *signal;
+   const char *path;
+} trace;
+
+static struct ring*
+ring_new(void)
+{
+   struct ring *r;
+   if (!(r = calloc(1, sizeof(struct ring))))
+      return NULL;
+
+   r->tid = syscall(SYS_gettid);
+   r->next = __atomic_load_n(&trace.rings, __ATOMIC_RELAXED);
+   while (!__atomic_compare_exchange_n(&trace.rings, &r->next, r, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+   return r;
+}
+
+void
+wlc_trace_record(enum wlc_trace_event event, uintptr_t object, uint32_t arg)
+{
+   struct ring *r;
+   if (!(r = ring) && !(r = ring = ring_new()))
+      return;
+
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   const uint64_t head = r->head;
+   struct record *record = &r->records[head & (RING_SIZE - 1)];
+   record->time = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+   record->object = object;
+   record->event = event;
+   record->arg = arg;
+   __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+}
+
+static void
+write_ring(FILE *out, struct ring *r, struct record *copy, bool *first)
+{
+   const uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+   const uint64_t tail = (head > RING_SIZE ? head - RING_SIZE : 0);
+
+   for (uint64_t i = tail; i < head; ++i)
+      copy[i - tail] = r->records[i & (RING_SIZE - 1)];
+
+   // Skip whatever the owner overwrote while we were copying
+   const uint64_t now = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+   const uint64_t valid = (now > RING_SIZE ? now - RING_SIZE : 0);
+
+   const pid_t pid = getpid();
+   for (uint64_t i = (valid > tail ? valid : tail); i < head; ++i) {
+      const struct record *record = &copy[i - tail];
+      if (record->event >= WLC_TRACE_LAST)
+         continue;
+
+      fprintf(out, "%s\n{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%" PRIu64 ".%03" PRIu64 ",\"pid\":%d,\"tid\":%d,",
+              (*first ? "" : ","), events[record->event].name, events[record->event].phase,
+              record->time / 1000, record->time % 1000, pid, r->tid);
+
+      if (*events[record->event].phase == 'C') {
+         // Counter track per object
+         fprintf(out, "\"id\":\"0x%" PRIxPTR "\",\"args\":{\"value\":%" PRIu32 "}}", record->object, record->arg);
+      } else {
+         if (*events[record->event].phase == 'i')
+            fprintf(out, "\"s\":\"t\",");
+
+         fprintf(out, "\"args\":{\"object\":\"0x%" PRIxPTR "\",\"arg\":%" PRIu32 "}}", record->object, record->arg);
+      }
+      *first = false;
+   }
+}
+
+WLC_API bool
+wlc_trace_export(const char *path)
+{
+   if (!path && !(path = trace.path))
+      return false;
+
+   FILE *out;
+   if (!(out = fopen(path, "w")))
+      goto fail;
+
+   struct record *copy;
+   if (!(copy = malloc(sizeof(struct record) * RING_SIZE)))
+      goto copy_fail;
+
+   bool first = true;
+   fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+   for (struct ring *r = __atomic_load_n(&trace.rings, __ATOMIC_ACQUIRE); r; r = r->next)
+      write_ring(out, r, copy, &first);
+   fprintf(out, "\n]}\n");
+
+   free(copy);
+
+   if (fclose(out) != 0)
+      goto fail;
+
+   wlc_log(WLC_LOG_INFO, "Wrote trace to %s", path);
+   return true;
+
+copy_fail:
+   fclose(out);
+fail:
+   wlc_log(WLC_LOG_WARN, "Failed to write trace to %s", path);
+   return false;
+}
+
+static int
+cb_signal(int signal, void *data)
+{
+   (void)signal, (void)data;
+   wlc_trace_export(NULL);
+   return 1;
+}
+
+void
+wlc_trace_terminate(void)
+{
+   if (!trace.path)
+      return;
+
+   __atomic_store_n(&wlc_trace_active, false, __ATOMIC_RELAXED);
+   wlc_trace_export(NULL);
+
+   if (trace.signal)
+      wl_event_source_remove(trace.signal);
+
+   // Called after the input and log threads are joined, their rings are freed with ours
+   for (struct ring *r = trace.rings, *rn; r; r = rn) {
+      rn = r->next;
+      free(r);
+   }
+
+   memset(&trace, 0, sizeof(trace));
+   ring = NULL;
+}
+
+bool
+wlc_trace_init(void)
+{
+   const char *path;
+   if (!(path = getenv("WLC_TRACE")) || !*path)
+      return true;
+
+#ifndef WLC_TRACEPOINTS
+   wlc_log(WLC_LOG_WARN, "WLC_TRACE is set, but wlc was built without tracepoints");
+   return true;
+#endif
+
+   trace.path = path;
+
+   if (!(trace.signal = wl_event_loop_add_signal(wlc_event_loop(), SIGRTMIN, cb_signal, NULL)))
+      wlc_log(WLC_LOG_WARN, "Failed to add trace signal, trace is only written on terminate");
+
+   __atomic_store_n(&wlc_trace_active, true, __ATOMIC_RELAXED);
+   wlc_log(WLC_LOG_INFO, "Tracing to %s", path);
+   return true;
+}
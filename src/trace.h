@@ -0,0 +1,44 @@
+#ifndef _WLC_TRACE_H_
+#define _WLC_TRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+enum wlc_trace_event {
+   WLC_TRACE_COMMIT,
+   WLC_TRACE_ATTACH,
+   WLC_TRACE_REPAINT_BEGIN,
+   WLC_TRACE_REPAINT_END,
+   WLC_TRACE_SWAP,
+   WLC_TRACE_FLIP,
+   WLC_TRACE_INPUT_RECEIVED,
+   WLC_TRACE_INPUT_DELIVERED,
+   WLC_TRACE_INPUT_QUEUED,
+   WLC_TRACE_INPUT_DISPATCH_LATENCY,
+   WLC_TRACE_INPUT_PRESENT_LATENCY,
+   WLC_TRACE_DISPATCH_BEGIN,
+   WLC_TRACE_DISPATCH_END,
+   WLC_TRACE_CLIENT_RESOURCES,
+   WLC_TRACE_CLIENT_GPU,
+   WLC_TRACE_XWM_ROUND_TRIPS,
+   WLC_TRACE_LAST,
+};
+
+#ifdef WLC_TRACEPOINTS
+
+extern bool wlc_trace_active;
+void wlc_trace_record(enum wlc_trace_event event, uintptr_t object, uint32_t arg);
+
+// Costs one predicted branch when recording is off
+#  define WLC_TRACE(event, object, arg) do { if (__builtin_expect(__atomic_load_n(&wlc_trace_active, __ATOMIC_RELAXED), false)) wlc_trace_record(event, (uintptr_t)(object), (arg)); } while (0)
+
+#else
+
+#  define WLC_TRACE(event, object, arg) do { (void)(object); (void)(arg); } while (0)
+
+#endif /* WLC_TRACEPOINTS */
+
+bool wlc_trace_init(void);
+void wlc_trace_terminate(void);
+
+#endif /* _WLC_TRACE_H_ */
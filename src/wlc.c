@@ -1,18 +1,24 @@
 #include "internal.h"
 #include "visibility.h"
+#include "trace.h"
+#include "capture.h"
+#include "log.h"
 
 #include "session/tty.h"
 #include "session/fd.h"
 #include "session/udev.h"
 
+#include "compositor/seat/keymap.h"
+
 #include "xwayland/xwayland.h"
 
 #include <stdlib.h>
 #include <string.h>
+#include <assert.h>
 #include <unistd.h>
 #include <signal.h>
+#include <poll.h>
 #include <sys/wait.h>
-#include <sys/time.h>
 
 #if defined(__linux__)
 #  include <linux/version.h>
@@ -37,8 +43,13 @@ static struct {
    struct wlc_system_signals signals;
    struct wl_display *display;
    struct wl_event_source *terminate_timer;
-   FILE *log_file;
-   int cached_tm_mday;
+
+   struct {
+      struct wlc_startup_profile profile;
+      uint64_t begin, last; // ns
+      bool finished;
+   } startup;
+
    bool active;
    bool init;
 } wlc;
@@ -50,6 +61,8 @@ backtrace(int signal)
 {
    (void)signal;
 
+   wlc_log_sync();
+
    if (clearenv() != 0)
       exit(EXIT_FAILURE);
 
@@ -126,42 +139,6 @@ fpesetup(struct sigaction *action)
 
 #endif /* NDEBUG */
 
-static inline void
-wlc_log_timestamp(FILE *out)
-{
-   struct timeval tv;
-   struct tm *brokendown_time;
-   gettimeofday(&tv, NULL);
-
-   if (!(brokendown_time = localtime(&tv.tv_sec))) {
-      fprintf(out, "[(NULL)localtime] ");
-      return;
-   }
-
-   char string[128];
-   if (brokendown_time->tm_mday != wlc.cached_tm_mday) {
-      strftime(string, sizeof(string), "%Y-%m-%d %Z", brokendown_time);
-      fprintf(out, "Date: %s\n", string);
-      wlc.cached_tm_mday = brokendown_time->tm_mday;
-   }
-
-   strftime(string, sizeof(string), "%H:%M:%S", brokendown_time);
-   fprintf(out, "[%s.%03li] ", string, tv.tv_usec / 1000);
-}
-
-static inline void
-wl_cb_log(const char *fmt, va_list args)
-{
-   FILE *out = wlc_get_log_file();
-
-   if (out != stderr && out != stdout)
-      wlc_log_timestamp(out);
-
-   fprintf(out, "libwayland: ");
-   vfprintf(out, fmt, args);
-   fflush(out);
-}
-
 void
 wlc_dlog(enum wlc_debug dbg, const char *fmt, ...)
 {
@@ -201,6 +178,57 @@ wlc_get_time(struct timespec *out_ts)
    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
+uint64_t
+wlc_get_time_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void
+wlc_startup_phase(enum wlc_startup_phase phase, uint64_t begin)
+{
+   assert(phase < WLC_STARTUP_LAST);
+
+   // outputs recreated after startup (hotplug, resume) are not startup
+   if (wlc.startup.finished)
+      return;
+
+   wlc.startup.last = wlc_get_time_ns();
+   wlc.startup.profile.phase[phase] += (wlc.startup.last - begin) / 1000;
+}
+
+void
+wlc_startup_finish(void)
+{
+   if (wlc.startup.finished || !wlc.startup.begin)
+      return;
+
+   const uint64_t now = wlc_get_time_ns();
+   wlc.startup.profile.phase[WLC_STARTUP_FIRST_FRAME] = (now - wlc.startup.last) / 1000;
+   wlc.startup.profile.total = (now - wlc.startup.begin) / 1000;
+   wlc.startup.finished = true;
+
+   static const char *names[WLC_STARTUP_LAST] = {
+      "tty", "fd", "display", "udev", "input", "xwayland", "backend", "context", "render", "first frame"
+   };
+
+   char buf[256];
+   size_t len = 0;
+   for (uint32_t i = 0; i < WLC_STARTUP_LAST && len < sizeof(buf); ++i)
+      len += snprintf(buf + len, sizeof(buf) - len, "%s%s %.1f", (i > 0 ? ", " : ""), names[i], wlc.startup.profile.phase[i] / 1e3);
+
+   wlc_log(WLC_LOG_INFO, "Startup took %.1f ms (%s)", wlc.startup.profile.total / 1e3, buf);
+}
+
+WLC_API void
+wlc_get_startup_profile(struct wlc_startup_profile *out_profile)
+{
+   assert(out_profile);
+   memcpy(out_profile, &wlc.startup.profile, sizeof(struct wlc_startup_profile));
+}
+
 void
 wlc_set_active(bool active)
 {
@@ -250,6 +278,8 @@ wlc_cleanup(void)
 
    if (wlc.display) {
       // fd process never allocates display
+      wlc_capture_terminate();
+      wlc_keymap_cache_release();
       wlc_xwayland_terminate();
       wlc_input_terminate();
       wlc_udev_terminate();
@@ -264,6 +294,10 @@ wlc_cleanup(void)
       wl_display_terminate(wlc.display);
 
    wlc.display = NULL;
+   wlc_log_terminate();
+
+   // Last, the input and log threads record into their own trace rings until joined above
+   wlc_trace_terminate();
 }
 
 static int
@@ -274,61 +308,43 @@ cb_terminate_timer(void *data)
    return 0;
 }
 
-WLC_API void
-wlc_vlog(const enum wlc_log_type type, const char *fmt, va_list args)
-{
-   FILE *out = wlc_get_log_file();
-
-   if (out == stderr || out == stdout) {
-      fprintf(out, "wlc: ");
-   } else {
-      wlc_log_timestamp(out);
-   }
-
-   switch (type) {
-      case WLC_LOG_WARN:
-         fprintf(out, "(WARN) ");
-         break;
-      case WLC_LOG_ERROR:
-         fprintf(out, "(ERROR) ");
-         break;
-      default:
-         break;
-   }
-
-   vfprintf(out, fmt, args);
-   fprintf(out, "\n");
-   fflush(out);
-}
-
-WLC_API void
-wlc_log(const enum wlc_log_type type, const char *fmt, ...)
+WLC_API struct wlc_event_source*
+wlc_event_loop_add_timer(int (*cb)(void *userdata), void *userdata)
 {
-   va_list argp;
-   va_start(argp, fmt);
-   wlc_vlog(type, fmt, argp);
-   va_end(argp);
+   assert(cb);
+   return (struct wlc_event_source*)wl_event_loop_add_timer(wlc_event_loop(), cb, userdata);
 }
 
-WLC_API FILE*
-wlc_get_log_file(void)
+WLC_API bool
+wlc_event_source_timer_update(struct wlc_event_source *source, int32_t ms_delay)
 {
-   return (wlc.log_file ? wlc.log_file : stderr);
+   assert(source);
+   return (wl_event_source_timer_update((struct wl_event_source*)source, ms_delay) == 0);
 }
 
 WLC_API void
-wlc_set_log_file(FILE *out)
+wlc_event_source_remove(struct wlc_event_source *source)
 {
-   if (wlc.log_file && wlc.log_file != stdout && wlc.log_file != stderr)
-      fclose(wlc.log_file);
-
-   wlc.log_file = out;
+   assert(source);
+   wl_event_source_remove((struct wl_event_source*)source);
 }
 
 WLC_API void
 wlc_run(void)
 {
-   wl_display_run(wlc.display);
+   // Same as wl_display_run, but waits separately so the trace only covers dispatch
+   struct wl_event_loop *loop = wlc_event_loop();
+   struct pollfd pfd = { .fd = wl_event_loop_get_fd(loop), .events = POLLIN };
+
+   while (wlc.display) {
+      wl_display_flush_clients(wlc.display);
+      wl_event_loop_dispatch_idle(loop);
+      poll(&pfd, 1, -1);
+
+      WLC_TRACE(WLC_TRACE_DISPATCH_BEGIN, NULL, 0);
+      wl_event_loop_dispatch(loop, 0);
+      WLC_TRACE(WLC_TRACE_DISPATCH_END, NULL, 0);
+   }
 }
 
 WLC_API void
@@ -350,8 +366,9 @@ wlc_init(const struct wlc_interface *interface, const int argc, char *argv[])
       return true;
 
    memset(&wlc, 0, sizeof(wlc));
+   wlc.startup.begin = wlc.startup.last = wlc_get_time_ns();
 
-   wl_log_set_handler_server(wl_cb_log);
+   wl_log_set_handler_server(wlc_log_wayland);
 
    for (int i = 1; i < argc; ++i) {
       if (!strcmp(argv[i], "--log")) {
@@ -363,12 +380,14 @@ wlc_init(const struct wlc_interface *interface, const int argc, char *argv[])
 
    unsetenv("TERM");
    const char *display = getenv("DISPLAY");
+   const char *headless = getenv("WLC_HEADLESS");
+   const bool is_headless = (headless && !strcmp(headless, "1"));
 
    if (getuid() != geteuid() || getgid() != getegid()) {
       wlc_log(WLC_LOG_INFO, "Doing work on SUID/SGID side and dropping permissions");
    } else if (getuid() == 0) {
       die("Do not run wlc compositor as root");
-   } else if (!display && access("/dev/input/event0", R_OK | W_OK) != 0) {
+   } else if (!display && !is_headless && access("/dev/input/event0", R_OK | W_OK) != 0) {
       die("Not running from X11 and no access to /dev/input/event0");
    }
 
@@ -389,16 +408,23 @@ wlc_init(const struct wlc_interface *interface, const int argc, char *argv[])
    }
 #endif
 
-   if (!display)
+   uint64_t begin = wlc_get_time_ns();
+   if (!display && !is_headless) {
       wlc_tty_init();
+      wlc_startup_phase(WLC_STARTUP_TTY, begin);
+   }
 
    // -- we open tty before dropping permissions
    //    so the fd process can also handle cleanup in case of crash
 
+   begin = wlc_get_time_ns();
    wlc_fd_init(argc, argv);
+   wlc_startup_phase(WLC_STARTUP_FD, begin);
 
    // -- permissions are now dropped
 
+   wlc_log_init();
+
    wl_signal_init(&wlc.signals.terminated);
    wl_signal_init(&wlc.signals.activated);
    wl_signal_init(&wlc.signals.surface);
@@ -406,6 +432,7 @@ wlc_init(const struct wlc_interface *interface, const int argc, char *argv[])
    wl_signal_init(&wlc.signals.output);
    wl_signal_init(&wlc.signals.xwayland);
 
+   begin = wlc_get_time_ns();
    if (!(wlc.display = wl_display_create()))
       die("Failed to create wayland display");
 
@@ -419,19 +446,37 @@ wlc_init(const struct wlc_interface *interface, const int argc, char *argv[])
    if (wl_display_init_shm(wlc.display) != 0)
       die("Failed to init shm");
 
+   wlc_startup_phase(WLC_STARTUP_DISPLAY, begin);
+
+   if (!wlc_trace_init())
+      return false;
+
+   if (!wlc_capture_init())
+      return false;
+
+   begin = wlc_get_time_ns();
    if (!wlc_udev_init())
       return false;
 
+   wlc_startup_phase(WLC_STARTUP_UDEV, begin);
+
    const char *libinput = getenv("WLC_LIBINPUT");
-   if (!display || (libinput && !strcmp(libinput, "1"))) {
+   if ((!display && !is_headless) || (libinput && !strcmp(libinput, "1"))) {
+      begin = wlc_get_time_ns();
       if (!wlc_input_init())
          return false;
+
+      wlc_startup_phase(WLC_STARTUP_INPUT, begin);
    }
 
+   // WLC_XWAYLAND=0 disables Xwayland, 1 spawns it now instead of on the first X11 client
    const char *xwayland = getenv("WLC_XWAYLAND");
    if (!xwayland || strcmp(xwayland, "0")) {
-      if (!(wlc_xwayland_init()))
+      begin = wlc_get_time_ns();
+      if (!(wlc_xwayland_init(!(xwayland && !strcmp(xwayland, "1")))))
          return false;
+
+      wlc_startup_phase(WLC_STARTUP_XWAYLAND, begin);
    }
 
    memcpy(&wlc.interface, interface, sizeof(wlc.interface));
@@ -25,10 +25,12 @@ static const char *socket_dir = "/tmp/.X11-unix";
 static const char *socket_fmt = "/tmp/.X11-unix/X%d";
 
 static struct {
-   struct sigaction old_sigusr1;
    char display_name[16];
    struct wl_client *client;
-   int display;
+   struct wl_event_source *listen[2]; // until the first X11 client connects
+   struct wl_event_source *ready; // until Xwayland writes to -displayfd
+   uint64_t spawned; // ns
+   int display, ready_fd;
    int wl[2], wm[2], socks[2];
    pid_t pid;
    bool fds_set[3];
@@ -173,13 +175,40 @@ close_display(void)
 }
 
 static void
-sigusr_handler(int signal_number)
+stop_waiting_ready(void)
 {
-   assert(signal_number == SIGUSR1);
-   wlc_log(WLC_LOG_INFO, "Xwayland started");
-   sigaction(signal_number, &xserver.old_sigusr1, NULL);
+   if (!xserver.ready)
+      return;
+
+   wl_event_source_remove(xserver.ready);
+   close(xserver.ready_fd);
+   xserver.ready = NULL;
+}
+
+// Xwayland writes the display number to -displayfd once it accepts connections.
+// SIGUSR1 is not used for this, it is the VT release signal and Xwayland may start at any time.
+static int
+cb_ready(int fd, uint32_t mask, void *data)
+{
+   (void)mask, (void)data;
+
+   char buf[16];
+   const ssize_t n = read(fd, buf, sizeof(buf));
+
+   if (n < 0 && errno == EAGAIN)
+      return 0;
+
+   stop_waiting_ready();
+
+   if (n <= 0) {
+      wlc_log(WLC_LOG_WARN, "Xwayland exited before it was ready");
+      return 0;
+   }
+
+   wlc_log(WLC_LOG_INFO, "Xwayland started in %.1f ms", (wlc_get_time_ns() - xserver.spawned) / 1e6);
    setenv("DISPLAY", xserver.display_name, true);
    wl_signal_emit(&wlc_system_signals()->xwayland, &(bool){true});
+   return 0;
 }
 
 struct wl_client*
@@ -194,9 +223,23 @@ wlc_xwayland_get_fd(void)
    return xserver.wm[0];
 }
 
+static void
+stop_listening(void)
+{
+   for (int i = 0; i < 2; ++i) {
+      if (xserver.listen[i])
+         wl_event_source_remove(xserver.listen[i]);
+
+      xserver.listen[i] = NULL;
+   }
+}
+
 void
 wlc_xwayland_terminate(void)
 {
+   stop_listening();
+   stop_waiting_ready();
+
    if (xserver.pid > 0) {
       wlc_log(WLC_LOG_INFO, "Closing Xwayland");
       kill(xserver.pid, SIGTERM);
@@ -222,13 +265,10 @@ wlc_xwayland_terminate(void)
    memset(&xserver, 0, sizeof(xserver));
 }
 
-bool
-wlc_xwayland_init(void)
+static bool
+spawn(void)
 {
-   if (!open_display(xserver.socks))
-      goto display_open_fail;
-
-   xserver.fds_set[0] = true;
+   xserver.spawned = wlc_get_time_ns();
 
    /* Open a socket for the Wayland connection from Xwayland. */
    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, xserver.wl) != 0)
@@ -242,8 +282,12 @@ wlc_xwayland_init(void)
 
    xserver.fds_set[2] = true;
 
+   int ready[2];
+   if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, ready) != 0)
+      goto ready_socketpair_fail;
+
    if ((xserver.pid = fork()) == 0) {
-      int fds[] = { xserver.wl[1], xserver.wm[1], xserver.socks[0], xserver.socks[1] };
+      int fds[] = { xserver.wl[1], xserver.wm[1], xserver.socks[0], xserver.socks[1], ready[1] };
       char strings[sizeof(fds) / sizeof(int)][16];
 
       /* Unset the FD_CLOEXEC flag on the FDs that will get passed to Xwayland. */
@@ -259,15 +303,6 @@ wlc_xwayland_init(void)
          }
       }
 
-      /* Ignore the USR1 signal so that Xwayland will send a USR1 signal
-       * to the parent process (us) after it finishes initializing. See
-       * Xserver(1) for more details. */
-      struct sigaction action = { .sa_handler = SIG_IGN };
-      if (sigaction(SIGUSR1, &action, NULL) != 0) {
-         wlc_log(WLC_LOG_WARN, "Failed to set SIGUSR1 handler to SIG_IGN: %m");
-         _exit(EXIT_FAILURE);
-      }
-
       const char *xdg_runtime = getenv("XDG_RUNTIME_DIR");
 
       if (clearenv() != 0) {
@@ -291,30 +326,39 @@ wlc_xwayland_init(void)
             "-listen", strings[2],
             "-listen", strings[3],
             "-wm", strings[1],
+            "-displayfd", strings[4],
             NULL);
       _exit(EXIT_FAILURE);
    } else if (xserver.pid < 0) {
+      close(ready[0]);
+      close(ready[1]);
       goto fork_fail;
    }
 
    close(xserver.wl[1]);
    close(xserver.wm[1]);
+   close(ready[1]);
+
+   xserver.ready_fd = ready[0];
+   if (!(xserver.ready = wl_event_loop_add_fd(wlc_event_loop(), ready[0], WL_EVENT_READABLE, cb_ready, NULL))) {
+      close(ready[0]);
+      goto ready_fail;
+   }
 
    if (!(xserver.client = wl_client_create(wlc_display(), xserver.wl[0])))
       goto client_create_fail;
 
-   struct sigaction action;
-   memset(&action, 0, sizeof(action));
-   action.sa_handler = sigusr_handler;
-   sigaction(SIGUSR1, &action,  &xserver.old_sigusr1);
    return true;
 
-display_open_fail:
-   wlc_log(WLC_LOG_WARN, "Failed to open xwayland display");
-   goto fail;
 socketpair_fail:
    wlc_log(WLC_LOG_WARN, "Failed to create socketpair for wayland and xwayland");
    goto fail;
+ready_socketpair_fail:
+   wlc_log(WLC_LOG_WARN, "Failed to create socketpair for xwayland -displayfd");
+   goto fail;
+ready_fail:
+   wlc_log(WLC_LOG_WARN, "Failed to add xwayland -displayfd to event loop");
+   goto fail;
 client_create_fail:
    wlc_log(WLC_LOG_WARN, "Failed to create wayland client");
    goto fail;
@@ -324,3 +368,45 @@ fail:
    wlc_xwayland_terminate();
    return false;
 }
+
+static int
+cb_x11_connection(int fd, uint32_t mask, void *data)
+{
+   (void)fd, (void)mask, (void)data;
+
+   // Xwayland accepts the pending connection itself, it got the listening sockets
+   stop_listening();
+   wlc_log(WLC_LOG_INFO, "First X11 client on %s, spawning Xwayland", xserver.display_name);
+   spawn();
+   return 0;
+}
+
+bool
+wlc_xwayland_init(bool lazy)
+{
+   if (!open_display(xserver.socks))
+      goto display_open_fail;
+
+   xserver.fds_set[0] = true;
+
+   if (!lazy)
+      return spawn();
+
+   for (int i = 0; i < 2; ++i) {
+      if (!(xserver.listen[i] = wl_event_loop_add_fd(wlc_event_loop(), xserver.socks[i], WL_EVENT_READABLE, cb_x11_connection, NULL)))
+         goto listen_fail;
+   }
+
+   // X11 clients may connect right away, they wait in the backlog until Xwayland is up
+   setenv("DISPLAY", xserver.display_name, true);
+   return true;
+
+display_open_fail:
+   wlc_log(WLC_LOG_WARN, "Failed to open xwayland display");
+   goto fail;
+listen_fail:
+   wlc_log(WLC_LOG_WARN, "Failed to add X11 sockets to event loop");
+fail:
+   wlc_xwayland_terminate();
+   return false;
+}
@@ -7,7 +7,7 @@ struct wlc_compositor;
 
 struct wl_client* wlc_xwayland_get_client(void);
 int wlc_xwayland_get_fd(void);
-bool wlc_xwayland_init(void);
+bool wlc_xwayland_init(bool lazy);
 void wlc_xwayland_terminate(void);
 
 #endif /* _WLC_XWAYLAND_H_ */
@@ -8,6 +8,7 @@
 #include "compositor/client.h"
 #include "compositor/view.h"
 #include "compositor/seat/seat.h"
+#include "trace.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -22,16 +23,6 @@
 
 #define LENGTH(x) (sizeof(x) / sizeof(x)[0])
 
-struct wlc_x11_window {
-   struct wlc_view *view;
-   struct wl_list link;
-   xcb_window_t id;
-   uint32_t surface_id;
-   bool override_redirect;
-   bool has_delete_window;
-   bool has_alpha;
-};
-
 enum atom_name {
    WL_SURFACE_ID,
    WM_DELETE_WINDOW,
@@ -70,6 +61,51 @@ enum atom_name {
    ATOM_LAST
 };
 
+#define TYPE_WM_PROTOCOLS    XCB_ATOM_CUT_BUFFER0
+#define TYPE_MOTIF_WM_HINTS  XCB_ATOM_CUT_BUFFER1
+#define TYPE_NET_WM_STATE    XCB_ATOM_CUT_BUFFER2
+#define TYPE_WM_NORMAL_HINTS XCB_ATOM_CUT_BUFFER3
+
+// Properties read by read_properties, atom is used when name is ATOM_LAST.
+static const struct {
+   enum atom_name name;
+   xcb_atom_t atom;
+   xcb_atom_t type;
+} properties[] = {
+   { ATOM_LAST, XCB_ATOM_WM_CLASS, XCB_ATOM_STRING },
+   { ATOM_LAST, XCB_ATOM_WM_NAME, XCB_ATOM_STRING },
+   { ATOM_LAST, XCB_ATOM_WM_TRANSIENT_FOR, XCB_ATOM_WINDOW },
+   { WM_PROTOCOLS, XCB_ATOM_NONE, TYPE_WM_PROTOCOLS },
+   { WM_NORMAL_HINTS, XCB_ATOM_NONE, TYPE_WM_NORMAL_HINTS },
+   { NET_WM_STATE, XCB_ATOM_NONE, TYPE_NET_WM_STATE },
+   { NET_WM_WINDOW_TYPE, XCB_ATOM_NONE, XCB_ATOM_ATOM },
+   { NET_WM_NAME, XCB_ATOM_NONE, XCB_ATOM_STRING },
+   { NET_WM_PID, XCB_ATOM_NONE, XCB_ATOM_CARDINAL },
+   { MOTIF_WM_HINTS, XCB_ATOM_NONE, TYPE_MOTIF_WM_HINTS },
+};
+
+struct wlc_x11_window {
+   struct wlc_view *view;
+   struct wl_list link;
+   xcb_window_t id;
+   uint32_t surface_id;
+   bool override_redirect;
+   bool has_delete_window;
+   bool has_alpha;
+
+   // Replies requested by fetch, collected from x11_event as they arrive.
+   struct {
+      xcb_get_geometry_cookie_t geometry;
+      xcb_get_property_cookie_t properties[LENGTH(properties)];
+      xcb_get_geometry_reply_t *geometry_reply;
+      xcb_get_property_reply_t *property_replies[LENGTH(properties)];
+      uint32_t collected; // geometry (when linking) first, then properties
+      bool pending, link, refetch;
+   } fetch;
+
+   uint64_t round_trips; // x11.round_trips when the window was created
+};
+
 struct wlc_xwm {
    struct wlc_compositor *compositor;
    struct wl_event_source *event_source;
@@ -87,6 +123,15 @@ static struct {
    xcb_atom_t atoms[ATOM_LAST];
    xcb_window_t window, focus;
 
+   // Call sites of unchecked requests by sequence, their errors arrive as events.
+   struct {
+      unsigned int sequence;
+      const char *func;
+      uint32_t line;
+   } sent[64];
+
+   uint64_t round_trips; // blocking waits for Xwayland
+
    struct {
       void *xcb_handle;
       void *xcb_composite_handle;
@@ -106,20 +151,23 @@ static struct {
       int (*xcb_get_property_value_length)(xcb_get_property_reply_t*);
       xcb_get_geometry_cookie_t (*xcb_get_geometry)(xcb_connection_t*, xcb_drawable_t);
       xcb_get_geometry_reply_t* (*xcb_get_geometry_reply)(xcb_connection_t*, xcb_get_geometry_cookie_t, xcb_generic_error_t**);
-      xcb_void_cookie_t (*xcb_create_window_checked)(xcb_connection_t*, uint8_t, xcb_window_t, xcb_window_t, int16_t, int16_t, uint16_t, uint16_t, uint16_t, uint16_t, xcb_visualid_t, uint32_t, const uint32_t*);
-      xcb_void_cookie_t (*xcb_destroy_window_checked)(xcb_connection_t*, xcb_window_t);
-      xcb_void_cookie_t (*xcb_map_window_checked)(xcb_connection_t*, xcb_window_t);
-      xcb_void_cookie_t (*xcb_unmap_window_checked)(xcb_connection_t*, xcb_window_t);
-      xcb_void_cookie_t (*xcb_change_property_checked)(xcb_connection_t*, uint8_t, xcb_window_t, xcb_atom_t, xcb_atom_t, uint8_t, uint32_t, const void*);
+      xcb_void_cookie_t (*xcb_create_window)(xcb_connection_t*, uint8_t, xcb_window_t, xcb_window_t, int16_t, int16_t, uint16_t, uint16_t, uint16_t, uint16_t, xcb_visualid_t, uint32_t, const uint32_t*);
+      xcb_void_cookie_t (*xcb_destroy_window)(xcb_connection_t*, xcb_window_t);
+      xcb_void_cookie_t (*xcb_map_window)(xcb_connection_t*, xcb_window_t);
+      xcb_void_cookie_t (*xcb_unmap_window)(xcb_connection_t*, xcb_window_t);
+      xcb_void_cookie_t (*xcb_change_property)(xcb_connection_t*, uint8_t, xcb_window_t, xcb_atom_t, xcb_atom_t, uint8_t, uint32_t, const void*);
       xcb_void_cookie_t (*xcb_change_window_attributes_checked)(xcb_connection_t*, xcb_window_t, uint32_t, const uint32_t*);
-      xcb_void_cookie_t (*xcb_configure_window_checked)(xcb_connection_t*, xcb_window_t, uint16_t, const uint32_t*);
-      xcb_void_cookie_t (*xcb_set_selection_owner_checked)(xcb_connection_t*, xcb_window_t, xcb_atom_t, xcb_timestamp_t);
-      xcb_void_cookie_t (*xcb_set_input_focus_checked)(xcb_connection_t*, uint8_t, xcb_window_t, xcb_timestamp_t);
-      xcb_void_cookie_t (*xcb_kill_client_checked)(xcb_connection_t*, uint32_t);
-      xcb_void_cookie_t (*xcb_send_event_checked)(xcb_connection_t*, uint8_t, xcb_window_t, uint32_t, const char*);
+      xcb_void_cookie_t (*xcb_change_window_attributes)(xcb_connection_t*, xcb_window_t, uint32_t, const uint32_t*);
+      xcb_void_cookie_t (*xcb_configure_window)(xcb_connection_t*, xcb_window_t, uint16_t, const uint32_t*);
+      xcb_void_cookie_t (*xcb_set_selection_owner)(xcb_connection_t*, xcb_window_t, xcb_atom_t, xcb_timestamp_t);
+      xcb_void_cookie_t (*xcb_set_input_focus)(xcb_connection_t*, uint8_t, xcb_window_t, xcb_timestamp_t);
+      xcb_void_cookie_t (*xcb_kill_client)(xcb_connection_t*, uint32_t);
+      xcb_void_cookie_t (*xcb_send_event)(xcb_connection_t*, uint8_t, xcb_window_t, uint32_t, const char*);
       xcb_intern_atom_cookie_t (*xcb_intern_atom)(xcb_connection_t*, uint8_t, uint16_t, const char*);
       xcb_intern_atom_reply_t* (*xcb_intern_atom_reply)(xcb_connection_t*, xcb_intern_atom_cookie_t, xcb_generic_error_t**);
       xcb_generic_error_t* (*xcb_request_check)(xcb_connection_t*, xcb_void_cookie_t);
+      int (*xcb_poll_for_reply)(xcb_connection_t*, unsigned int, void**, xcb_generic_error_t**);
+      void (*xcb_discard_reply)(xcb_connection_t*, unsigned int);
       xcb_generic_event_t* (*xcb_poll_for_event)(xcb_connection_t*);
       xcb_query_extension_reply_t* (*xcb_get_extension_data)(xcb_connection_t*, xcb_extension_t*);
 
@@ -128,7 +176,7 @@ static struct {
 
       xcb_xfixes_query_version_cookie_t (*xcb_xfixes_query_version)(xcb_connection_t*, uint32_t, uint32_t);
       xcb_xfixes_query_version_reply_t* (*xcb_xfixes_query_version_reply)(xcb_connection_t*, xcb_xfixes_query_version_cookie_t, xcb_generic_error_t**);
-      xcb_void_cookie_t (*xcb_xfixes_select_selection_input_checked)(xcb_connection_t*, xcb_window_t, xcb_atom_t, uint32_t);
+      xcb_void_cookie_t (*xcb_xfixes_select_selection_input)(xcb_connection_t*, xcb_window_t, xcb_atom_t, uint32_t);
       xcb_extension_t *xcb_xfixes_id;
    } api;
 } x11;
@@ -171,27 +219,29 @@ xcb_load(void)
       goto function_pointer_exception;
    if (!load(xcb_get_geometry_reply))
       goto function_pointer_exception;
-   if (!load(xcb_create_window_checked))
+   if (!load(xcb_create_window))
       goto function_pointer_exception;
-   if (!load(xcb_destroy_window_checked))
+   if (!load(xcb_destroy_window))
       goto function_pointer_exception;
-   if (!load(xcb_map_window_checked))
+   if (!load(xcb_map_window))
       goto function_pointer_exception;
-   if (!load(xcb_unmap_window_checked))
+   if (!load(xcb_unmap_window))
       goto function_pointer_exception;
-   if (!load(xcb_change_property_checked))
+   if (!load(xcb_change_property))
       goto function_pointer_exception;
    if (!load(xcb_change_window_attributes_checked))
       goto function_pointer_exception;
-   if (!load(xcb_configure_window_checked))
+   if (!load(xcb_change_window_attributes))
       goto function_pointer_exception;
-   if (!load(xcb_set_selection_owner_checked))
+   if (!load(xcb_configure_window))
       goto function_pointer_exception;
-   if (!load(xcb_set_input_focus_checked))
+   if (!load(xcb_set_selection_owner))
       goto function_pointer_exception;
-   if (!load(xcb_kill_client_checked))
+   if (!load(xcb_set_input_focus))
       goto function_pointer_exception;
-   if (!load(xcb_send_event_checked))
+   if (!load(xcb_kill_client))
+      goto function_pointer_exception;
+   if (!load(xcb_send_event))
       goto function_pointer_exception;
    if (!load(xcb_intern_atom))
       goto function_pointer_exception;
@@ -199,6 +249,10 @@ xcb_load(void)
       goto function_pointer_exception;
    if (!load(xcb_request_check))
       goto function_pointer_exception;
+   if (!load(xcb_poll_for_reply))
+      goto function_pointer_exception;
+   if (!load(xcb_discard_reply))
+      goto function_pointer_exception;
    if (!load(xcb_poll_for_event))
       goto function_pointer_exception;
    if (!load(xcb_get_extension_data))
@@ -255,7 +309,7 @@ xcb_xfixes_load(void)
       goto function_pointer_exception;
    if (!load(xcb_xfixes_query_version_reply))
       goto function_pointer_exception;
-   if (!load(xcb_xfixes_select_selection_input_checked))
+   if (!load(xcb_xfixes_select_selection_input))
       goto function_pointer_exception;
    if (!load(xcb_xfixes_id))
       goto function_pointer_exception;
@@ -272,15 +326,47 @@ function_pointer_exception:
 static bool
 xcb_call(const char *func, uint32_t line, xcb_void_cookie_t cookie)
 {
+   x11.round_trips += 1;
+
    xcb_generic_error_t *error;
    if (!(error = x11.api.xcb_request_check(x11.connection, cookie)))
       return true;
 
    wlc_log(WLC_LOG_ERROR, "xwm: function %s at line %u x11 error code %d", func, line, error->error_code);
+   free(error);
    return false;
 }
 #define XCB_CALL(x) xcb_call(__PRETTY_FUNCTION__, __LINE__, x)
 
+static void
+xcb_sent(const char *func, uint32_t line, xcb_void_cookie_t cookie)
+{
+   const uint32_t i = cookie.sequence % LENGTH(x11.sent);
+   x11.sent[i].sequence = cookie.sequence;
+   x11.sent[i].func = func;
+   x11.sent[i].line = line;
+}
+#define XCB_SEND(x) xcb_sent(__PRETTY_FUNCTION__, __LINE__, x)
+
+static void
+handle_error(const xcb_generic_error_t *error)
+{
+   assert(error);
+
+   // Windows may be destroyed before requests for them are processed.
+   if (error->error_code == XCB_WINDOW) {
+      wlc_dlog(WLC_DBG_XWM, "-> BadWindow (%u) for request %u", error->resource_id, error->major_code);
+      return;
+   }
+
+   const uint32_t i = error->full_sequence % LENGTH(x11.sent);
+   if (x11.sent[i].func && x11.sent[i].sequence == error->full_sequence) {
+      wlc_log(WLC_LOG_ERROR, "xwm: function %s at line %u x11 error code %d", x11.sent[i].func, x11.sent[i].line, error->error_code);
+   } else {
+      wlc_log(WLC_LOG_ERROR, "xwm: request %u.%u x11 error code %d", error->major_code, error->minor_code, error->error_code);
+   }
+}
+
 /**
  * TODO: change to hashmap, instead of wl_list
  */
@@ -337,52 +423,21 @@ handle_state(struct wlc_x11_window *win, xcb_atom_t *atoms, size_t nmemb, enum n
 static void
 read_properties(struct wlc_xwm *xwm, struct wlc_x11_window *win)
 {
-   assert(win);
-
-#define TYPE_WM_PROTOCOLS    XCB_ATOM_CUT_BUFFER0
-#define TYPE_MOTIF_WM_HINTS  XCB_ATOM_CUT_BUFFER1
-#define TYPE_NET_WM_STATE    XCB_ATOM_CUT_BUFFER2
-#define TYPE_WM_NORMAL_HINTS XCB_ATOM_CUT_BUFFER3
+   assert(win && win->view);
 
-   const struct {
-      xcb_atom_t atom;
-      xcb_atom_t type;
-   } props[] = {
-      { XCB_ATOM_WM_CLASS, XCB_ATOM_STRING },
-      { XCB_ATOM_WM_NAME, XCB_ATOM_STRING },
-      { XCB_ATOM_WM_TRANSIENT_FOR, XCB_ATOM_WINDOW },
-      { x11.atoms[WM_PROTOCOLS], TYPE_WM_PROTOCOLS },
-      { x11.atoms[WM_NORMAL_HINTS], TYPE_WM_NORMAL_HINTS },
-      { x11.atoms[NET_WM_STATE], TYPE_NET_WM_STATE },
-      { x11.atoms[NET_WM_WINDOW_TYPE], XCB_ATOM_ATOM },
-      { x11.atoms[NET_WM_NAME], XCB_ATOM_STRING },
-      { x11.atoms[NET_WM_PID], XCB_ATOM_CARDINAL },
-      { x11.atoms[MOTIF_WM_HINTS], TYPE_MOTIF_WM_HINTS },
-   };
-
-   xcb_get_property_cookie_t *cookies;
-   if (!(cookies = calloc(LENGTH(props), sizeof(xcb_get_property_cookie_t))))
-      return;
-
-   for (uint32_t i = 0; i < LENGTH(props); ++i)
-      cookies[i] = x11.api.xcb_get_property(x11.connection, 0, win->id, props[i].atom, XCB_ATOM_ANY, 0, 2048);
-
-   for (uint32_t i = 0; i < LENGTH(props); ++i) {
+   for (uint32_t i = 0; i < LENGTH(properties); ++i) {
       xcb_get_property_reply_t *reply;
-      if (!(reply = x11.api.xcb_get_property_reply(x11.connection, cookies[i], NULL)))
+      if (!(reply = win->fetch.property_replies[i]) || reply->type == XCB_ATOM_NONE)
          continue;
 
-      if (reply->type == XCB_ATOM_NONE) {
-         free(reply);
-         continue;
-      }
+      const xcb_atom_t atom = (properties[i].name != ATOM_LAST ? x11.atoms[properties[i].name] : properties[i].atom);
 
-      switch (props[i].type) {
+      switch (properties[i].type) {
          case XCB_ATOM_STRING:
             // Class && Name
-            if (props[i].atom == XCB_ATOM_WM_CLASS) {
+            if (atom == XCB_ATOM_WM_CLASS) {
                wlc_string_set_with_length(&win->view->shell_surface._class, x11.api.xcb_get_property_value(reply), x11.api.xcb_get_property_value_length(reply));
-            } else if (props[i].atom == XCB_ATOM_WM_NAME) {
+            } else if (atom == XCB_ATOM_WM_NAME) {
                wlc_string_set_with_length(&win->view->shell_surface.title, x11.api.xcb_get_property_value(reply), x11.api.xcb_get_property_value_length(reply));
             }
             break;
@@ -431,20 +486,94 @@ read_properties(struct wlc_xwm *xwm, struct wlc_x11_window *win)
          // Motif hints
          break;
       }
+   }
+}
+
+static void
+fetch_release(struct wlc_x11_window *win)
+{
+   assert(win);
+
+   if (!win->fetch.pending)
+      return;
+
+   // xcb keeps replies nobody asks for, tell it to drop the ones still coming
+   for (uint32_t i = win->fetch.collected; i < LENGTH(properties) + 1; ++i) {
+      if (i == 0) {
+         if (win->fetch.link)
+            x11.api.xcb_discard_reply(x11.connection, win->fetch.geometry.sequence);
+      } else {
+         x11.api.xcb_discard_reply(x11.connection, win->fetch.properties[i - 1].sequence);
+      }
+   }
+
+   free(win->fetch.geometry_reply);
+   for (uint32_t i = 0; i < LENGTH(properties); ++i)
+      free(win->fetch.property_replies[i]);
+
+   memset(&win->fetch, 0, sizeof(win->fetch));
+}
+
+static void
+fetch(struct wlc_x11_window *win, bool link)
+{
+   assert(win);
+
+   if (win->fetch.pending) {
+      // the properties may have changed after the pending replies were generated
+      win->fetch.refetch = true;
+      return;
+   }
 
-      free(reply);
+   win->fetch.pending = true;
+   win->fetch.link = link;
+
+   if (link)
+      win->fetch.geometry = x11.api.xcb_get_geometry(x11.connection, win->id);
+
+   for (uint32_t i = 0; i < LENGTH(properties); ++i) {
+      const xcb_atom_t atom = (properties[i].name != ATOM_LAST ? x11.atoms[properties[i].name] : properties[i].atom);
+      win->fetch.properties[i] = x11.api.xcb_get_property(x11.connection, 0, win->id, atom, XCB_ATOM_ANY, 0, 2048);
    }
 
-   free(cookies);
+   x11.api.xcb_flush(x11.connection);
+}
+
+static bool
+collect(struct wlc_x11_window *win)
+{
+   assert(win && win->fetch.pending);
+
+   // replies come in request order, stop at the first one still on its way
+   for (; win->fetch.collected < LENGTH(properties) + 1; ++win->fetch.collected) {
+      const uint32_t i = win->fetch.collected;
+
+      unsigned int sequence;
+      void **reply;
+      if (i == 0) {
+         if (!win->fetch.link)
+            continue;
+
+         sequence = win->fetch.geometry.sequence;
+         reply = (void**)&win->fetch.geometry_reply;
+      } else {
+         sequence = win->fetch.properties[i - 1].sequence;
+         reply = (void**)&win->fetch.property_replies[i - 1];
+      }
+
+      // an error (window already gone) leaves the reply NULL
+      xcb_generic_error_t *error = NULL;
+      if (!x11.api.xcb_poll_for_reply(x11.connection, sequence, reply, &error))
+         return false;
+
+      free(error);
+   }
 
-#undef TYPE_WM_PROTOCOLS
-#undef TYPE_MOTIF_WM_HINTS
-#undef TYPE_NET_WM_STATE
-#undef TYPE_WM_NORMAL_HINTS
+   return true;
 }
 
 static void
-link_surface(struct wlc_xwm *xwm, struct wlc_x11_window *win, struct wl_resource *resource)
+link_surface(struct wlc_x11_window *win, struct wl_resource *resource)
 {
    assert(win);
 
@@ -453,13 +582,29 @@ link_surface(struct wlc_xwm *xwm, struct wlc_x11_window *win, struct wl_resource
       return;
    }
 
+   // geometry and properties are requested here and the window is linked when they arrive
+   if (!win->fetch.pending)
+      fetch(win, true);
+}
+
+static void
+link_surface_finish(struct wlc_xwm *xwm, struct wlc_x11_window *win)
+{
+   assert(win && win->fetch.link);
+
+   struct wl_resource *resource;
+   if (!(resource = wl_client_get_object(wlc_xwayland_get_client(), win->surface_id))) {
+      wlc_dlog(WLC_DBG_XWM, "-> Surface resource for x11 window (%u) went away", win->id);
+      fetch_release(win);
+      return;
+   }
+
    xcb_get_geometry_reply_t *reply;
    struct wlc_geometry geometry = wlc_geometry_zero;
-   if ((reply = x11.api.xcb_get_geometry_reply(x11.connection, x11.api.xcb_get_geometry(x11.connection, win->id), NULL))) {
+   if ((reply = win->fetch.geometry_reply)) {
       geometry.origin = (struct wlc_origin){ reply->x, reply->y };
       geometry.size = (struct wlc_size){ reply->width, reply->height };
       win->has_alpha = (reply->depth == 32);
-      free(reply);
    }
 
    // This is not real interactable x11 window most likely, lets just not handle it.
@@ -469,14 +614,16 @@ link_surface(struct wlc_xwm *xwm, struct wlc_x11_window *win, struct wl_resource
    }
 
    struct wlc_client *client;
-   if (!(client = wlc_client_for_client_with_wl_client_in_list(wlc_xwayland_get_client(), &xwm->compositor->clients))) {
+   if (!(client = wlc_client_for_wl_client(&xwm->compositor->clients, wlc_xwayland_get_client()))) {
       wl_resource_post_error(resource, WL_DISPLAY_ERROR_INVALID_OBJECT, "Could not find wlc_client for wl_client");
+      fetch_release(win);
       return;
    }
 
    struct wlc_surface *surface = wl_resource_get_user_data(resource);
    if (!surface->view && !(surface->view = wlc_view_new(xwm->compositor, client, surface))) {
       wl_resource_post_no_memory(resource);
+      fetch_release(win);
       return;
    }
 
@@ -486,13 +633,20 @@ link_surface(struct wlc_xwm *xwm, struct wlc_x11_window *win, struct wl_resource
    if (win->override_redirect)
       win->view->type |= WLC_BIT_OVERRIDE_REDIRECT;
 
+   wlc_view_invalidate_bounds(win->view);
+
+   const bool refetch = win->fetch.refetch;
    read_properties(xwm, win);
+   fetch_release(win);
 
    if (!wlc_geometry_equals(&geometry, &wlc_geometry_zero))
       win->view->pending.geometry = geometry;
 
-   wlc_dlog(WLC_DBG_XWM, "-> Linked x11 window (%u) to view (%p) [%ux%u+%d,%d]",
-         win->id, win->view, geometry.size.w, geometry.size.h, geometry.origin.x, geometry.origin.y);
+   const uint64_t round_trips = x11.round_trips - win->round_trips;
+   WLC_TRACE(WLC_TRACE_XWM_ROUND_TRIPS, win->view, round_trips);
+
+   wlc_dlog(WLC_DBG_XWM, "-> Linked x11 window (%u) to view (%p) [%ux%u+%d,%d] (%lu round trips)",
+         win->id, win->view, geometry.size.w, geometry.size.h, geometry.origin.x, geometry.origin.y, (unsigned long)round_trips);
 
    if (!win->view->parent && x11.focus && (win->view->type & WLC_BIT_MODAL))
       set_parent(xwm, win, x11.focus);
@@ -505,6 +659,37 @@ link_surface(struct wlc_xwm *xwm, struct wlc_x11_window *win, struct wl_resource
 
    wl_list_remove(&win->link);
    wl_list_insert(&xwm->windows, &win->link);
+
+   // properties changed while the replies were on their way
+   if (refetch)
+      fetch(win, false);
+}
+
+static void
+collect_replies(struct wlc_xwm *xwm)
+{
+   assert(xwm);
+
+   struct wlc_x11_window *win, *wn;
+   wl_list_for_each_safe(win, wn, &xwm->unpaired_windows, link) {
+      if (win->fetch.pending && collect(win))
+         link_surface_finish(xwm, win);
+   }
+
+   wl_list_for_each_safe(win, wn, &xwm->windows, link) {
+      if (!win->fetch.pending || !collect(win))
+         continue;
+
+      const bool refetch = win->fetch.refetch;
+
+      if (win->view)
+         read_properties(xwm, win);
+
+      fetch_release(win);
+
+      if (refetch)
+         fetch(win, false);
+   }
 }
 
 static void
@@ -516,7 +701,7 @@ focus_window(xcb_window_t window, bool force)
    wlc_dlog(WLC_DBG_FOCUS, "-> xwm focus %u", window);
 
    if (window == 0) {
-      XCB_CALL(x11.api.xcb_set_input_focus_checked(x11.connection, XCB_INPUT_FOCUS_POINTER_ROOT, XCB_NONE, XCB_CURRENT_TIME));
+      XCB_SEND(x11.api.xcb_set_input_focus(x11.connection, XCB_INPUT_FOCUS_POINTER_ROOT, XCB_NONE, XCB_CURRENT_TIME));
       x11.focus = 0;
       return;
    }
@@ -528,8 +713,8 @@ focus_window(xcb_window_t window, bool force)
    m.type = x11.atoms[WM_PROTOCOLS];
    m.data.data32[0] = x11.atoms[WM_TAKE_FOCUS];
    m.data.data32[1] = XCB_TIME_CURRENT_TIME;
-   XCB_CALL(x11.api.xcb_send_event_checked(x11.connection, 0, window, XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT, (char*)&m));
-   XCB_CALL(x11.api.xcb_set_input_focus_checked(x11.connection, XCB_INPUT_FOCUS_POINTER_ROOT, window, XCB_CURRENT_TIME));
+   XCB_SEND(x11.api.xcb_send_event(x11.connection, 0, window, XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT, (char*)&m));
+   XCB_SEND(x11.api.xcb_set_input_focus(x11.connection, XCB_INPUT_FOCUS_POINTER_ROOT, window, XCB_CURRENT_TIME));
    x11.api.xcb_flush(x11.connection);
    x11.focus = window;
 }
@@ -545,6 +730,7 @@ wlc_x11_window_new(struct wlc_xwm *xwm, xcb_window_t window, bool override_redir
 
    win->id = window;
    win->override_redirect = override_redirect;
+   win->round_trips = x11.round_trips;
    wl_list_insert(&xwm->unpaired_windows, &win->link);
    return win;
 }
@@ -557,10 +743,13 @@ wlc_x11_window_free(struct wlc_x11_window *win)
    if (x11.focus == win->id)
       focus_window(0, false);
 
+   fetch_release(win);
+
    if (win->view) {
       wlc_view_defocus(win->view);
       win->view->x11_window = NULL;
       win->view->client = NULL;
+      wlc_view_invalidate_bounds(win->view);
    }
 
    wl_list_remove(&win->link);
@@ -578,7 +767,7 @@ deletewindow(xcb_window_t window)
    ev.type = x11.atoms[WM_PROTOCOLS];
    ev.data.data32[0] = x11.atoms[WM_DELETE_WINDOW];
    ev.data.data32[1] = XCB_CURRENT_TIME;
-   XCB_CALL(x11.api.xcb_send_event_checked(x11.connection, 0, window, XCB_EVENT_MASK_NO_EVENT, (char*)&ev));
+   XCB_SEND(x11.api.xcb_send_event(x11.connection, 0, window, XCB_EVENT_MASK_NO_EVENT, (char*)&ev));
 }
 
 enum wlc_surface_format
@@ -596,7 +785,7 @@ wlc_x11_window_close(struct wlc_x11_window *win)
    if (win->has_delete_window) {
       deletewindow(win->id);
    } else {
-      XCB_CALL(x11.api.xcb_kill_client_checked(x11.connection, win->id));
+      XCB_SEND(x11.api.xcb_kill_client(x11.connection, win->id));
    }
 
    x11.api.xcb_flush(x11.connection);
@@ -608,7 +797,7 @@ wlc_x11_window_position(struct wlc_x11_window *win, const int32_t x, const int32
    assert(win);
    static const uint32_t mask = XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y;
    const uint32_t values[] = { x, y };
-   XCB_CALL(x11.api.xcb_configure_window_checked(x11.connection, win->id, mask, (uint32_t*)&values));
+   XCB_SEND(x11.api.xcb_configure_window(x11.connection, win->id, mask, (uint32_t*)&values));
    x11.api.xcb_flush(x11.connection);
 }
 
@@ -618,7 +807,7 @@ wlc_x11_window_resize(struct wlc_x11_window *win, const uint32_t width, const ui
    assert(win);
    static const uint32_t mask = XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT;
    const uint32_t values[] = { width, height };
-   XCB_CALL(x11.api.xcb_configure_window_checked(x11.connection, win->id, mask, (uint32_t*)&values));
+   XCB_SEND(x11.api.xcb_configure_window(x11.connection, win->id, mask, (uint32_t*)&values));
    x11.api.xcb_flush(x11.connection);
 }
 
@@ -628,7 +817,7 @@ wlc_x11_window_set_state(struct wlc_x11_window *win, enum wlc_view_state_bit sta
    assert(win);
 
    if (state == WLC_BIT_FULLSCREEN)
-      XCB_CALL(x11.api.xcb_change_property_checked(x11.connection, XCB_PROP_MODE_REPLACE, win->id, x11.atoms[NET_WM_STATE], XCB_ATOM_ATOM, 32, (toggle ? 1 : 0), (toggle ? &x11.atoms[NET_WM_STATE_FULLSCREEN] : NULL)));
+      XCB_SEND(x11.api.xcb_change_property(x11.connection, XCB_PROP_MODE_REPLACE, win->id, x11.atoms[NET_WM_STATE], XCB_ATOM_ATOM, 32, (toggle ? 1 : 0), (toggle ? &x11.atoms[NET_WM_STATE_FULLSCREEN] : NULL)));
 }
 
 void
@@ -657,7 +846,7 @@ handle_client_message(struct wlc_xwm *xwm, xcb_client_message_event_t *ev)
          return;
 
       win->surface_id = ev->data.data32[0];
-      link_surface(xwm, win, wl_client_get_object(wlc_xwayland_get_client(), ev->data.data32[0]));
+      link_surface(win, wl_client_get_object(wlc_xwayland_get_client(), ev->data.data32[0]));
       return;
    }
 
@@ -690,7 +879,7 @@ x11_event(int fd, uint32_t mask, void *data)
       if (!xfixes_event) {
          switch (event->response_type & ~0x80) {
             case 0:
-               wlc_log(WLC_LOG_ERROR, "xwm: Uncatched X11 error occured");
+               handle_error((xcb_generic_error_t*)event);
                break;
 
             case XCB_CREATE_NOTIFY: {
@@ -729,8 +918,8 @@ x11_event(int fd, uint32_t mask, void *data)
             case XCB_MAP_REQUEST: {
                xcb_map_request_event_t *ev = (xcb_map_request_event_t*)event;
                wlc_dlog(WLC_DBG_XWM, "XCB_MAP_REQUEST (%u)", ev->window);
-               XCB_CALL(x11.api.xcb_change_window_attributes_checked(x11.connection, ev->window, XCB_CW_EVENT_MASK, &(uint32_t){XCB_EVENT_MASK_FOCUS_CHANGE | XCB_EVENT_MASK_PROPERTY_CHANGE}));
-               XCB_CALL(x11.api.xcb_map_window_checked(x11.connection, ev->window));
+               XCB_SEND(x11.api.xcb_change_window_attributes(x11.connection, ev->window, XCB_CW_EVENT_MASK, &(uint32_t){XCB_EVENT_MASK_FOCUS_CHANGE | XCB_EVENT_MASK_PROPERTY_CHANGE}));
+               XCB_SEND(x11.api.xcb_map_window(x11.connection, ev->window));
             }
             break;
 
@@ -752,8 +941,12 @@ x11_event(int fd, uint32_t mask, void *data)
                xcb_property_notify_event_t *ev = (xcb_property_notify_event_t*)event;
                wlc_dlog(WLC_DBG_XWM, "XCB_PROPERTY_NOTIFY (%u)", ev->window);
                struct wlc_x11_window *win;
-               if ((win = wlc_x11_window_for_id(&xwm->windows, ev->window)))
-                  read_properties(xwm, win);
+               if ((win = wlc_x11_window_for_id(&xwm->windows, ev->window))) {
+                  fetch(win, false);
+               } else if ((win = wlc_x11_window_for_id(&xwm->unpaired_windows, ev->window)) && win->fetch.pending) {
+                  // link fetch in flight may carry the old value, read again once linked
+                  win->fetch.refetch = true;
+               }
             }
             break;
 
@@ -765,7 +958,7 @@ x11_event(int fd, uint32_t mask, void *data)
                // Some windows freeze unless they get what they want.
                static const uint32_t mask = XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT;
                const uint32_t values[] = { r.origin.x, r.origin.y, r.size.w, r.size.h };
-               XCB_CALL(x11.api.xcb_configure_window_checked(x11.connection, ev->window, mask, (uint32_t*)&values));
+               XCB_SEND(x11.api.xcb_configure_window(x11.connection, ev->window, mask, (uint32_t*)&values));
 
                struct wlc_x11_window *win;
                if ((win = wlc_x11_window_for_id(&xwm->windows, ev->window)) && win->view) {
@@ -776,7 +969,7 @@ x11_event(int fd, uint32_t mask, void *data)
                   if (!wlc_geometry_equals(&win->view->pending.geometry, &r)) {
                      r = win->view->pending.geometry;
                      const uint32_t values[] = { r.origin.x, r.origin.y, r.size.w, r.size.h };
-                     XCB_CALL(x11.api.xcb_configure_window_checked(x11.connection, ev->window, mask, (uint32_t*)&values));
+                     XCB_SEND(x11.api.xcb_configure_window(x11.connection, ev->window, mask, (uint32_t*)&values));
                   }
                }
             }
@@ -793,6 +986,7 @@ x11_event(int fd, uint32_t mask, void *data)
                      else
                         win->view->type &= ~WLC_BIT_OVERRIDE_REDIRECT;
                      win->override_redirect = ev->override_redirect;
+                     wlc_view_invalidate_bounds(win->view);
                   }
                }
             }
@@ -822,6 +1016,7 @@ x11_event(int fd, uint32_t mask, void *data)
       count += 1;
    }
 
+   collect_replies(xwm);
    x11.api.xcb_flush(x11.connection);
    return count;
 }
@@ -845,7 +1040,7 @@ surface_notify(struct wl_listener *listener, void *data)
       if (!win->surface_id)
          continue;
 
-      link_surface(xwm, win, wl_client_get_object(wlc_xwayland_get_client(), win->surface_id));
+      link_surface(win, wl_client_get_object(wlc_xwayland_get_client(), win->surface_id));
    }
 }
 
@@ -853,8 +1048,10 @@ surface_notify(struct wl_listener *listener, void *data)
 static void
 x11_terminate(void)
 {
-   if (x11.window)
-      XCB_CALL(x11.api.xcb_destroy_window_checked(x11.connection, x11.window));
+   if (x11.window) {
+      XCB_SEND(x11.api.xcb_destroy_window(x11.connection, x11.window));
+      x11.api.xcb_flush(x11.connection);
+   }
 
    if (x11.connection)
       x11.api.xcb_disconnect(x11.connection);
@@ -885,6 +1082,7 @@ x11_init(void)
       goto xcb_connection_fail;
 
    x11.api.xcb_prefetch_extension_data(x11.connection, x11.api.xcb_composite_id);
+   x11.api.xcb_prefetch_extension_data(x11.connection, x11.api.xcb_xfixes_id);
 
    struct {
       const char *name;
@@ -941,6 +1139,7 @@ x11_init(void)
    if (!(x11.xfixes = x11.api.xcb_get_extension_data(x11.connection, x11.api.xcb_xfixes_id)) || !x11.xfixes->present)
       goto xfixes_extension_fail;
 
+   x11.round_trips += 1;
    xcb_xfixes_query_version_reply_t *xfixes_reply;
    if (!(xfixes_reply = x11.api.xcb_xfixes_query_version_reply(x11.connection, x11.api.xcb_xfixes_query_version(x11.connection, XCB_XFIXES_MAJOR_VERSION, XCB_XFIXES_MINOR_VERSION), NULL)))
       goto xfixes_extension_fail;
@@ -955,6 +1154,9 @@ x11_init(void)
    if (!XCB_CALL(x11.api.xcb_composite_redirect_subwindows_checked(x11.connection, x11.screen->root, XCB_COMPOSITE_REDIRECT_MANUAL)))
       goto redirect_subwindows_fail;
 
+   // the atom replies were requested together, waiting for them is one round trip
+   x11.round_trips += 1;
+
    for (int i = 0; i < ATOM_LAST; ++i) {
       xcb_generic_error_t *error;
       xcb_intern_atom_reply_t *atom_reply = x11.api.xcb_intern_atom_reply(x11.connection, atom_cookies[map[i].atom], &error);
@@ -972,7 +1174,7 @@ x11_init(void)
    if (!(x11.window = x11.api.xcb_generate_id(x11.connection)))
       goto window_fail;
 
-   XCB_CALL(x11.api.xcb_create_window_checked(
+   XCB_SEND(x11.api.xcb_create_window(
          x11.connection, XCB_COPY_FROM_PARENT, x11.window, x11.screen->root,
          0, 0, 1, 1, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT, x11.screen->root_visual,
          XCB_CW_EVENT_MASK, (uint32_t[]){XCB_EVENT_MASK_PROPERTY_CHANGE}));
@@ -1001,18 +1203,18 @@ x11_init(void)
       x11.atoms[NET_WM_WINDOW_TYPE_NORMAL],
    };
 
-   XCB_CALL(x11.api.xcb_change_property_checked(x11.connection, XCB_PROP_MODE_REPLACE, x11.screen->root, x11.atoms[NET_SUPPORTED], XCB_ATOM_ATOM, 32, LENGTH(supported), supported));
-   XCB_CALL(x11.api.xcb_change_property_checked(x11.connection, XCB_PROP_MODE_REPLACE, x11.screen->root, x11.atoms[NET_SUPPORTING_WM_CHECK], XCB_ATOM_WINDOW, 32, 1, &x11.window));
-   XCB_CALL(x11.api.xcb_change_property_checked(x11.connection, XCB_PROP_MODE_REPLACE, x11.window, x11.atoms[NET_SUPPORTING_WM_CHECK], XCB_ATOM_WINDOW, 32, 1, &x11.window));
-   XCB_CALL(x11.api.xcb_change_property_checked(x11.connection, XCB_PROP_MODE_REPLACE, x11.window, x11.atoms[NET_WM_NAME], x11.atoms[UTF8_STRING], 8, strlen("xwlc"), "xwlc"));
-   XCB_CALL(x11.api.xcb_set_selection_owner_checked(x11.connection, x11.window, x11.atoms[CLIPBOARD_MANAGER], XCB_CURRENT_TIME));
-   XCB_CALL(x11.api.xcb_set_selection_owner_checked(x11.connection, x11.window, x11.atoms[WM_S0], XCB_CURRENT_TIME));
-   XCB_CALL(x11.api.xcb_set_selection_owner_checked(x11.connection, x11.window, x11.atoms[NET_WM_S0], XCB_CURRENT_TIME));
+   XCB_SEND(x11.api.xcb_change_property(x11.connection, XCB_PROP_MODE_REPLACE, x11.screen->root, x11.atoms[NET_SUPPORTED], XCB_ATOM_ATOM, 32, LENGTH(supported), supported));
+   XCB_SEND(x11.api.xcb_change_property(x11.connection, XCB_PROP_MODE_REPLACE, x11.screen->root, x11.atoms[NET_SUPPORTING_WM_CHECK], XCB_ATOM_WINDOW, 32, 1, &x11.window));
+   XCB_SEND(x11.api.xcb_change_property(x11.connection, XCB_PROP_MODE_REPLACE, x11.window, x11.atoms[NET_SUPPORTING_WM_CHECK], XCB_ATOM_WINDOW, 32, 1, &x11.window));
+   XCB_SEND(x11.api.xcb_change_property(x11.connection, XCB_PROP_MODE_REPLACE, x11.window, x11.atoms[NET_WM_NAME], x11.atoms[UTF8_STRING], 8, strlen("xwlc"), "xwlc"));
+   XCB_SEND(x11.api.xcb_set_selection_owner(x11.connection, x11.window, x11.atoms[CLIPBOARD_MANAGER], XCB_CURRENT_TIME));
+   XCB_SEND(x11.api.xcb_set_selection_owner(x11.connection, x11.window, x11.atoms[WM_S0], XCB_CURRENT_TIME));
+   XCB_SEND(x11.api.xcb_set_selection_owner(x11.connection, x11.window, x11.atoms[NET_WM_S0], XCB_CURRENT_TIME));
 
    uint32_t mask = XCB_XFIXES_SELECTION_EVENT_MASK_SET_SELECTION_OWNER |
                    XCB_XFIXES_SELECTION_EVENT_MASK_SELECTION_WINDOW_DESTROY |
                    XCB_XFIXES_SELECTION_EVENT_MASK_SELECTION_CLIENT_CLOSE;
-   XCB_CALL(x11.api.xcb_xfixes_select_selection_input_checked(x11.connection, x11.window, x11.atoms[CLIPBOARD], mask));
+   XCB_SEND(x11.api.xcb_xfixes_select_selection_input(x11.connection, x11.window, x11.atoms[CLIPBOARD], mask));
 
    x11.api.xcb_flush(x11.connection);
    return true;